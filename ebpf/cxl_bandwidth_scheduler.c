@@ -12,13 +12,87 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
+#include <dirent.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
+#include <linux/perf_event.h>
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
+#include <bpf/btf.h>
+
+#include "../microbench/resctrl.h"
+#include "task_snapshot.h"
+#include "perf_model.h"
 
 #define MAX_CPUS 1024
 #define MAX_TASKS 8192
+#define TASK_TYPE_BANDWIDTH 4 /* enum task_type in cxl_pmu_simple.bpf.c */
+#define RW_READER 1           /* enum rw_class in cxl_pmu_simple.bpf.c */
+#define RW_WRITER 2
+
+/* Value of the BPF memory_patterns map (cxl_pmu_simple.bpf.c) */
+struct memory_pattern {
+    __u64 last_access_time;
+    __u32 locality_score;
+    __u32 access_count;
+    _Bool is_reader;
+    __u8 task_type;
+    __u8 rw_class;
+};
+
+/* Value of the BPF cgrp_slots map (cxl_pmu_simple.bpf.c) */
+#define MAX_CGROUPS 128
+#define HWEIGHT_ONE (1 << 16)
+struct cgrp_slot {
+    __u64 cgid;
+    __u64 cvtime;
+    __u64 task_vtime;
+    __u64 runtime_ns;
+    __u32 weight;
+    __u32 child_weight_sum;
+    __u32 hweight;
+    __u32 hweight_gen;
+    __s32 parent;
+    _Bool used;
+    __u32 nr_borrowers;
+};
+
+/* Value of the BPF cpu_topology map (cxl_pmu.bpf.c) */
+struct cpu_topology {
+    __u32 llc_id;
+    __u32 node;
+    _Bool valid;
+};
+
+/* Indices of the BPF migration_stats map (enum migration_distance) */
+static const char *migration_stat_names[] = {
+    "same CPU", "same LLC", "cross LLC", "cross NUMA", "kept hot", "kept off saturated",
+};
+#define NR_MIG_STATS (sizeof(migration_stat_names) / sizeof(migration_stat_names[0]))
+
+/* Value of the BPF link_mix map (cxl_pmu_simple.bpf.c) */
+#define MAX_LINKS 8
+struct link_mix {
+    __u32 lock; /* struct bpf_spin_lock */
+    __s32 readers;
+    __s32 writers;
+    __u64 last_change_ns;
+    __u64 read_only_ns;
+    __u64 write_only_ns;
+    __u64 overlap_ns;
+    __u64 paired_dispatches;
+};
+
+/* resctrl group backing one scheduler task class */
+struct resctrl_class {
+    const char *name;
+    unsigned long long l3_mask; // 0 = leave unchanged
+    int mba_percent;            // 0 = leave unchanged
+    int created;
+    int mbm_valid;
+    struct resctrl_mbm last_mbm;
+};
 
 struct bandwidth_config {
     int enable_scheduler;
@@ -27,6 +101,9 @@ struct bandwidth_config {
     int num_threads;
     float read_ratio;
     int monitor_interval;    // seconds
+    int enable_resctrl;
+    const char *resctrl_root;
+    struct resctrl_class classes[2]; // [0] = readers, [1] = writers
 };
 
 struct scheduler_stats {
@@ -41,12 +118,58 @@ static volatile int running = 1;
 static struct bpf_object *obj = NULL;
 static struct bpf_link *sched_link = NULL;
 static char *bpf_obj_file = "cxl_pmu_minimal.bpf.o";
+static struct bandwidth_config *resctrl_config = NULL;
+static struct bpf_link *trace_links[8];
+static int nr_trace_links = 0;
+static struct bpf_link *task_iter_link = NULL;
+static int *llc_miss_fds = NULL;
+static int nr_llc_miss_fds = 0;
+static int coschedule_rw = 0;
+static const char *perf_model_file = NULL;
 
 void signal_handler(int sig) {
     running = 0;
     printf("\nShutting down scheduler...\n");
 }
 
+/*
+ * Set a `const volatile` global of the BPF program before it is loaded by
+ * patching its slot in the .rodata initial image, located through BTF.
+ */
+static int set_rodata_var(struct bpf_object *bpf_obj, const char *name,
+                          const void *value, size_t size) {
+    struct btf *btf = bpf_object__btf(bpf_obj);
+    struct bpf_map *map, *rodata = NULL;
+    if (!btf)
+        return -ENOENT;
+    bpf_object__for_each_map(map, bpf_obj) {
+        const char *map_name = bpf_map__name(map);
+        size_t len = strlen(map_name);
+        if (len >= 7 && strcmp(map_name + len - 7, ".rodata") == 0) {
+            rodata = map;
+            break;
+        }
+    }
+    int sec_id = btf__find_by_name_kind(btf, ".rodata", BTF_KIND_DATASEC);
+    if (!rodata || sec_id < 0)
+        return -ENOENT;
+
+    const struct btf_type *sec = btf__type_by_id(btf, sec_id);
+    const struct btf_var_secinfo *vars = btf_var_secinfos(sec);
+    for (int i = 0; i < btf_vlen(sec); i++) {
+        const struct btf_type *var = btf__type_by_id(btf, vars[i].type);
+        if (strcmp(btf__name_by_offset(btf, var->name_off), name) != 0)
+            continue;
+        size_t data_size;
+        char *data = bpf_map__initial_value(rodata, &data_size);
+        if (!data || vars[i].size != size || vars[i].offset + size > data_size)
+            return -EINVAL;
+        memcpy(data + vars[i].offset, value, size);
+        return 0;
+    }
+    return -ENOENT;
+}
+
 int load_scheduler() {
     int err;
     
@@ -68,6 +191,12 @@ int load_scheduler() {
         return -1;
     }
     
+    if (coschedule_rw) {
+        _Bool enable = 1;
+        if (set_rodata_var(obj, "coschedule_rw", &enable, sizeof(enable)) != 0)
+            fprintf(stderr, "Warning: %s has no reader/writer co-scheduling\n", bpf_obj_file);
+    }
+
     /* Load the BPF program */
     err = bpf_object__load(obj);
     if (err) {
@@ -93,6 +222,32 @@ int load_scheduler() {
         goto cleanup;
     }
     
+    /* Tracing programs (e.g. the LLC miss sampler) ride along */
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, obj) {
+        if (bpf_program__type(prog) != BPF_PROG_TYPE_TRACING ||
+            nr_trace_links >= (int)(sizeof(trace_links) / sizeof(trace_links[0])))
+            continue;
+        struct bpf_link *link = bpf_program__attach(prog);
+        if (!link) {
+            fprintf(stderr, "Warning: failed to attach %s\n", bpf_program__name(prog));
+            continue;
+        }
+        trace_links[nr_trace_links++] = link;
+
+        /* The task-context iterator is read through a pinned link by cxl_tasks */
+        if (bpf_program__expected_attach_type(prog) == BPF_TRACE_ITER) {
+            unlink(TASK_SNAPSHOT_PIN);
+            if (bpf_link__pin(link, TASK_SNAPSHOT_PIN) == 0) {
+                task_iter_link = link;
+                printf("Task snapshots: %s\n", TASK_SNAPSHOT_PIN);
+            } else {
+                fprintf(stderr, "Warning: failed to pin %s: %s\n", TASK_SNAPSHOT_PIN,
+                        strerror(errno));
+            }
+        }
+    }
+
     printf("CXL bandwidth-aware scheduler loaded successfully\n");
     return 0;
     
@@ -105,6 +260,20 @@ cleanup:
 }
 
 void unload_scheduler() {
+    if (task_iter_link) {
+        bpf_link__unpin(task_iter_link);
+        task_iter_link = NULL;
+    }
+    while (nr_trace_links > 0)
+        bpf_link__destroy(trace_links[--nr_trace_links]);
+    for (int i = 0; i < nr_llc_miss_fds; i++) {
+        if (llc_miss_fds[i] >= 0)
+            close(llc_miss_fds[i]);
+    }
+    free(llc_miss_fds);
+    llc_miss_fds = NULL;
+    nr_llc_miss_fds = 0;
+
     if (sched_link) {
         bpf_link__destroy(sched_link);
         sched_link = NULL;
@@ -133,6 +302,445 @@ int configure_bandwidth_limits(struct bandwidth_config *config) {
     return 0;
 }
 
+int setup_resctrl_classes(struct bandwidth_config *config) {
+    for (int i = 0; i < 2; i++) {
+        struct resctrl_class *cls = &config->classes[i];
+        int err = resctrl_create_group(config->resctrl_root, cls->name);
+        if (err < 0) {
+            fprintf(stderr, "resctrl: failed to create group %s/%s: %s\n",
+                    config->resctrl_root, cls->name, strerror(-err));
+            return -1;
+        }
+        cls->created = err == 1;
+
+        if (cls->l3_mask &&
+            (err = resctrl_set_l3_mask(config->resctrl_root, cls->name, cls->l3_mask))) {
+            fprintf(stderr, "resctrl: failed to set L3 mask of %s: %s\n",
+                    cls->name, strerror(-err));
+            return -1;
+        }
+        if (cls->mba_percent &&
+            (err = resctrl_set_mba(config->resctrl_root, cls->name, cls->mba_percent))) {
+            fprintf(stderr, "resctrl: failed to set MBA of %s: %s\n",
+                    cls->name, strerror(-err));
+            return -1;
+        }
+        cls->mbm_valid = resctrl_read_mbm(config->resctrl_root, cls->name,
+                                          &cls->last_mbm) > 0;
+
+        printf("resctrl group %s/%s (%s tasks): L3 mask %s%llx, MBA %d%%%s\n",
+               config->resctrl_root, cls->name, i == 0 ? "reader" : "writer",
+               cls->l3_mask ? "0x" : "unchanged ", cls->l3_mask,
+               cls->mba_percent ? cls->mba_percent : 100,
+               cls->mbm_valid ? "" : ", MBM unavailable");
+    }
+    resctrl_config = config;
+    return 0;
+}
+
+void cleanup_resctrl_classes(void) {
+    if (!resctrl_config)
+        return;
+    /* Removing a group moves its tasks back to the default group */
+    for (int i = 0; i < 2; i++) {
+        if (resctrl_config->classes[i].created)
+            resctrl_remove_group(resctrl_config->resctrl_root,
+                                 resctrl_config->classes[i].name);
+    }
+    resctrl_config = NULL;
+}
+
+/*
+ * Move every bandwidth task the scheduler has classified into the resctrl
+ * group of its class. The class comes from the thread name double_bandwidth
+ * gives its readers and writers; unnamed bandwidth tasks (the main thread,
+ * other tools) stay where they are. Tasks that already exited are skipped;
+ * re-assigning a task that is already in the group is a no-op for the kernel.
+ */
+void assign_resctrl_classes(struct bandwidth_config *config) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "memory_patterns");
+    if (!map) {
+        return;
+    }
+
+    int fd = bpf_map__fd(map);
+    __u32 key, next_key;
+    __u32 *prev = NULL;
+    struct memory_pattern pattern;
+    int assigned[2] = {0, 0};
+
+    while (bpf_map_get_next_key(fd, prev, &next_key) == 0) {
+        key = next_key;
+        prev = &key;
+        if (bpf_map_lookup_elem(fd, &key, &pattern) != 0 ||
+            pattern.task_type != TASK_TYPE_BANDWIDTH)
+            continue;
+        if (pattern.rw_class != RW_READER && pattern.rw_class != RW_WRITER)
+            continue;
+        int cls = pattern.rw_class == RW_READER ? 0 : 1;
+        if (resctrl_assign_task(config->resctrl_root, config->classes[cls].name, key) == 0)
+            assigned[cls]++;
+    }
+    printf("resctrl: %d reader and %d writer tasks assigned\n", assigned[0], assigned[1]);
+}
+
+void print_resctrl_stats(struct bandwidth_config *config) {
+    for (int i = 0; i < 2; i++) {
+        struct resctrl_class *cls = &config->classes[i];
+        struct resctrl_mbm cur;
+        if (resctrl_read_mbm(config->resctrl_root, cls->name, &cur) <= 0)
+            continue;
+        if (cls->mbm_valid) {
+            double mb = 1024.0 * 1024.0 * config->monitor_interval;
+            printf("resctrl %-10s MBM local %10.1f MB/s  total %10.1f MB/s\n", cls->name,
+                   (cur.local_bytes - cls->last_mbm.local_bytes) / mb,
+                   (cur.total_bytes - cls->last_mbm.total_bytes) / mb);
+        }
+        cls->last_mbm = cur;
+        cls->mbm_valid = 1;
+    }
+}
+
+static int read_sysfs_int(const char *path, int *value) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    int ok = fscanf(f, "%d", value) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+/* NUMA node of a CPU from its sysfs nodeN link, -1 if unknown */
+static int cpu_numa_node(int cpu) {
+    char path[128];
+    int node = -1;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (sscanf(entry->d_name, "node%d", &node) == 1)
+            break;
+        node = -1;
+    }
+    closedir(dir);
+    return node;
+}
+
+/*
+ * Fill the scheduler's cpu_topology map: the L3 id of every CPU (the
+ * package id when there is no L3 entry) and its NUMA node.
+ */
+void setup_cpu_topology(void) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "cpu_topology");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    int ncpus = libbpf_num_possible_cpus();
+    int filled = 0;
+    char path[256];
+    for (int cpu = 0; cpu < ncpus && cpu < MAX_CPUS; cpu++) {
+        struct cpu_topology topo = {.valid = 1};
+        int llc, node;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index3/id", cpu);
+        if (read_sysfs_int(path, &llc) != 0) {
+            snprintf(path, sizeof(path),
+                     "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+            if (read_sysfs_int(path, &llc) != 0)
+                continue;
+        }
+
+        node = cpu_numa_node(cpu);
+        topo.llc_id = llc;
+        topo.node = node < 0 ? 0 : node;
+        __u32 key = cpu;
+        if (bpf_map_update_elem(fd, &key, &topo, BPF_ANY) == 0)
+            filled++;
+    }
+    printf("CPU topology: %d CPUs mapped to LLC/NUMA domains\n", filled);
+}
+
+/* Parse up to `max` unsigned numbers following the keyword of `line` */
+static int parse_model_values(const char *line, __u32 *values, int max) {
+    const char *p = strchr(line, ' ');
+    int n = 0;
+    while (p && n < max) {
+        char *end;
+        unsigned long v = strtoul(p, &end, 10);
+        if (end == p)
+            break;
+        values[n++] = v;
+        p = end;
+    }
+    return n;
+}
+
+/*
+ * Load the table written by script/fit_perf_model.py into the scheduler's
+ * perf_model / perf_model_meta maps. Lines:
+ *   cxl_perf_model VERSION
+ *   cxl_latency_ns NS
+ *   home CPU_NODE MEM_NODE
+ *   pair CPU_NODE MEM_NODE NR_THREADS PEAK_MBPS IDLE_LATENCY_NS
+ *   threads T0 .. T7            (for the last pair, NR_THREADS values)
+ *   bw RATIO_IDX MBPS0 .. MBPS7
+ *   lat NS0 .. NS7
+ */
+int load_perf_model(const char *path) {
+    struct bpf_map *model_map = bpf_object__find_map_by_name(obj, "perf_model");
+    struct bpf_map *meta_map = bpf_object__find_map_by_name(obj, "perf_model_meta");
+    if (!model_map || !meta_map) {
+        fprintf(stderr, "Warning: %s has no perf_model maps, model not used\n", bpf_obj_file);
+        return -1;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open model %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int model_fd = bpf_map__fd(model_map);
+    struct perf_model_meta meta = {0};
+    struct perf_model_entry entry;
+    __u32 key = 0, values[2 + PERF_MODEL_THREAD_POINTS];
+    int have_entry = 0, have_threads = 0, pairs = 0, version = 0, err = 0;
+    char line[512];
+    for (int i = 0; i < PERF_MODEL_MAX_NODES; i++)
+        meta.home_mem_node[i] = -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        int cpu_node, mem_node, n;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "cxl_perf_model %d", &version) == 1) {
+            continue;
+        } else if (sscanf(line, "cxl_latency_ns %u", &meta.cxl_latency_ns) == 1) {
+            continue;
+        } else if (sscanf(line, "home %d %d", &cpu_node, &mem_node) == 2) {
+            if (cpu_node >= 0 && cpu_node < PERF_MODEL_MAX_NODES &&
+                mem_node >= 0 && mem_node < PERF_MODEL_MAX_NODES)
+                meta.home_mem_node[cpu_node] = mem_node;
+        } else if (strncmp(line, "pair ", 5) == 0) {
+            /* An entry is complete when the next pair starts or the file ends */
+            if (have_entry && entry.nr_threads && !have_threads) {
+                err = -1;
+                break;
+            }
+            if (have_entry && bpf_map_update_elem(model_fd, &key, &entry, BPF_ANY) == 0)
+                pairs++;
+            if (parse_model_values(line, values, 5) != 5 ||
+                values[0] >= PERF_MODEL_MAX_NODES || values[1] >= PERF_MODEL_MAX_NODES ||
+                values[2] > PERF_MODEL_THREAD_POINTS) {
+                err = -1;
+                break;
+            }
+            memset(&entry, 0, sizeof(entry));
+            key = values[0] * PERF_MODEL_MAX_NODES + values[1];
+            entry.nr_threads = values[2];
+            entry.peak_mbps = values[3];
+            entry.idle_latency_ns = values[4];
+            have_entry = 1;
+            have_threads = 0;
+        } else if (have_entry && strncmp(line, "threads ", 8) == 0) {
+            /* nr_threads must describe threads[] for readers of the map;
+             * one extra slot catches lines with too many values */
+            n = parse_model_values(line, values, PERF_MODEL_THREAD_POINTS + 1);
+            if (n != (int)entry.nr_threads) {
+                err = -1;
+                break;
+            }
+            memcpy(entry.threads, values, n * sizeof(__u32));
+            have_threads = 1;
+        } else if (have_entry && strncmp(line, "bw ", 3) == 0) {
+            n = parse_model_values(line, values, 1 + PERF_MODEL_THREAD_POINTS);
+            if (n < 2 || values[0] >= PERF_MODEL_RATIO_POINTS) {
+                err = -1;
+                break;
+            }
+            memcpy(entry.bw_mbps[values[0]], values + 1, (n - 1) * sizeof(__u32));
+        } else if (have_entry && strncmp(line, "lat ", 4) == 0) {
+            parse_model_values(line, entry.lat_ns, PERF_MODEL_LOAD_POINTS);
+        }
+    }
+    if (!err && have_entry && entry.nr_threads && !have_threads)
+        err = -1;
+    if (!err && have_entry && bpf_map_update_elem(model_fd, &key, &entry, BPF_ANY) == 0)
+        pairs++;
+    fclose(f);
+
+    if (err || version != PERF_MODEL_VERSION || pairs == 0) {
+        fprintf(stderr, "Model %s is malformed or has version %d (expected %d)\n",
+                path, version, PERF_MODEL_VERSION);
+        return -1;
+    }
+
+    meta.valid = 1;
+    __u32 zero = 0;
+    if (bpf_map_update_elem(bpf_map__fd(meta_map), &zero, &meta, BPF_ANY) != 0) {
+        fprintf(stderr, "Failed to enable model: %s\n", strerror(errno));
+        return -1;
+    }
+    printf("Performance model: %d node pairs from %s, far-memory latency above %u ns\n",
+           pairs, path, meta.cxl_latency_ns);
+    return 0;
+}
+
+/*
+ * Open a PERF_COUNT_HW_CACHE_MISSES counter on every CPU for the
+ * scheduler's llc_miss_events map. Without them (e.g. in VMs without a
+ * virtual PMU) footprints stay zero and no migration is penalised.
+ */
+void setup_llc_miss_events(void) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "llc_miss_events");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    int ncpus = libbpf_num_possible_cpus();
+    int opened = 0;
+    llc_miss_fds = calloc(ncpus, sizeof(int));
+    if (!llc_miss_fds)
+        return;
+    nr_llc_miss_fds = ncpus;
+
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HARDWARE,
+        .size = sizeof(attr),
+        .config = PERF_COUNT_HW_CACHE_MISSES,
+    };
+    for (int cpu = 0; cpu < ncpus; cpu++) {
+        llc_miss_fds[cpu] = syscall(__NR_perf_event_open, &attr, -1, cpu, -1, 0);
+        if (llc_miss_fds[cpu] < 0)
+            continue;
+        __u32 key = cpu;
+        if (bpf_map_update_elem(fd, &key, &llc_miss_fds[cpu], BPF_ANY) == 0)
+            opened++;
+    }
+    if (opened)
+        printf("LLC miss counters: %d CPUs\n", opened);
+    else
+        fprintf(stderr, "Warning: no LLC miss counters (%s), "
+                "migration penalties disabled\n", strerror(errno));
+}
+
+/* Map every CPU to the CXL link of its NUMA node for co-scheduling */
+void setup_cpu_links(void) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "cpu_link");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    int ncpus = libbpf_num_possible_cpus();
+    for (int cpu = 0; cpu < ncpus && cpu < MAX_CPUS; cpu++) {
+        int node = cpu_numa_node(cpu);
+        __u32 key = cpu, link = node < 0 ? 0 : node % MAX_LINKS;
+        bpf_map_update_elem(fd, &key, &link, BPF_ANY);
+    }
+}
+
+/* Share of time each link had reads, writes, or both in flight */
+void print_link_mix_stats(void) {
+    static struct link_mix last[MAX_LINKS];
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "link_mix");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    for (__u32 link = 0; link < MAX_LINKS; link++) {
+        struct link_mix cur;
+        if (bpf_map_lookup_elem(fd, &link, &cur) != 0)
+            continue;
+        __u64 ro = cur.read_only_ns - last[link].read_only_ns;
+        __u64 wo = cur.write_only_ns - last[link].write_only_ns;
+        __u64 both = cur.overlap_ns - last[link].overlap_ns;
+        __u64 paired = cur.paired_dispatches - last[link].paired_dispatches;
+        last[link] = cur;
+        double busy = (double)(ro + wo + both);
+        if (busy == 0)
+            continue;
+        printf("link %u: read+write %5.1f%%  read only %5.1f%%  write only %5.1f%%  "
+               "running %dR/%dW  paired dispatches %llu\n", link,
+               100.0 * both / busy, 100.0 * ro / busy, 100.0 * wo / busy,
+               cur.readers, cur.writers, (unsigned long long)paired);
+    }
+}
+
+/* Task runs by migration distance, summed over CPUs */
+void print_migration_stats(void) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "migration_stats");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    int ncpus = libbpf_num_possible_cpus();
+    __u64 *values = calloc(ncpus, sizeof(__u64));
+    if (!values)
+        return;
+
+    printf("Task runs by migration distance:");
+    for (__u32 i = 0; i < NR_MIG_STATS; i++) {
+        unsigned long long total = 0;
+        if (bpf_map_lookup_elem(fd, &i, values) == 0) {
+            for (int cpu = 0; cpu < ncpus; cpu++)
+                total += values[cpu];
+        }
+        printf("%s %s %llu", i ? "," : "", migration_stat_names[i], total);
+    }
+    printf("\n");
+    free(values);
+}
+
+/*
+ * Per-cgroup weights and CPU usage since the last call. The cgroup id is
+ * the inode number of its directory (`ls -id /sys/fs/cgroup/...`); id 0 is
+ * the overflow slot shared by top-level cgroups that found no free slot.
+ * Cgroups sharing a slot are reported as a warning.
+ */
+void print_cgroup_stats(struct bandwidth_config *config) {
+    static __u64 last_runtime[MAX_CGROUPS];
+    static __u64 last_cgid[MAX_CGROUPS];
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "cgrp_slots");
+    if (!map)
+        return;
+
+    int fd = bpf_map__fd(map);
+    int header = 0;
+    unsigned int borrowers = 0;
+    for (__u32 slot = 0; slot < MAX_CGROUPS; slot++) {
+        struct cgrp_slot cg;
+        if (bpf_map_lookup_elem(fd, &slot, &cg) != 0 || !cg.used)
+            continue;
+        borrowers += cg.nr_borrowers;
+        if (last_cgid[slot] != cg.cgid) {
+            last_cgid[slot] = cg.cgid;
+            last_runtime[slot] = cg.runtime_ns;
+        }
+        __u64 delta = cg.runtime_ns - last_runtime[slot];
+        last_runtime[slot] = cg.runtime_ns;
+        if (!delta)
+            continue;
+        if (!header) {
+            printf("%-10s %6s %8s %8s\n", "cgroup", "weight", "share%", "cpu%");
+            header = 1;
+        }
+        char name[24];
+        if (cg.cgid)
+            snprintf(name, sizeof(name), "%llu", (unsigned long long)cg.cgid);
+        else
+            snprintf(name, sizeof(name), "overflow");
+        printf("%-10s %6u %8.1f %8.1f\n", name, cg.weight,
+               100.0 * cg.hweight / HWEIGHT_ONE,
+               100.0 * delta / (config->monitor_interval * 1e9));
+    }
+    if (borrowers)
+        printf("Warning: %u cgroups have no slot of their own (limit %d) and share "
+               "an ancestor's or the overflow slot\n", borrowers, MAX_CGROUPS - 1);
+}
+
 int spawn_bandwidth_test(struct bandwidth_config *config) {
     char cmd[512];
     pid_t pid;
@@ -190,6 +798,14 @@ void monitor_performance(struct bandwidth_config *config) {
     while (running) {
         sleep(config->monitor_interval);
         print_scheduler_stats();
+        print_cgroup_stats(config);
+        print_migration_stats();
+        if (coschedule_rw)
+            print_link_mix_stats();
+        if (config->enable_resctrl) {
+            assign_resctrl_classes(config);
+            print_resctrl_stats(config);
+        }
     }
 }
 
@@ -202,6 +818,12 @@ void print_usage(const char *prog_name) {
     printf("  -R, --read-ratio=RATIO  Read thread ratio 0.0-1.0 (default: 0.6)\n");
     printf("  -i, --interval=SEC      Monitoring interval in seconds (default: 5)\n");
     printf("  -T, --test              Spawn bandwidth test automatically\n");
+    printf("  -C                      Co-schedule readers and writers to keep both CXL link directions busy\n");
+    printf("  -G                      Put reader/writer tasks in resctrl groups cxl_read/cxl_write\n");
+    printf("  -L READ,WRITE           L3 way masks (hex) of the reader and writer groups\n");
+    printf("  -M READ,WRITE           MBA percentages of the reader and writer groups\n");
+    printf("  -P PATH                 resctrl mount point (default: /sys/fs/resctrl)\n");
+    printf("  -m FILE                 Bandwidth/latency model from script/fit_perf_model.py\n");
     printf("  -h, --help              Show this help message\n");
 }
 
@@ -213,6 +835,8 @@ int main(int argc, char **argv) {
         .num_threads = 20,
         .read_ratio = 0.6,
         .monitor_interval = 5,
+        .resctrl_root = RESCTRL_DEFAULT_ROOT,
+        .classes = {{.name = "cxl_read"}, {.name = "cxl_write"}},
     };
     
     int spawn_test = 0;
@@ -226,7 +850,7 @@ int main(int argc, char **argv) {
     }
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "r:w:t:R:i:Th")) != -1) {
+    while ((opt = getopt(argc, argv, "r:w:t:R:i:TCGL:M:P:m:h")) != -1) {
         switch (opt) {
             case 'r':
                 config.max_read_bandwidth = atoi(optarg);
@@ -250,6 +874,34 @@ int main(int argc, char **argv) {
             case 'T':
                 spawn_test = 1;
                 break;
+            case 'C':
+                coschedule_rw = 1;
+                break;
+            case 'G':
+                config.enable_resctrl = 1;
+                break;
+            case 'L':
+                if (sscanf(optarg, "%llx,%llx", &config.classes[0].l3_mask,
+                           &config.classes[1].l3_mask) != 2) {
+                    fprintf(stderr, "L3 masks must be given as READ,WRITE\n");
+                    exit(1);
+                }
+                break;
+            case 'M':
+                if (sscanf(optarg, "%d,%d", &config.classes[0].mba_percent,
+                           &config.classes[1].mba_percent) != 2 ||
+                    config.classes[0].mba_percent < 1 || config.classes[0].mba_percent > 100 ||
+                    config.classes[1].mba_percent < 1 || config.classes[1].mba_percent > 100) {
+                    fprintf(stderr, "MBA percentages must be given as READ,WRITE in 1-100\n");
+                    exit(1);
+                }
+                break;
+            case 'P':
+                config.resctrl_root = optarg;
+                break;
+            case 'm':
+                perf_model_file = optarg;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 exit(0);
@@ -272,6 +924,12 @@ int main(int argc, char **argv) {
         return 1;
     }
     
+    setup_cpu_topology();
+    setup_cpu_links();
+    setup_llc_miss_events();
+    if (perf_model_file)
+        load_perf_model(perf_model_file);
+
     // Configure bandwidth limits
     if (configure_bandwidth_limits(&config) != 0) {
         fprintf(stderr, "Failed to configure bandwidth limits\n");
@@ -279,11 +937,23 @@ int main(int argc, char **argv) {
         return 1;
     }
     
+    if (config.enable_resctrl) {
+        if (!bpf_object__find_map_by_name(obj, "memory_patterns"))
+            fprintf(stderr, "Warning: %s has no memory_patterns map, "
+                    "tasks will not be classified into resctrl groups\n", bpf_obj_file);
+        if (setup_resctrl_classes(&config) != 0) {
+            cleanup_resctrl_classes();
+            unload_scheduler();
+            return 1;
+        }
+    }
+
     // Spawn bandwidth test if requested
     if (spawn_test) {
         int test_pid = spawn_bandwidth_test(&config);
         if (test_pid < 0) {
             fprintf(stderr, "Failed to spawn bandwidth test\n");
+            cleanup_resctrl_classes();
             unload_scheduler();
             return 1;
         }
@@ -294,6 +964,7 @@ int main(int argc, char **argv) {
     monitor_performance(&config);
     
     // Cleanup
+    cleanup_resctrl_classes();
     unload_scheduler();
     printf("Scheduler stopped.\n");
     
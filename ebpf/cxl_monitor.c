@@ -0,0 +1,293 @@
+/*
+ * CXL per-class monitor
+ *
+ * Loads cxl_monitoring.bpf.o, opens the per-CPU LLC read/write miss
+ * counters it samples at every context switch, and once per interval reads
+ * the in-kernel (task class, cgroup slot) aggregates with a single batch
+ * lookup. Works without sched_ext.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+
+/* Must match cxl_monitoring.bpf.c */
+#define MAX_CGRP_SLOTS 64
+#define NR_MON_CLASSES 5
+#define NR_CELLS (NR_MON_CLASSES * MAX_CGRP_SLOTS)
+
+static const char *class_names[NR_MON_CLASSES] = {
+    "idle", "vectordb", "kworker", "regular", "bandwidth",
+};
+
+struct class_stats {
+    __u64 oncpu_ns;
+    __u64 switches;
+    __u64 read_bytes;
+    __u64 write_bytes;
+};
+
+static volatile int running = 1;
+
+static void signal_handler(int sig) {
+    running = 0;
+}
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [OPTIONS] [eBPF_object_file]\n", prog_name);
+    printf("Options:\n");
+    printf("  -i, --interval=SEC   Reporting interval in seconds (default: 1)\n");
+    printf("  -d, --duration=SEC   Stop after SEC seconds (default: until Ctrl-C)\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("\nExamples:\n");
+    printf("  sudo %s                          # cxl_monitoring.bpf.o, 1s interval\n", prog_name);
+    printf("  sudo %s -i 5 -d 60               # 5s interval for one minute\n", prog_name);
+}
+
+/*
+ * Open one counter per CPU for `config` (a PERF_TYPE_HW_CACHE event) and
+ * store the fds in `map_name`. Returns the number of CPUs covered.
+ */
+static int open_miss_events(struct bpf_object *obj, const char *map_name, __u64 config,
+                            int *fds, int ncpus) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, map_name);
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HW_CACHE,
+        .size = sizeof(attr),
+        .config = config,
+    };
+    int opened = 0;
+
+    if (!map)
+        return 0;
+    for (int cpu = 0; cpu < ncpus; cpu++) {
+        fds[cpu] = syscall(__NR_perf_event_open, &attr, -1, cpu, -1, 0);
+        if (fds[cpu] < 0)
+            continue;
+        __u32 key = cpu;
+        if (bpf_map_update_elem(bpf_map__fd(map), &key, &fds[cpu], BPF_ANY) == 0)
+            opened++;
+    }
+    return opened;
+}
+
+/*
+ * Read every cell of the per-CPU class_stats array with batch lookups
+ * (one call unless the kernel returns a partial batch) and sum the CPUs.
+ */
+static int read_class_stats(int fd, int ncpus, struct class_stats *totals) {
+    static __u32 keys[NR_CELLS];
+    static struct class_stats *values;
+    __u32 out_batch, count, done = 0;
+    void *in_batch = NULL;
+    int err;
+
+    if (!values) {
+        values = calloc((size_t)NR_CELLS * ncpus, sizeof(struct class_stats));
+        if (!values)
+            return -ENOMEM;
+    }
+    memset(totals, 0, NR_CELLS * sizeof(*totals));
+
+    while (done < NR_CELLS) {
+        count = NR_CELLS - done;
+        err = bpf_map_lookup_batch(fd, in_batch, &out_batch, keys + done,
+                                   values + (size_t)done * ncpus, &count, NULL);
+        if (err && errno != ENOENT)
+            return -errno;
+        done += count;
+        if (err || count == 0)
+            break;
+        in_batch = &out_batch;
+    }
+
+    for (__u32 i = 0; i < done; i++) {
+        __u32 cell = keys[i];
+        if (cell >= NR_CELLS)
+            continue;
+        for (int cpu = 0; cpu < ncpus; cpu++) {
+            struct class_stats *v = &values[(size_t)i * ncpus + cpu];
+            totals[cell].oncpu_ns += v->oncpu_ns;
+            totals[cell].switches += v->switches;
+            totals[cell].read_bytes += v->read_bytes;
+            totals[cell].write_bytes += v->write_bytes;
+        }
+    }
+    return 0;
+}
+
+/* slot -> cgroup id from the cgroup_slots map */
+static void read_cgroup_ids(struct bpf_object *obj, __u64 *cgids) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, "cgroup_slots");
+    __u64 key, next_key, *prev = NULL;
+    __u32 slot;
+
+    if (!map)
+        return;
+    int fd = bpf_map__fd(map);
+    while (bpf_map_get_next_key(fd, prev, &next_key) == 0) {
+        key = next_key;
+        prev = &key;
+        if (bpf_map_lookup_elem(fd, &key, &slot) == 0 && slot < MAX_CGRP_SLOTS)
+            cgids[slot] = key;
+    }
+}
+
+int main(int argc, char **argv) {
+    static struct option long_options[] = {
+        {"interval", required_argument, 0, 'i'},
+        {"duration", required_argument, 0, 'd'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+    const char *obj_file = "cxl_monitoring.bpf.o";
+    int interval = 1, duration = 0, opt;
+
+    while ((opt = getopt_long(argc, argv, "i:d:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                interval = atoi(optarg);
+                if (interval < 1) {
+                    fprintf(stderr, "Interval must be at least 1 second\n");
+                    return 1;
+                }
+                break;
+            case 'd':
+                duration = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+        obj_file = argv[optind];
+
+    struct rlimit rlim = {RLIM_INFINITY, RLIM_INFINITY};
+    setrlimit(RLIMIT_MEMLOCK, &rlim);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    struct bpf_object *obj = bpf_object__open_file(obj_file, NULL);
+    if (libbpf_get_error(obj)) {
+        fprintf(stderr, "Failed to open %s\n", obj_file);
+        return 1;
+    }
+    if (bpf_object__load(obj)) {
+        fprintf(stderr, "Failed to load %s\n", obj_file);
+        bpf_object__close(obj);
+        return 1;
+    }
+
+    int ncpus = libbpf_num_possible_cpus();
+    int *read_fds = calloc(ncpus, sizeof(int));
+    int *write_fds = calloc(ncpus, sizeof(int));
+    struct class_stats *cur = calloc(NR_CELLS, sizeof(*cur));
+    struct class_stats *last = calloc(NR_CELLS, sizeof(*last));
+    __u64 cgids[MAX_CGRP_SLOTS] = {0};
+    struct bpf_link *links[4];
+    int nr_links = 0, err = 0;
+    if (!read_fds || !write_fds || !cur || !last) {
+        fprintf(stderr, "Out of memory\n");
+        err = 1;
+        goto cleanup;
+    }
+
+    /* LLC-load-misses / LLC-store-misses, as in perf list */
+    int reads = open_miss_events(obj, "read_miss_events",
+                                 PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                                 read_fds, ncpus);
+    int writes = open_miss_events(obj, "write_miss_events",
+                                  PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                                  write_fds, ncpus);
+    if (!reads || !writes)
+        fprintf(stderr, "Warning: LLC %s miss counters unavailable, bytes will read 0\n",
+                !reads && !writes ? "read/write" : !reads ? "read" : "write");
+
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, obj) {
+        if (nr_links >= (int)(sizeof(links) / sizeof(links[0])))
+            break;
+        struct bpf_link *link = bpf_program__attach(prog);
+        if (libbpf_get_error(link)) {
+            fprintf(stderr, "Failed to attach %s\n", bpf_program__name(prog));
+            err = 1;
+            goto cleanup;
+        }
+        links[nr_links++] = link;
+    }
+
+    struct bpf_map *stats_map = bpf_object__find_map_by_name(obj, "class_stats");
+    if (!stats_map) {
+        fprintf(stderr, "%s has no class_stats map\n", obj_file);
+        err = 1;
+        goto cleanup;
+    }
+    int stats_fd = bpf_map__fd(stats_map);
+
+    printf("Monitoring %d CPUs every %d s (Ctrl-C to stop)\n", ncpus, interval);
+    for (int elapsed = 0; running && (!duration || elapsed < duration); elapsed += interval) {
+        sleep(interval);
+        int ret = read_class_stats(stats_fd, ncpus, cur);
+        if (ret) {
+            fprintf(stderr, "Batch lookup failed: %s\n", strerror(-ret));
+            err = 1;
+            break;
+        }
+        read_cgroup_ids(obj, cgids);
+
+        printf("\n%-10s %-12s %8s %12s %12s %12s\n", "class", "cgroup", "cpu%",
+               "switches/s", "read MB/s", "write MB/s");
+        for (int cell = 0; cell < NR_CELLS; cell++) {
+            struct class_stats d = {
+                .oncpu_ns = cur[cell].oncpu_ns - last[cell].oncpu_ns,
+                .switches = cur[cell].switches - last[cell].switches,
+                .read_bytes = cur[cell].read_bytes - last[cell].read_bytes,
+                .write_bytes = cur[cell].write_bytes - last[cell].write_bytes,
+            };
+            if (!d.switches)
+                continue;
+            int slot = cell % MAX_CGRP_SLOTS;
+            char cgroup[24];
+            if (slot == 0)
+                snprintf(cgroup, sizeof(cgroup), "other");
+            else
+                snprintf(cgroup, sizeof(cgroup), "%llu", (unsigned long long)cgids[slot]);
+            double mb = 1024.0 * 1024.0 * interval;
+            printf("%-10s %-12s %8.1f %12.0f %12.1f %12.1f\n",
+                   class_names[cell / MAX_CGRP_SLOTS], cgroup,
+                   100.0 * d.oncpu_ns / (interval * 1e9), (double)d.switches / interval,
+                   d.read_bytes / mb, d.write_bytes / mb);
+        }
+        memcpy(last, cur, NR_CELLS * sizeof(*cur));
+    }
+
+cleanup:
+    while (nr_links > 0)
+        bpf_link__destroy(links[--nr_links]);
+    for (int cpu = 0; cpu < ncpus && read_fds && write_fds; cpu++) {
+        if (read_fds[cpu] > 0)
+            close(read_fds[cpu]);
+        if (write_fds[cpu] > 0)
+            close(write_fds[cpu]);
+    }
+    free(read_fds);
+    free(write_fds);
+    free(cur);
+    free(last);
+    bpf_object__close(obj);
+    return err;
+}
@@ -2,6 +2,13 @@
 /*
  * CXL bandwidth monitoring using tracepoints
  * This is a fallback implementation that doesn't require sched_ext
+ *
+ * Everything is aggregated in the kernel: on every context switch the time
+ * since the previous switch, and the LLC read/write misses counted by
+ * per-CPU perf events in between, are charged to the outgoing task's
+ * (class, cgroup slot) cell of a per-CPU array. Memory use is fixed and no
+ * event is streamed; cxl_monitor reads the whole array with one batch
+ * lookup per interval.
  */
 
 #include "vmlinux.h"
@@ -10,93 +17,155 @@
 
 char _license[] SEC("license") = "GPL";
 
-#define MAX_TASKS 1024
+#define MAX_CPUS 1024
+#define MAX_CGRP_SLOTS 64        // slot 0 collects cgroups beyond the limit
+#define CACHE_LINE_BYTES 64
 
-struct task_stats {
-    u64 total_runtime;
-    u64 total_switches;
-    u32 pid;
-    u32 last_cpu;
-    char comm[16];
+/* Task classes, numbered like enum task_type of cxl_pmu_simple.bpf.c */
+enum monitor_class {
+    MON_CLASS_IDLE = 0,          // the idle task
+    MON_CLASS_VECTORDB,
+    MON_CLASS_KWORKER,
+    MON_CLASS_REGULAR,
+    MON_CLASS_BANDWIDTH,
+    NR_MON_CLASSES,
+};
+
+struct class_stats {
+    u64 oncpu_ns;
+    u64 switches;                // times a task of the cell was switched out
+    u64 read_bytes;              // LLC read misses x 64
+    u64 write_bytes;             // LLC write misses x 64
+};
+
+/* Counter snapshot at the last switch on this CPU */
+struct cpu_snapshot {
+    u64 switch_ns;
+    u64 read_misses;
+    u64 write_misses;
 };
 
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, NR_MON_CLASSES * MAX_CGRP_SLOTS);
+    __type(key, u32);            // class * MAX_CGRP_SLOTS + cgroup slot
+    __type(value, struct class_stats);
+} class_stats SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, u32);
+    __type(value, struct cpu_snapshot);
+} cpu_snapshot SEC(".maps");
+
+/* cgroup id -> slot, assigned on first sight */
 struct {
     __uint(type, BPF_MAP_TYPE_HASH);
-    __uint(max_entries, MAX_TASKS);
-    __type(key, u32);  // PID
-    __type(value, struct task_stats);
-} task_monitor SEC(".maps");
+    __uint(max_entries, MAX_CGRP_SLOTS);
+    __type(key, u64);
+    __type(value, u32);
+} cgroup_slots SEC(".maps");
 
+/* Per-CPU LLC read-miss and write-miss counters, opened by cxl_monitor */
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
-    __uint(max_entries, 64);  // Max CPUs
+    __uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
+    __uint(max_entries, MAX_CPUS);
     __type(key, u32);
-    __type(value, u64);       // CPU usage counter
-} cpu_usage SEC(".maps");
+    __type(value, u32);
+} read_miss_events SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
+    __uint(max_entries, MAX_CPUS);
+    __type(key, u32);
+    __type(value, u32);
+} write_miss_events SEC(".maps");
+
+static u32 next_cgroup_slot = 1;
+
+static __always_inline u32 classify_comm(const char *comm)
+{
+    if ((comm[0] == 'd' && comm[1] == 'o' && comm[2] == 'u' && comm[3] == 'b') ||
+        (comm[0] == 'm' && comm[1] == 'l' && comm[2] == 'c') ||
+        (comm[0] == 's' && comm[1] == 't' && comm[2] == 'r' && comm[3] == 'e'))
+        return MON_CLASS_BANDWIDTH;
+    if (comm[0] == 'k' && comm[1] == 'w' && comm[2] == 'o' && comm[3] == 'r')
+        return MON_CLASS_KWORKER;
+    if ((comm[0] == 'v' && comm[1] == 'e' && comm[2] == 'c' && comm[3] == 't') ||
+        (comm[0] == 'f' && comm[1] == 'a' && comm[2] == 'i' && comm[3] == 's'))
+        return MON_CLASS_VECTORDB;
+    return MON_CLASS_REGULAR;
+}
+
+static __always_inline u32 cgroup_slot(u64 cgid)
+{
+    u32 *slot = bpf_map_lookup_elem(&cgroup_slots, &cgid);
+    u32 new_slot;
+
+    if (slot)
+        return *slot;
+    if (next_cgroup_slot >= MAX_CGRP_SLOTS)
+        return 0;
+    new_slot = __sync_fetch_and_add(&next_cgroup_slot, 1);
+    if (new_slot >= MAX_CGRP_SLOTS)
+        return 0;
+    if (bpf_map_update_elem(&cgroup_slots, &cgid, &new_slot, BPF_NOEXIST) != 0) {
+        /* Lost a race for this cgroup; the slot number is wasted */
+        slot = bpf_map_lookup_elem(&cgroup_slots, &cgid);
+        return slot ? *slot : 0;
+    }
+    return new_slot;
+}
+
+static __always_inline u64 read_counter(void *events)
+{
+    struct bpf_perf_event_value value = {};
+
+    if (bpf_perf_event_read_value(events, BPF_F_CURRENT_CPU, &value, sizeof(value)))
+        return 0;
+    return value.counter;
+}
 
 SEC("tp/sched/sched_switch")
 int trace_sched_switch(struct trace_event_raw_sched_switch *ctx)
 {
-    u32 prev_pid = ctx->prev_pid;
-    u32 next_pid = ctx->next_pid;
-    u32 cpu = bpf_get_smp_processor_id();
-    
-    // Update CPU usage
-    u64 *cpu_count = bpf_map_lookup_elem(&cpu_usage, &cpu);
-    if (cpu_count) {
-        __sync_fetch_and_add(cpu_count, 1);
-    } else {
-        u64 initial = 1;
-        bpf_map_update_elem(&cpu_usage, &cpu, &initial, BPF_ANY);
-    }
-    
-    // Update task that's being scheduled out
-    if (prev_pid > 0) {
-        struct task_stats *stats = bpf_map_lookup_elem(&task_monitor, &prev_pid);
-        if (stats) {
-            stats->total_switches++;
-            stats->last_cpu = cpu;
-        } else {
-            struct task_stats new_stats = {0};
-            new_stats.pid = prev_pid;
-            new_stats.total_switches = 1;
-            new_stats.last_cpu = cpu;
-            bpf_get_current_comm(new_stats.comm, sizeof(new_stats.comm));
-            bpf_map_update_elem(&task_monitor, &prev_pid, &new_stats, BPF_ANY);
-        }
-    }
-    
-    // Update task that's being scheduled in
-    if (next_pid > 0) {
-        struct task_stats *stats = bpf_map_lookup_elem(&task_monitor, &next_pid);
-        if (stats) {
-            stats->total_runtime++;
-            stats->last_cpu = cpu;
+    u32 zero = 0, class, key;
+    u64 now = bpf_ktime_get_ns();
+    u64 reads = read_counter(&read_miss_events);
+    u64 writes = read_counter(&write_miss_events);
+    struct cpu_snapshot *snap;
+    struct class_stats *stats;
+    char comm[16];
+
+    snap = bpf_map_lookup_elem(&cpu_snapshot, &zero);
+    if (!snap)
+        return 0;
+
+    /* The first switch on a CPU only takes the snapshot */
+    if (snap->switch_ns) {
+        /* The tracepoint runs in the outgoing task's context */
+        if (ctx->prev_pid == 0) {
+            class = MON_CLASS_IDLE;
         } else {
-            struct task_stats new_stats = {0};
-            new_stats.pid = next_pid;
-            new_stats.total_runtime = 1;
-            new_stats.last_cpu = cpu;
-            bpf_get_current_comm(new_stats.comm, sizeof(new_stats.comm));
-            bpf_map_update_elem(&task_monitor, &next_pid, &new_stats, BPF_ANY);
+            bpf_get_current_comm(comm, sizeof(comm));
+            class = classify_comm(comm);
         }
-    }
-    
-    return 0;
-}
+        key = class * MAX_CGRP_SLOTS + cgroup_slot(bpf_get_current_cgroup_id());
 
-SEC("tp/sched/sched_wakeup")
-int trace_sched_wakeup(void *ctx)
-{
-    u32 pid = bpf_get_current_pid_tgid() >> 32;
-    
-    if (pid > 0) {
-        struct task_stats *stats = bpf_map_lookup_elem(&task_monitor, &pid);
+        stats = bpf_map_lookup_elem(&class_stats, &key);
         if (stats) {
-            // Task is waking up - could use this for scheduling hints
-            stats->total_runtime++;
+            stats->oncpu_ns += now - snap->switch_ns;
+            stats->switches++;
+            if (reads >= snap->read_misses)
+                stats->read_bytes += (reads - snap->read_misses) * CACHE_LINE_BYTES;
+            if (writes >= snap->write_misses)
+                stats->write_bytes += (writes - snap->write_misses) * CACHE_LINE_BYTES;
         }
     }
-    
+
+    snap->switch_ns = now;
+    snap->read_misses = reads;
+    snap->write_misses = writes;
     return 0;
-}
\ No newline at end of file
+}
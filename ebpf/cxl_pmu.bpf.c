@@ -14,6 +14,8 @@
  * - MoE VectorDB workload-aware scheduling
  * - Dynamic kworker promotion/demotion based on memory patterns
  * - Bandwidth-aware scheduling for read/write intensive tasks
+ * - Migration-cost-aware placement from per-task LLC miss footprints
+ * - Placement that avoids memory nodes the fitted host model shows saturated
  */
 
 /* 
@@ -21,6 +23,7 @@
  * without any additional guards which can cause redefinition issues
  */
 #include <scx/common.bpf.h>
+#include "perf_model.h"
 
 char _license[] SEC("license") = "GPL";
 
@@ -34,6 +37,33 @@ char _license[] SEC("license") = "GPL";
 #define READ_INTENSIVE_DSQ_ID 1
 #define WRITE_INTENSIVE_DSQ_ID 2
 
+/*
+ * A task's cache footprint is the EWMA of the LLC misses it takes per run
+ * (lines it had to pull in). The part still hot decays linearly to zero
+ * over CACHE_HOT_DECAY_NS off-CPU; refilling it costs REFILL_NS_* per line
+ * depending on how far the task moves. Moves costing more than
+ * MIGRATION_COST_NS are refused unless an idle CPU is available.
+ */
+#define CACHE_HOT_DECAY_NS (5 * 1000 * 1000)   // 5ms
+#define MIGRATION_COST_NS (500 * 1000)         // 500us, like sched_migration_cost
+#define REFILL_NS_SAME_LLC 1
+#define REFILL_NS_CROSS_LLC 10
+#define REFILL_NS_CROSS_NUMA 30                // remote DRAM / CXL refill
+#define BOUNCING_MIGRATIONS 3                  // doubles the penalty from here on
+
+/*
+ * Memory traffic of a NUMA node is the LLC misses of its CPUs (64B lines)
+ * per NODE_LOAD_WINDOW_NS. Misses are sampled at context switches, so the
+ * misses of one run are spread over the windows it spanned. With a fitted
+ * perf_model (controller -m), a
+ * node whose latency at that traffic already exceeds the far-memory
+ * threshold is saturated: memory-heavy tasks (more than
+ * MEMORY_HEAVY_LINES misses per run) are not moved onto it from a node
+ * that is not.
+ */
+#define NODE_LOAD_WINDOW_NS (10 * 1000 * 1000) // 10ms
+#define MEMORY_HEAVY_LINES 1024                // 64KB missed per run
+
 /* Task types for scheduling decisions */
 enum task_type {
 	TASK_TYPE_UNKNOWN = 0,
@@ -82,14 +112,50 @@ struct cxl_pmu_metrics {
 	u64 last_update_time;
 };
 
+/* Migration distance between two CPUs, also the migration_stats index */
+enum migration_distance {
+	MIG_SAME_CPU = 0,
+	MIG_SAME_LLC,
+	MIG_CROSS_LLC,
+	MIG_CROSS_NUMA,
+	MIG_KEPT_HOT,        // select_cpu kept a cache-hot task on prev_cpu
+	MIG_KEPT_SATURATED,  // select_cpu kept a task off a saturated node
+	NR_MIG_STATS,
+};
+
+/* CPU topology, filled in by the controller from sysfs */
+struct cpu_topology {
+	u32 llc_id;
+	u32 node;
+	bool valid;
+};
+
+/* Memory traffic of one NUMA node */
+struct node_load {
+	u64 window_start_ns;
+	u64 window_lines;        // LLC misses in the current window
+	u64 prev_start_ns;       // last complete window is [prev_start_ns, window_start_ns)
+	u64 prev_lines;          // its misses, still growing from runs that spanned it
+	u64 load_mbps;           // traffic of the last complete window
+};
+
+/* This CPU's LLC miss counter at its last context switch */
+struct llc_sample {
+	u64 counter;
+	u64 time_ns;
+};
+
 /* Task context for scheduling decisions */
 struct task_ctx {
 	enum task_type type;
 	struct memory_access_pattern mem_pattern;
 	u32 priority_boost;      // temporary priority adjustment
 	u32 cpu_affinity_mask;   // preferred CPUs based on CXL topology
-	u64 last_scheduled_time;
+	u64 last_scheduled_time; // when the task last stopped running
 	u32 consecutive_migrations;
+	s32 last_cpu;            // CPU of the previous run, -1 before the first
+	u64 footprint_lines;     // EWMA of LLC misses per run
+	u64 llc_miss_start;      // LLC miss counter when the task started running
 	bool is_memory_intensive;
 	bool needs_promotion;    // for kworkers
 	bool is_bandwidth_critical; // for bandwidth-sensitive tasks
@@ -139,6 +205,62 @@ struct {
 	__type(value, u64); // Available bandwidth quota
 } bandwidth_quota SEC(".maps");
 
+/* CPU id -> LLC and NUMA node */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, MAX_CPUS);
+	__type(key, u32);
+	__type(value, struct cpu_topology);
+} cpu_topology SEC(".maps");
+
+/* Per-CPU LLC miss counters (PERF_COUNT_HW_CACHE_MISSES), opened by the
+ * controller */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
+	__uint(max_entries, MAX_CPUS);
+	__type(key, u32);
+	__type(value, u32);
+} llc_miss_events SEC(".maps");
+
+/* Task runs by migration distance, plus refused migrations */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, NR_MIG_STATS);
+	__type(key, u32);
+	__type(value, u64);
+} migration_stats SEC(".maps");
+
+/* Fitted bandwidth/latency model, one entry per (CPU node, memory node) */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, PERF_MODEL_MAX_NODES * PERF_MODEL_MAX_NODES);
+	__type(key, u32);
+	__type(value, struct perf_model_entry);
+} perf_model SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, u32);
+	__type(value, struct perf_model_meta);
+} perf_model_meta SEC(".maps");
+
+static const u32 perf_model_load_pct[PERF_MODEL_LOAD_POINTS] = PERF_MODEL_LOAD_PCT;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, PERF_MODEL_MAX_NODES);
+	__type(key, u32);
+	__type(value, struct node_load);
+} node_load SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, u32);
+	__type(value, struct llc_sample);
+} llc_miss_last SEC(".maps");
+
 /* Global scheduler state */
 const volatile u32 nr_cpus = 1;
 
@@ -277,6 +399,127 @@ static inline void __attribute__((unused)) update_damon_data(u32 pid, struct tas
 	}
 }
 
+static __always_inline u32 lerp_u32(u64 x, u64 x0, u64 x1, u32 y0, u32 y1)
+{
+	if (x <= x0 || x1 <= x0)
+		return y0;
+	if (x >= x1)
+		return y1;
+	return (u32)((y0 * (x1 - x) + y1 * (x - x0)) / (x1 - x0));
+}
+
+/* NUMA node of `cpu`; false without topology information */
+static __always_inline bool cpu_node(s32 cpu, u32 *node)
+{
+	u32 key = cpu;
+	struct cpu_topology *topo = bpf_map_lookup_elem(&cpu_topology, &key);
+
+	if (!topo || !topo->valid)
+		return false;
+	*node = topo->node & (PERF_MODEL_MAX_NODES - 1);
+	return true;
+}
+
+/* Model entry for the memory node tasks on `node` use */
+static struct perf_model_entry *lookup_perf_model(struct perf_model_meta *meta, u32 node)
+{
+	struct perf_model_entry *model;
+	u32 mem, key;
+
+	mem = meta->home_mem_node[node] < 0 ? node :
+	      (u32)meta->home_mem_node[node] & (PERF_MODEL_MAX_NODES - 1);
+	key = node * PERF_MODEL_MAX_NODES + mem;
+	model = bpf_map_lookup_elem(&perf_model, &key);
+	return model && model->peak_mbps ? model : NULL;
+}
+
+/* Predicted latency with the memory node carrying `load_mbps` */
+static u32 model_latency(struct perf_model_entry *model, u64 load_mbps)
+{
+	u64 pct;
+	u32 i;
+
+	if (!model->peak_mbps)
+		return model->idle_latency_ns;
+	pct = load_mbps * 100 / model->peak_mbps;
+	for (i = 1; i < PERF_MODEL_LOAD_POINTS; i++) {
+		if (pct <= perf_model_load_pct[i])
+			return lerp_u32(pct, perf_model_load_pct[i - 1], perf_model_load_pct[i],
+					model->lat_ns[i - 1], model->lat_ns[i]);
+	}
+	return model->lat_ns[PERF_MODEL_LOAD_POINTS - 1];
+}
+
+/* The model puts `cpu`'s node, at its measured traffic, past far-memory
+ * latency; never true without a model */
+static bool node_saturated(s32 cpu)
+{
+	struct perf_model_entry *model;
+	struct perf_model_meta *meta;
+	struct node_load *load;
+	u32 zero = 0, node;
+
+	meta = bpf_map_lookup_elem(&perf_model_meta, &zero);
+	if (!meta || !meta->valid || !meta->cxl_latency_ns || !cpu_node(cpu, &node))
+		return false;
+	model = lookup_perf_model(meta, node);
+	load = bpf_map_lookup_elem(&node_load, &node);
+	if (!model || !load)
+		return false;
+	return model_latency(model, load->load_mbps) > meta->cxl_latency_ns;
+}
+
+/* `lines` scaled by part / whole, whole > 0 and part <= whole */
+static inline u64 prorate(u64 lines, u64 part, u64 whole)
+{
+	return lines * (part * 1024 / whole) / 1024;
+}
+
+/*
+ * Add the `lines` missed on `cpu` during [since, now) to its node and close
+ * the window when due. A run can span several windows: the share of the
+ * lines from before the open window goes to the last complete window, whose
+ * load_mbps is updated, and anything older is dropped.
+ */
+static void node_load_add(s32 cpu, u64 lines, u64 since, u64 now)
+{
+	struct node_load *load;
+	u64 start, prev_start, from, elapsed, prev_lines;
+	u32 node;
+
+	if (!cpu_node(cpu, &node))
+		return;
+	load = bpf_map_lookup_elem(&node_load, &node);
+	if (!load)
+		return;
+
+	start = load->window_start_ns;
+	if (start && since < start && since < now) {
+		prev_start = load->prev_start_ns;
+		from = since < prev_start ? prev_start : since;
+		if (prev_start && from < start) {
+			prev_lines = __sync_add_and_fetch(&load->prev_lines,
+							  prorate(lines, start - from, now - since));
+			load->load_mbps = prev_lines * 64 * 1000 / (start - prev_start);
+		}
+		lines = start < now ? prorate(lines, now - start, now - since) : 0;
+	}
+
+	__sync_fetch_and_add(&load->window_lines, lines);
+	elapsed = now - start;
+	if (start && elapsed < NODE_LOAD_WINDOW_NS)
+		return;
+	/* Only the CPU that wins the swap closes the window */
+	if (!__sync_bool_compare_and_swap(&load->window_start_ns, start, now))
+		return;
+	lines = __sync_lock_test_and_set(&load->window_lines, 0);
+	if (start) {
+		load->prev_start_ns = start;
+		load->prev_lines = lines;
+		load->load_mbps = lines * 64 * 1000 / elapsed;   // bytes/ns = GB/s
+	}
+}
+
 static inline void __attribute__((unused)) update_cxl_pmu_metrics(u32 cpu_id)
 {
 	struct cpu_ctx *ctx;
@@ -411,20 +654,155 @@ static inline u32 __attribute__((unused)) calculate_task_priority(struct task_ct
 	return base_priority;
 }
 
+static inline void count_migration(u32 idx)
+{
+	u64 *count = bpf_map_lookup_elem(&migration_stats, &idx);
+	if (count)
+		(*count)++;
+}
+
+/* CPUs without topology information count as sharing an LLC */
+static inline u32 migration_distance(s32 from, s32 to)
+{
+	struct cpu_topology *a, *b;
+	u32 from_key = from, to_key = to;
+
+	if (from == to)
+		return MIG_SAME_CPU;
+	a = bpf_map_lookup_elem(&cpu_topology, &from_key);
+	b = bpf_map_lookup_elem(&cpu_topology, &to_key);
+	if (!a || !b || !a->valid || !b->valid)
+		return MIG_SAME_LLC;
+	if (a->node != b->node)
+		return MIG_CROSS_NUMA;
+	return a->llc_id != b->llc_id ? MIG_CROSS_LLC : MIG_SAME_LLC;
+}
+
+/* Estimated cost of refilling the task's still-hot lines after a move */
+static inline u64 migration_penalty_ns(struct task_ctx *tctx, u32 distance, u64 now)
+{
+	u64 idle_ns = now - tctx->last_scheduled_time;
+	u64 hot_lines, refill_ns, penalty;
+
+	if (!tctx->footprint_lines || idle_ns >= CACHE_HOT_DECAY_NS)
+		return 0;
+
+	switch (distance) {
+	case MIG_SAME_LLC:
+		refill_ns = REFILL_NS_SAME_LLC;
+		break;
+	case MIG_CROSS_LLC:
+		refill_ns = REFILL_NS_CROSS_LLC;
+		break;
+	case MIG_CROSS_NUMA:
+		refill_ns = REFILL_NS_CROSS_NUMA;
+		break;
+	default:
+		return 0;
+	}
+
+	hot_lines = tctx->footprint_lines * (CACHE_HOT_DECAY_NS - idle_ns) / CACHE_HOT_DECAY_NS;
+	penalty = hot_lines * refill_ns;
+	if (tctx->consecutive_migrations >= BOUNCING_MIGRATIONS)
+		penalty *= 2;
+	return penalty;
+}
+
+/* LLC misses taken by `prev` during its run feed its footprint estimate;
+ * those of the CPU since its last switch feed its node's traffic */
+SEC("tp_btf/sched_switch")
+int BPF_PROG(cxl_sched_switch, bool preempt, struct task_struct *prev,
+	     struct task_struct *next)
+{
+	struct bpf_perf_event_value value = {};
+	struct task_ctx *tctx;
+	struct llc_sample *last;
+	u32 zero = 0;
+
+	if (bpf_perf_event_read_value(&llc_miss_events, BPF_F_CURRENT_CPU,
+				      &value, sizeof(value)))
+		return 0;
+
+	last = bpf_map_lookup_elem(&llc_miss_last, &zero);
+	if (last) {
+		u64 now = bpf_ktime_get_ns();
+
+		if (last->counter && value.counter >= last->counter)
+			node_load_add(bpf_get_smp_processor_id(),
+				      value.counter - last->counter, last->time_ns, now);
+		last->counter = value.counter;
+		last->time_ns = now;
+	}
+
+	tctx = bpf_task_storage_get(&task_ctx_stor, prev, 0, 0);
+	if (tctx && tctx->llc_miss_start && value.counter >= tctx->llc_miss_start) {
+		u64 misses = value.counter - tctx->llc_miss_start;
+		tctx->footprint_lines = (tctx->footprint_lines * 3 + misses) / 4;
+	}
+
+	tctx = bpf_task_storage_get(&task_ctx_stor, next, 0, 0);
+	if (tctx)
+		tctx->llc_miss_start = value.counter;
+	return 0;
+}
+
 /* sched_ext operations */
 
 SEC("struct_ops/cxl_select_cpu")
 s32 cxl_select_cpu(struct task_struct *p, s32 prev_cpu, u64 wake_flags)
 {
-	/* Return -1 to let the kernel choose the CPU */
-	return -1;
+	struct task_ctx *tctx;
+	u64 now = bpf_ktime_get_ns();
+	bool is_idle = false;
+	s32 cpu;
+
+	tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+
+	/* A cache-hot task goes straight back to its idle previous CPU */
+	if (tctx && migration_penalty_ns(tctx, MIG_CROSS_LLC, now) > MIGRATION_COST_NS &&
+	    scx_bpf_test_and_clear_cpu_idle(prev_cpu)) {
+		scx_bpf_dsq_insert(p, SCX_DSQ_LOCAL, SCX_SLICE_DFL, 0);
+		return prev_cpu;
+	}
+
+	cpu = scx_bpf_select_cpu_dfl(p, prev_cpu, wake_flags, &is_idle);
+
+	/* Moving a memory-heavy task onto a saturated node only slows it down */
+	if (tctx && cpu != prev_cpu && tctx->footprint_lines > MEMORY_HEAVY_LINES &&
+	    migration_distance(prev_cpu, cpu) == MIG_CROSS_NUMA &&
+	    node_saturated(cpu) && !node_saturated(prev_cpu)) {
+		/* Let the CPU select_cpu_dfl claimed go back to idle */
+		if (is_idle)
+			scx_bpf_kick_cpu(cpu, SCX_KICK_IDLE);
+		count_migration(MIG_KEPT_SATURATED);
+		if (scx_bpf_test_and_clear_cpu_idle(prev_cpu))
+			scx_bpf_dsq_insert(p, SCX_DSQ_LOCAL, SCX_SLICE_DFL, 0);
+		return prev_cpu;
+	}
+
+	if (is_idle) {
+		scx_bpf_dsq_insert(p, SCX_DSQ_LOCAL, SCX_SLICE_DFL, 0);
+		return cpu;
+	}
+
+	/*
+	 * No idle CPU either way: only move if the refill is cheap. Otherwise
+	 * queue on prev_cpu's local DSQ; enqueue would put the task on the
+	 * shared DSQ, where any CPU could take it.
+	 */
+	if (tctx && cpu != prev_cpu &&
+	    migration_penalty_ns(tctx, migration_distance(prev_cpu, cpu), now) > MIGRATION_COST_NS) {
+		scx_bpf_dsq_insert(p, SCX_DSQ_LOCAL_ON | prev_cpu, SCX_SLICE_DFL, 0);
+		count_migration(MIG_KEPT_HOT);
+		return prev_cpu;
+	}
+	return cpu;
 }
 
 SEC("struct_ops/cxl_enqueue")
 void cxl_enqueue(struct task_struct *p, u64 enq_flags)
 {
-	/* Simple enqueue to default queue */
-	// scx_bpf_dsq_insert(p, FALLBACK_DSQ_ID, SCX_SLICE_DFL, enq_flags);
+	scx_bpf_dsq_insert(p, FALLBACK_DSQ_ID, SCX_SLICE_DFL, enq_flags);
 }
 
 SEC("struct_ops/cxl_dispatch")
@@ -437,19 +815,43 @@ void cxl_dispatch(s32 cpu, struct task_struct *prev)
 SEC("struct_ops/cxl_running")
 void cxl_running(struct task_struct *p)
 {
-	/* Task is running - no action needed */
+	struct task_ctx *tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+	s32 cpu = scx_bpf_task_cpu(p);
+	u32 distance;
+
+	if (!tctx)
+		return;
+
+	if (tctx->last_cpu >= 0) {
+		distance = migration_distance(tctx->last_cpu, cpu);
+		count_migration(distance);
+		if (distance == MIG_SAME_CPU)
+			tctx->consecutive_migrations = 0;
+		else
+			tctx->consecutive_migrations++;
+	}
+	tctx->last_cpu = cpu;
 }
 
 SEC("struct_ops/cxl_stopping")
 void cxl_stopping(struct task_struct *p, bool runnable)
 {
-	/* Task is stopping - no action needed */
+	struct task_ctx *tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+
+	/* Start of the cache-hot window */
+	if (tctx)
+		tctx->last_scheduled_time = bpf_ktime_get_ns();
 }
 
 SEC("struct_ops/cxl_init_task")
 s32 cxl_init_task(struct task_struct *p, struct scx_init_task_args *args)
 {
-	/* Simple task initialization */
+	struct task_ctx *tctx;
+
+	tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, BPF_LOCAL_STORAGE_GET_F_CREATE);
+	if (!tctx)
+		return -ENOMEM;
+	tctx->last_cpu = -1;
 	return 0;
 }
 
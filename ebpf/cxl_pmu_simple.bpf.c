@@ -4,6 +4,7 @@
  */
 
 #include <scx/common.bpf.h>
+#include "task_snapshot.h"
 
 char _license[] SEC("license") = "GPL";
 
@@ -12,6 +13,41 @@ char _license[] SEC("license") = "GPL";
 #define MOE_VECTORDB_THRESHOLD 80
 #define FALLBACK_DSQ_ID 0
 #define MAX_CPU_LOOP 4  // Limit for fixed loop iteration
+#define PF_EXITING 0x00000004
+
+/*
+ * Cgroup fair sharing: every non-root cgroup owns a slot with its own DSQ
+ * and virtual time. Slots are picked by lowest cgroup vtime, tasks inside a
+ * slot by their own vtime, so per-type boosts only reorder tasks within
+ * their cgroup's share. Root cgroup tasks use FALLBACK_DSQ_ID and compete
+ * with the top-level cgroups as one more member of weight ROOT_WEIGHT.
+ * Cgroups beyond the free slots share the slot of their nearest slotted
+ * ancestor; top-level ones share OVERFLOW_SLOT, which has the minimum
+ * weight and is reserved for them.
+ */
+#define MAX_CGROUPS 128
+#define MAX_CGRP_LEVELS 16
+#define CGRP_DSQ_BASE 1          // DSQ of slot i is CGRP_DSQ_BASE + i
+#define CGRP_SLOT_NONE ((u32)-1)
+#define HWEIGHT_ONE (1 << 16)    // hierarchical weight of the whole machine
+#define ROOT_WEIGHT 100          // weight of the root cgroup's own tasks (default cpu.weight)
+#define OVERFLOW_SLOT (MAX_CGROUPS - 1)
+#define OVERFLOW_WEIGHT 1        // minimum cpu.weight
+
+/*
+ * Reader/writer co-scheduling (coschedule_rw): bandwidth readers and
+ * writers of each cgroup wait in per-class DSQs next to the cgroup's own.
+ * Once the cgroup is picked, its reader/writer heads compete with its
+ * other tasks by vtime, and between the two classes the CPU takes the one
+ * under-represented among the tasks running on its CXL link, so both link
+ * directions stay busy without leaving the cgroup's share. CPUs map to
+ * links through cpu_link (the controller uses the NUMA node); unmapped
+ * CPUs share link 0.
+ */
+#define MAX_LINKS 8
+#define RW_SLOT_ROOT MAX_CGROUPS // reader/writer DSQ index of the root cgroup
+#define READER_DSQ_BASE (CGRP_DSQ_BASE + MAX_CGROUPS)   // + slot or RW_SLOT_ROOT
+#define WRITER_DSQ_BASE (READER_DSQ_BASE + MAX_CGROUPS + 1)
 
 /* Simplified task types */
 enum task_type {
@@ -28,6 +64,8 @@ struct memory_pattern {
 	u32 locality_score;
 	u32 access_count;
 	bool is_reader;        // 新增：标识是读线程还是写线程
+	u8 task_type;          // enum task_type, lets the controller map classes to resctrl groups
+	u8 rw_class;           // enum rw_class; RW_NONE until the thread is classified
 };
 
 /* Simplified task context */
@@ -36,6 +74,50 @@ struct task_ctx {
 	u32 priority_boost;
 	bool is_memory_intensive;
 	u32 thread_id;         // 新增：线程ID，用于区分读写线程
+	u32 cgrp_slot;         // cgroup slot, CGRP_SLOT_NONE for the root cgroup
+	u8 rw_running;         // enum rw_class counted in link_mix while running
+	u8 rw_class;           // enum rw_class from the thread name, see rw_class_from_comm()
+	u64 avg_runtime_ns;    // EWMA (1/8) of the time used per run
+};
+
+enum rw_class {
+	RW_NONE = 0,
+	RW_READER,
+	RW_WRITER,
+};
+
+/* Read/write mix of the tasks running on one CXL link */
+struct link_mix {
+	struct bpf_spin_lock lock;
+	s32 readers;           // readers running right now
+	s32 writers;           // writers running right now
+	u64 last_change_ns;
+	u64 read_only_ns;      // time only readers were running
+	u64 write_only_ns;     // time only writers were running
+	u64 overlap_ns;        // time both directions were busy
+	u64 paired_dispatches; // dispatches of the class in the minority
+};
+
+/* Per-cgroup scheduling state, also read by the controller */
+struct cgrp_slot {
+	u64 cgid;              // cgroup id (inode number of the cgroup dir)
+	u64 cvtime;            // cgroup vtime, advances by runtime / hweight
+	u64 task_vtime;        // vtime floor of the tasks in this cgroup
+	u64 runtime_ns;        // total CPU time consumed
+	u32 weight;            // cpu.weight, 1-10000
+	u32 child_weight_sum;  // sum of the slotted children's weights
+	u32 hweight;           // share of the machine, in HWEIGHT_ONE units
+	u32 hweight_gen;       // hweight_gen the cached hweight was computed at
+	s32 parent;            // parent slot, -1 for children of the root
+	bool used;
+	u32 nr_borrowers;      // cgroups without a slot of their own sharing this one
+};
+
+/* Slot lookup by cgroup id; `owned` is false for cgroups borrowing an
+ * ancestor's slot */
+struct cgrp_slot_ref {
+	u32 slot;
+	bool owned;
 };
 
 /* Simplified CPU context */
@@ -67,9 +149,42 @@ struct {
 	__type(value, struct memory_pattern);
 } memory_patterns SEC(".maps");
 
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, MAX_CGROUPS);
+	__type(key, u32);
+	__type(value, struct cgrp_slot);
+} cgrp_slots SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(max_entries, 4096);
+	__type(key, u64);
+	__type(value, struct cgrp_slot_ref);
+} cgrp_slot_refs SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, MAX_CPUS);
+	__type(key, u32);
+	__type(value, u32);
+} cpu_link SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, MAX_LINKS);
+	__type(key, u32);
+	__type(value, struct link_mix);
+} link_mix SEC(".maps");
+
 /* Global state */
 static u64 global_vtime = 0;
 const volatile u32 nr_cpus = 8;  // Fixed for simplicity
+static u64 cvtime_now = 0;       // cvtime of the most recently picked cgroup
+static u64 root_cvtime = 0;      // cvtime of the root cgroup's own tasks
+static u32 root_child_weight_sum = 0;
+static u32 hweight_gen = 1;      // bumped whenever any weight changes
+const volatile bool coschedule_rw = false; // set by the controller (-C)
 
 /* Helper functions - simplified */
 
@@ -102,6 +217,26 @@ static inline bool is_bandwidth_task(struct task_struct *p)
 	       (comm[0] == 's' && comm[1] == 't' && comm[2] == 'r' && comm[3] == 'e');    // stream benchmark
 }
 
+/*
+ * double_bandwidth names its threads "double_bw_rd" and "double_bw_wr".
+ * A thread renames itself after it was first enqueued, so bandwidth tasks
+ * are re-checked until they are classified.
+ */
+static inline u8 rw_class_from_comm(struct task_struct *p)
+{
+	char comm[16];
+	bpf_probe_read_kernel_str(comm, sizeof(comm), p->comm);
+
+	if (comm[0] != 'd' || comm[1] != 'o' || comm[6] != '_' || comm[7] != 'b' ||
+	    comm[8] != 'w' || comm[9] != '_' || comm[12] != '\0')
+		return RW_NONE;
+	if (comm[10] == 'r' && comm[11] == 'd')
+		return RW_READER;
+	if (comm[10] == 'w' && comm[11] == 'r')
+		return RW_WRITER;
+	return RW_NONE;
+}
+
 static inline bool is_kworker_task(struct task_struct *p)
 {
 	char comm[16];
@@ -120,14 +255,11 @@ static inline void update_memory_pattern(u32 pid, struct task_ctx *tctx)
 		new_pattern.last_access_time = current_time;
 		new_pattern.locality_score = 50;
 		new_pattern.access_count = 1;
+		new_pattern.task_type = tctx->type;
 		
-		// 为带宽测试任务设置读写属性
-		if (tctx->type == TASK_TYPE_BANDWIDTH) {
-			// 直接使用线程ID的奇偶性判断读写属性
-			// 偶数线程ID => 读线程
-			// 奇数线程ID => 写线程
-			new_pattern.is_reader = (tctx->thread_id % 2 == 0);
-		}
+		// 为带宽测试任务设置读写属性 (from the thread name)
+		new_pattern.rw_class = tctx->rw_class;
+		new_pattern.is_reader = tctx->rw_class == RW_READER;
 		
 		bpf_map_update_elem(&memory_patterns, &pid, &new_pattern, BPF_ANY);
 		return;
@@ -136,11 +268,11 @@ static inline void update_memory_pattern(u32 pid, struct task_ctx *tctx)
 	// Simple update logic
 	pattern->access_count++;
 	pattern->last_access_time = current_time;
+	pattern->task_type = tctx->type;
 	
-	// 确保读写属性与线程ID奇偶性一致
-	if (tctx->type == TASK_TYPE_BANDWIDTH) {
-		pattern->is_reader = (tctx->thread_id % 2 == 0);
-	}
+	// 读写属性跟随线程名分类
+	pattern->rw_class = tctx->rw_class;
+	pattern->is_reader = tctx->rw_class == RW_READER;
 	
 	// Simple locality score update
 	if (pattern->access_count % 10 == 0) {
@@ -180,6 +312,182 @@ static inline u32 get_task_priority(struct task_ctx *tctx)
 	return base_priority;
 }
 
+static inline struct cgrp_slot *lookup_cgrp_slot(u32 slot)
+{
+	if (slot == CGRP_SLOT_NONE)
+		return NULL;
+	return bpf_map_lookup_elem(&cgrp_slots, &slot);
+}
+
+static inline u32 cgrp_slot_of(struct cgroup *cgrp)
+{
+	struct cgrp_slot_ref *ref;
+	u64 cgid;
+
+	if (!cgrp || cgrp->level == 0)
+		return CGRP_SLOT_NONE;
+	cgid = cgrp->kn->id;
+	ref = bpf_map_lookup_elem(&cgrp_slot_refs, &cgid);
+	return ref ? ref->slot : CGRP_SLOT_NONE;
+}
+
+/*
+ * Hierarchical weight: the product of weight / sibling weight sum along the
+ * path to the root. Cached until the next weight change. Siblings count
+ * whether or not they are runnable, which only matters for cgroups with
+ * different parents; vtime ordering keeps the whole scheme work-conserving.
+ */
+static u32 cgrp_hweight(struct cgrp_slot *cg)
+{
+	struct cgrp_slot *cur = cg, *parent;
+	u64 hweight = HWEIGHT_ONE;
+	u32 gen = hweight_gen, sum, level;
+
+	if (cg->hweight_gen == gen && cg->hweight)
+		return cg->hweight;
+
+	for (level = 0; level < MAX_CGRP_LEVELS; level++) {
+		if (cur->parent < 0) {
+			sum = root_child_weight_sum + ROOT_WEIGHT;
+			hweight = hweight * cur->weight / (sum ? sum : 1);
+			break;
+		}
+		parent = lookup_cgrp_slot(cur->parent);
+		if (!parent)
+			break;
+		sum = parent->child_weight_sum;
+		hweight = hweight * cur->weight / (sum ? sum : 1);
+		cur = parent;
+	}
+
+	cg->hweight = hweight ? hweight : 1;
+	cg->hweight_gen = gen;
+	return cg->hweight;
+}
+
+static inline u32 rw_class_of(struct task_ctx *tctx)
+{
+	if (!coschedule_rw || tctx->type != TASK_TYPE_BANDWIDTH)
+		return RW_NONE;
+	return tctx->rw_class;
+}
+
+/* Tasks queued in a cgroup slot, its reader/writer DSQs included */
+static inline s32 cgrp_nr_queued(u32 slot)
+{
+	return scx_bpf_dsq_nr_queued(CGRP_DSQ_BASE + slot) +
+	       scx_bpf_dsq_nr_queued(READER_DSQ_BASE + slot) +
+	       scx_bpf_dsq_nr_queued(WRITER_DSQ_BASE + slot);
+}
+
+static inline s32 root_nr_queued(void)
+{
+	return scx_bpf_dsq_nr_queued(FALLBACK_DSQ_ID) +
+	       scx_bpf_dsq_nr_queued(READER_DSQ_BASE + RW_SLOT_ROOT) +
+	       scx_bpf_dsq_nr_queued(WRITER_DSQ_BASE + RW_SLOT_ROOT);
+}
+
+/* Share of the machine of the root cgroup's own tasks */
+static inline u32 root_hweight(void)
+{
+	return (u64)ROOT_WEIGHT * HWEIGHT_ONE / (root_child_weight_sum + ROOT_WEIGHT);
+}
+
+static inline struct link_mix *lookup_link_mix(u32 cpu)
+{
+	u32 *link = bpf_map_lookup_elem(&cpu_link, &cpu);
+	u32 key = link ? *link : 0;
+
+	return bpf_map_lookup_elem(&link_mix, &key);
+}
+
+/* Account the time since the last change to the current mix, then apply
+ * `delta` running tasks of class `cls` */
+static void link_mix_update(u32 cpu, u32 cls, s32 delta)
+{
+	struct link_mix *mix = lookup_link_mix(cpu);
+	u64 now = bpf_ktime_get_ns();
+
+	if (!mix)
+		return;
+
+	bpf_spin_lock(&mix->lock);
+	if (mix->last_change_ns) {
+		u64 elapsed = now - mix->last_change_ns;
+		if (mix->readers > 0 && mix->writers > 0)
+			mix->overlap_ns += elapsed;
+		else if (mix->readers > 0)
+			mix->read_only_ns += elapsed;
+		else if (mix->writers > 0)
+			mix->write_only_ns += elapsed;
+	}
+	mix->last_change_ns = now;
+	if (cls == RW_READER)
+		mix->readers = mix->readers + delta > 0 ? mix->readers + delta : 0;
+	else
+		mix->writers = mix->writers + delta > 0 ? mix->writers + delta : 0;
+	bpf_spin_unlock(&mix->lock);
+}
+
+/* Dispatch the class in the minority on this CPU's link first; on a tie,
+ * the class with the longer queue */
+static bool dispatch_rw(u32 cpu, u32 rw_slot)
+{
+	struct link_mix *mix = lookup_link_mix(cpu);
+	s32 readers = mix ? mix->readers : 0;
+	s32 writers = mix ? mix->writers : 0;
+	u64 first = READER_DSQ_BASE + rw_slot, second = WRITER_DSQ_BASE + rw_slot;
+
+	if (readers > writers ||
+	    (readers == writers &&
+	     scx_bpf_dsq_nr_queued(second) > scx_bpf_dsq_nr_queued(first))) {
+		first = WRITER_DSQ_BASE + rw_slot;
+		second = READER_DSQ_BASE + rw_slot;
+	}
+
+	if (scx_bpf_dsq_move_to_local(first)) {
+		if (mix && readers != writers)
+			__sync_fetch_and_add(&mix->paired_dispatches, 1);
+		return true;
+	}
+	return scx_bpf_dsq_move_to_local(second);
+}
+
+/* vtime of the first task queued on `dsq_id`; false if it is empty */
+static bool dsq_head_vtime(u64 dsq_id, u64 *vtime)
+{
+	struct task_struct *p;
+
+	bpf_for_each(scx_dsq, p, dsq_id, 0) {
+		*vtime = p->scx.dsq_vtime;
+		return true;
+	}
+	return false;
+}
+
+/* Dispatch from one cgroup: its reader/writer pair when their head is ahead
+ * of the cgroup's other tasks, otherwise the task DSQ */
+static bool dispatch_group(u32 cpu, u64 task_dsq, u32 rw_slot)
+{
+	u64 task_head = 0, reader_head = 0, writer_head = 0;
+	bool has_task, has_reader, has_writer;
+
+	if (!coschedule_rw)
+		return scx_bpf_dsq_move_to_local(task_dsq);
+
+	has_task = dsq_head_vtime(task_dsq, &task_head);
+	has_reader = dsq_head_vtime(READER_DSQ_BASE + rw_slot, &reader_head);
+	has_writer = dsq_head_vtime(WRITER_DSQ_BASE + rw_slot, &writer_head);
+	if (has_reader && (!has_writer || vtime_before(reader_head, writer_head)))
+		writer_head = reader_head;
+
+	if ((has_reader || has_writer) &&
+	    (!has_task || vtime_before(writer_head, task_head)) &&
+	    dispatch_rw(cpu, rw_slot))
+		return true;
+	return scx_bpf_dsq_move_to_local(task_dsq) || dispatch_rw(cpu, rw_slot);
+}
+
 /* sched_ext operations - simplified */
 
 s32 BPF_STRUCT_OPS(cxl_select_cpu, struct task_struct *p, s32 prev_cpu, u64 wake_flags)
@@ -307,8 +615,9 @@ s32 BPF_STRUCT_OPS(cxl_select_cpu, struct task_struct *p, s32 prev_cpu, u64 wake
 void BPF_STRUCT_OPS(cxl_enqueue, struct task_struct *p, u64 enq_flags)
 {
 	struct task_ctx *tctx;
+	struct cgrp_slot *cg;
 	u32 pid = p->pid;
-	u32 priority;
+	u32 priority, rw;
 	u64 vtime = p->scx.dsq_vtime;
 	
 	// Get or create task context
@@ -342,6 +651,8 @@ void BPF_STRUCT_OPS(cxl_enqueue, struct task_struct *p, u64 enq_flags)
 		else
 			tctx->type = TASK_TYPE_REGULAR;
 	}
+	if (tctx->type == TASK_TYPE_BANDWIDTH && tctx->rw_class == RW_NONE)
+		tctx->rw_class = rw_class_from_comm(p);
 	
 	// Update memory patterns
 	update_memory_pattern(pid, tctx);
@@ -362,13 +673,74 @@ void BPF_STRUCT_OPS(cxl_enqueue, struct task_struct *p, u64 enq_flags)
 		}
 	}
 	
+	// Co-scheduled readers/writers wait in their cgroup's per-class DSQs
+	rw = rw_class_of(tctx);
+
+	cg = lookup_cgrp_slot(tctx->cgrp_slot);
+	if (cg) {
+		u64 dsq_id = CGRP_DSQ_BASE + tctx->cgrp_slot;
+
+		// Task vtime is relative to the other tasks of its cgroup
+		if (vtime_before(vtime, cg->task_vtime - SCX_SLICE_DFL))
+			vtime = cg->task_vtime - SCX_SLICE_DFL;
+
+		// A cgroup coming back from idle cannot bank more than a slice
+		if (!cgrp_nr_queued(tctx->cgrp_slot) &&
+		    vtime_before(cg->cvtime, cvtime_now - SCX_SLICE_DFL))
+			cg->cvtime = cvtime_now - SCX_SLICE_DFL;
+
+		if (rw != RW_NONE)
+			dsq_id = (rw == RW_READER ? READER_DSQ_BASE : WRITER_DSQ_BASE) +
+			         tctx->cgrp_slot;
+
+		scx_bpf_dsq_insert_vtime(p, dsq_id, SCX_SLICE_DFL,
+		                        vtime - (120 - priority) * 100, enq_flags);
+		return;
+	}
+
 	// Adjust vtime
 	if (vtime_before(vtime, global_vtime - SCX_SLICE_DFL))
 		vtime = global_vtime - SCX_SLICE_DFL;
+
+	// Like a cgroup, the root banks at most a slice while idle
+	if (!root_nr_queued() && vtime_before(root_cvtime, cvtime_now - SCX_SLICE_DFL))
+		root_cvtime = cvtime_now - SCX_SLICE_DFL;
 	
 	// Enqueue
-	scx_bpf_dsq_insert_vtime(p, FALLBACK_DSQ_ID, SCX_SLICE_DFL, 
-	                        vtime - (120 - priority) * 100, enq_flags);
+	scx_bpf_dsq_insert_vtime(p, rw == RW_NONE ? FALLBACK_DSQ_ID :
+	                        (rw == RW_READER ? READER_DSQ_BASE : WRITER_DSQ_BASE) + RW_SLOT_ROOT,
+	                        SCX_SLICE_DFL, vtime - (120 - priority) * 100, enq_flags);
+}
+
+/* Dispatch from the cgroup with the lowest cvtime, the root's own tasks
+ * included */
+static bool dispatch_cgroup(u32 cpu)
+{
+	struct cgrp_slot *cg, *best = NULL;
+	u32 slot, best_slot = 0;
+
+	for (slot = 0; slot < MAX_CGROUPS; slot++) {
+		cg = bpf_map_lookup_elem(&cgrp_slots, &slot);
+		if (!cg || !cg->used || !cgrp_nr_queued(slot))
+			continue;
+		if (!best || vtime_before(cg->cvtime, best->cvtime)) {
+			best = cg;
+			best_slot = slot;
+		}
+	}
+
+	if (root_nr_queued() && (!best || vtime_before(root_cvtime, best->cvtime))) {
+		if (vtime_before(cvtime_now, root_cvtime))
+			cvtime_now = root_cvtime;
+		if (dispatch_group(cpu, FALLBACK_DSQ_ID, RW_SLOT_ROOT))
+			return true;
+	}
+	if (!best)
+		return false;
+
+	if (vtime_before(cvtime_now, best->cvtime))
+		cvtime_now = best->cvtime;
+	return dispatch_group(cpu, CGRP_DSQ_BASE + best_slot, best_slot);
 }
 
 void BPF_STRUCT_OPS(cxl_dispatch, s32 cpu, struct task_struct *prev)
@@ -384,8 +756,8 @@ void BPF_STRUCT_OPS(cxl_dispatch, s32 cpu, struct task_struct *prev)
 		bpf_map_update_elem(&cpu_contexts, &cpu, cpu_ctx, BPF_ANY);
 	}
 	
-	// Dispatch next task
-	if (!scx_bpf_dsq_move_to_local(FALLBACK_DSQ_ID))
+	// Dispatch next task from the cgroup (or root) with the lowest vtime
+	if (!dispatch_cgroup(cpu))
 		return;
 		
 	// Update for new task
@@ -397,19 +769,60 @@ void BPF_STRUCT_OPS(cxl_dispatch, s32 cpu, struct task_struct *prev)
 
 void BPF_STRUCT_OPS(cxl_running, struct task_struct *p)
 {
+	struct task_ctx *tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+	struct cgrp_slot *cg = tctx ? lookup_cgrp_slot(tctx->cgrp_slot) : NULL;
+	u32 rw = tctx ? rw_class_of(tctx) : RW_NONE;
+
+	if (rw != RW_NONE) {
+		link_mix_update(bpf_get_smp_processor_id(), rw, 1);
+		tctx->rw_running = rw;
+	}
+	if (cg) {
+		if (vtime_before(cg->task_vtime, p->scx.dsq_vtime))
+			cg->task_vtime = p->scx.dsq_vtime;
+		return;
+	}
 	if (vtime_before(global_vtime, p->scx.dsq_vtime))
 		global_vtime = p->scx.dsq_vtime;
 }
 
 void BPF_STRUCT_OPS(cxl_stopping, struct task_struct *p, bool runnable)
 {
-	p->scx.dsq_vtime += (SCX_SLICE_DFL - p->scx.slice) * 100 / p->scx.weight;
+	struct task_ctx *tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+	struct cgrp_slot *cg = tctx ? lookup_cgrp_slot(tctx->cgrp_slot) : NULL;
+	u64 used = SCX_SLICE_DFL - p->scx.slice;
+
+	p->scx.dsq_vtime += used * 100 / p->scx.weight;
+	if (tctx)
+		tctx->avg_runtime_ns = tctx->avg_runtime_ns - (tctx->avg_runtime_ns >> 3) + (used >> 3);
+
+	if (tctx && tctx->rw_running != RW_NONE) {
+		link_mix_update(bpf_get_smp_processor_id(), tctx->rw_running, -1);
+		tctx->rw_running = RW_NONE;
+	}
+
+	// Charge the cgroup inversely to its share of the machine
+	if (cg) {
+		cg->cvtime += used * HWEIGHT_ONE / cgrp_hweight(cg);
+		__sync_fetch_and_add(&cg->runtime_ns, used);
+	} else {
+		root_cvtime += used * HWEIGHT_ONE / root_hweight();
+	}
 }
 
 s32 BPF_STRUCT_OPS(cxl_init_task, struct task_struct *p, struct scx_init_task_args *args)
 {
 	struct task_ctx *tctx;
 	
+	// A context left by the previous policy of a hot swap (cxl_sched -p)
+	// keeps its classification; only the cgroup slot is assigned anew
+	tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+	if (tctx) {
+		tctx->cgrp_slot = cgrp_slot_of(args->cgroup);
+		tctx->rw_running = RW_NONE;
+		return 0;
+	}
+
 	tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, BPF_LOCAL_STORAGE_GET_F_CREATE);
 	if (!tctx)
 		return -ENOMEM;
@@ -417,6 +830,8 @@ s32 BPF_STRUCT_OPS(cxl_init_task, struct task_struct *p, struct scx_init_task_ar
 	tctx->type = TASK_TYPE_UNKNOWN;
 	tctx->priority_boost = 0;
 	tctx->is_memory_intensive = false;
+	tctx->rw_class = RW_NONE;
+	tctx->cgrp_slot = cgrp_slot_of(args->cgroup);
 	
 	return 0;
 }
@@ -424,18 +839,168 @@ s32 BPF_STRUCT_OPS(cxl_init_task, struct task_struct *p, struct scx_init_task_ar
 void BPF_STRUCT_OPS(cxl_exit_task, struct task_struct *p)
 {
 	u32 pid = p->pid;
+
+	// exit_task also runs for every live task when the scheduler is
+	// disabled; their patterns stay for the next policy
+	if (!(p->flags & PF_EXITING))
+		return;
 	bpf_map_delete_elem(&memory_patterns, &pid);
 }
 
+s32 BPF_STRUCT_OPS_SLEEPABLE(cxl_cgroup_init, struct cgroup *cgrp,
+			     struct scx_cgroup_init_args *args)
+{
+	struct cgrp_slot_ref ref = {.slot = CGRP_SLOT_NONE};
+	struct cgrp_slot *cg, *parent_cg;
+	struct cgroup *parent;
+	u64 cgid = cgrp->kn->id;
+	s32 parent_slot = -1;
+	u32 slot;
+
+	// Root cgroup tasks stay on the fallback DSQ
+	if (cgrp->level == 0)
+		return 0;
+
+	if (cgrp->level > 1) {
+		parent = bpf_cgroup_ancestor(cgrp, cgrp->level - 1);
+		if (parent) {
+			slot = cgrp_slot_of(parent);
+			if (slot != CGRP_SLOT_NONE)
+				parent_slot = slot;
+			bpf_cgroup_release(parent);
+		}
+	}
+
+	for (slot = 0; slot < OVERFLOW_SLOT; slot++) {
+		cg = bpf_map_lookup_elem(&cgrp_slots, &slot);
+		if (cg && !cg->used)
+			break;
+	}
+	if (slot == OVERFLOW_SLOT || !cg) {
+		// Out of slots: share the nearest slotted ancestor's, or the
+		// low-weight overflow slot for a top-level cgroup
+		ref.slot = parent_slot >= 0 ? parent_slot : OVERFLOW_SLOT;
+		cg = lookup_cgrp_slot(ref.slot);
+		if (cg)
+			__sync_fetch_and_add(&cg->nr_borrowers, 1);
+		bpf_printk("cxl: out of cgroup slots, cgroup %llu shares slot %u",
+			   cgid, ref.slot);
+		bpf_map_update_elem(&cgrp_slot_refs, &cgid, &ref, BPF_ANY);
+		return 0;
+	}
+
+	__builtin_memset(cg, 0, sizeof(*cg));
+	cg->cgid = cgid;
+	cg->weight = args->weight;
+	cg->parent = parent_slot;
+	cg->cvtime = cvtime_now;
+	cg->used = true;
+
+	parent_cg = parent_slot >= 0 ? lookup_cgrp_slot(parent_slot) : NULL;
+	if (parent_cg)
+		parent_cg->child_weight_sum += args->weight;
+	else
+		root_child_weight_sum += args->weight;
+	hweight_gen++;
+
+	ref.slot = slot;
+	ref.owned = true;
+	bpf_map_update_elem(&cgrp_slot_refs, &cgid, &ref, BPF_ANY);
+	return 0;
+}
+
+void BPF_STRUCT_OPS(cxl_cgroup_exit, struct cgroup *cgrp)
+{
+	struct cgrp_slot *cg, *parent_cg;
+	struct cgrp_slot_ref *ref;
+	u64 cgid = cgrp->kn->id;
+
+	ref = bpf_map_lookup_elem(&cgrp_slot_refs, &cgid);
+	if (!ref)
+		return;
+	cg = lookup_cgrp_slot(ref->slot);
+	if (cg && !ref->owned) {
+		__sync_fetch_and_sub(&cg->nr_borrowers, 1);
+	} else if (cg) {
+		parent_cg = cg->parent >= 0 ? lookup_cgrp_slot(cg->parent) : NULL;
+		if (parent_cg)
+			parent_cg->child_weight_sum -= cg->weight;
+		else
+			root_child_weight_sum -= cg->weight;
+		cg->used = false;
+		hweight_gen++;
+	}
+	bpf_map_delete_elem(&cgrp_slot_refs, &cgid);
+}
+
+void BPF_STRUCT_OPS(cxl_cgroup_set_weight, struct cgroup *cgrp, u32 weight)
+{
+	struct cgrp_slot *cg, *parent_cg;
+	struct cgrp_slot_ref *ref;
+	u64 cgid = cgrp->kn->id;
+
+	ref = bpf_map_lookup_elem(&cgrp_slot_refs, &cgid);
+	if (!ref || !ref->owned)
+		return;
+	cg = lookup_cgrp_slot(ref->slot);
+	if (!cg)
+		return;
+
+	parent_cg = cg->parent >= 0 ? lookup_cgrp_slot(cg->parent) : NULL;
+	if (parent_cg)
+		parent_cg->child_weight_sum += weight - cg->weight;
+	else
+		root_child_weight_sum += weight - cg->weight;
+	cg->weight = weight;
+	hweight_gen++;
+}
+
+void BPF_STRUCT_OPS(cxl_cgroup_move, struct task_struct *p,
+		    struct cgroup *from, struct cgroup *to)
+{
+	struct task_ctx *tctx = bpf_task_storage_get(&task_ctx_stor, p, 0, 0);
+
+	if (tctx)
+		tctx->cgrp_slot = cgrp_slot_of(to);
+}
+
 s32 BPF_STRUCT_OPS_SLEEPABLE(cxl_init)
 {
 	s32 ret;
 	struct cpu_ctx cpu_ctx_init = {0};
-	u32 cpu;
+	struct cgrp_slot *cg;
+	u32 cpu, slot;
 	
 	ret = scx_bpf_create_dsq(FALLBACK_DSQ_ID, NUMA_NO_NODE);
 	if (ret)
 		return ret;
+
+	for (slot = 0; slot < MAX_CGROUPS; slot++) {
+		ret = scx_bpf_create_dsq(CGRP_DSQ_BASE + slot, NUMA_NO_NODE);
+		if (ret)
+			return ret;
+	}
+
+	for (slot = 0; slot <= RW_SLOT_ROOT; slot++) {
+		ret = scx_bpf_create_dsq(READER_DSQ_BASE + slot, NUMA_NO_NODE);
+		if (ret)
+			return ret;
+		ret = scx_bpf_create_dsq(WRITER_DSQ_BASE + slot, NUMA_NO_NODE);
+		if (ret)
+			return ret;
+	}
+
+	// The overflow slot is a top-level cgroup of its own; cgroup id 0
+	// marks it for the controller
+	cg = lookup_cgrp_slot(OVERFLOW_SLOT);
+	if (cg) {
+		__builtin_memset(cg, 0, sizeof(*cg));
+		cg->weight = OVERFLOW_WEIGHT;
+		cg->parent = -1;
+		cg->used = true;
+		root_child_weight_sum += OVERFLOW_WEIGHT;
+		hweight_gen++;
+	}
 		
 	// 避免循环，直接初始化4个CPU上下文
 	cpu_ctx_init.is_preferred = 1; // 优先CPU
@@ -464,6 +1029,64 @@ void BPF_STRUCT_OPS(cxl_exit, struct scx_exit_info *ei)
 	// Exit handler
 }
 
+/*
+ * Task-context snapshot: every read of the pinned iterator walks all tasks
+ * once and emits a header plus one fixed-size record (task_snapshot.h) per
+ * task that has a scheduler context, so userspace needs no per-pid lookups.
+ */
+SEC("iter/task")
+int dump_task_ctx(struct bpf_iter__task *ctx)
+{
+	struct seq_file *seq = ctx->meta->seq;
+	struct task_struct *task = ctx->task;
+	struct task_snapshot_record rec = {};
+	struct memory_pattern *pattern;
+	struct task_ctx *tctx;
+	u32 pid;
+
+	if (ctx->meta->seq_num == 0) {
+		struct task_snapshot_header hdr = {
+			.magic = TASK_SNAPSHOT_MAGIC,
+			.version = TASK_SNAPSHOT_VERSION,
+			.record_size = sizeof(struct task_snapshot_record),
+			.taken_ns = bpf_ktime_get_ns(),
+		};
+		bpf_seq_write(seq, &hdr, sizeof(hdr));
+	}
+	if (!task)
+		return 0;
+
+	tctx = bpf_task_storage_get(&task_ctx_stor, task, 0, 0);
+	if (!tctx)
+		return 0;
+
+	pid = task->pid;
+	rec.pid = pid;
+	rec.tgid = task->tgid;
+	bpf_probe_read_kernel_str(rec.comm, sizeof(rec.comm), task->comm);
+	rec.dsq_vtime = task->scx.dsq_vtime;
+	rec.avg_runtime_ns = tctx->avg_runtime_ns;
+	rec.weight = task->scx.weight;
+	rec.cgrp_slot = tctx->cgrp_slot;
+	rec.thread_id = tctx->thread_id;
+	rec.priority_boost = tctx->priority_boost;
+	rec.last_cpu = task->thread_info.cpu;
+	rec.type = tctx->type;
+	rec.is_memory_intensive = tctx->is_memory_intensive;
+
+	pattern = bpf_map_lookup_elem(&memory_patterns, &pid);
+	if (pattern) {
+		rec.has_pattern = 1;
+		rec.is_reader = pattern->is_reader;
+		rec.locality_score = pattern->locality_score;
+		rec.access_count = pattern->access_count;
+		rec.last_access_ns = pattern->last_access_time;
+	}
+
+	bpf_seq_write(seq, &rec, sizeof(rec));
+	return 0;
+}
+
 SCX_OPS_DEFINE(cxl_ops,
 	       .select_cpu		= (void *)cxl_select_cpu,
 	       .enqueue			= (void *)cxl_enqueue,
@@ -472,6 +1095,10 @@ SCX_OPS_DEFINE(cxl_ops,
 	       .stopping		= (void *)cxl_stopping,
 	       .init_task		= (void *)cxl_init_task,
 	       .exit_task		= (void *)cxl_exit_task,
+	       .cgroup_init		= (void *)cxl_cgroup_init,
+	       .cgroup_exit		= (void *)cxl_cgroup_exit,
+	       .cgroup_move		= (void *)cxl_cgroup_move,
+	       .cgroup_set_weight	= (void *)cxl_cgroup_set_weight,
 	       .init			= (void *)cxl_init,
 	       .exit			= (void *)cxl_exit,
 	       .flags			= 0,
@@ -1,8 +1,16 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 /*
  * CXL PMU-aware scheduler loader
- * 
+ *
  * This program loads and manages the CXL PMU eBPF scheduler.
+ *
+ * With --pin-dir, task classification and learned per-task statistics live
+ * in maps pinned under that directory, and the loader can hot-swap between
+ * scheduler objects: the next policy is opened, its maps are bound to the
+ * pinned ones and it is verified while the current policy keeps running;
+ * only then is the old struct_ops detached and the new one attached. The
+ * detach-to-attach gap, and with --telemetry the throughput of a running
+ * double_bandwidth around it, is reported for every swap.
  */
 
 #include <stdio.h>
@@ -11,15 +19,53 @@
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
+#include <bpf/btf.h>
+
+#include "../microbench/telemetry.h"
+
+#define MAX_OBJECTS 8
+#define ATTACH_TIMEOUT_MS 2000   // wait for the previous scheduler to unload
+#define SAMPLE_INTERVAL_US 2000  // telemetry sampling during a swap
+#define SAMPLE_WINDOW_MS 10      // throughput dip resolution
+#define SWAP_BASELINE_MS 500     // throughput baseline before/after a swap
+#define MAX_SAMPLES 4096
 
 static volatile bool exiting = false;
+static volatile sig_atomic_t swap_requested = 0;
+
+struct sched_instance {
+    const char *file;
+    struct bpf_object *obj;
+    struct bpf_link *link;
+    int shared_maps;             // maps bound to pinned ones
+};
+
+/* Byte counter samples of a running benchmark, taken while swapping */
+struct throughput_sampler {
+    struct cxl_telemetry_header *hdr;
+    size_t map_size;
+    pthread_t thread;
+    volatile bool running;
+    int count;
+    unsigned long long t_ns[MAX_SAMPLES];
+    unsigned long long bytes[MAX_SAMPLES];
+};
 
 static void sig_handler(int sig)
 {
-    exiting = true;
+    if (sig == SIGUSR1)
+        swap_requested = 1;
+    else
+        exiting = true;
 }
 
 static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
@@ -40,53 +86,465 @@ static void bump_memlock_rlimit(void)
     }
 }
 
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 static void print_usage(const char *prog_name)
 {
-    printf("Usage: %s [eBPF_object_file]\n", prog_name);
+    printf("Usage: %s [OPTIONS] [eBPF_object_file...]\n", prog_name);
     printf("\n");
     printf("Load and run the CXL PMU-aware eBPF scheduler\n");
     printf("\n");
     printf("Arguments:\n");
     printf("  eBPF_object_file    Path to the eBPF object file to load\n");
     printf("                      Default: cxl_pmu_simple.bpf.o\n");
+    printf("                      With several files, swaps cycle through them\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -p, --pin-dir=DIR       Keep shareable maps pinned under DIR (bpffs) and\n");
+    printf("                          carry them across swaps and restarts\n");
+    printf("  -s, --swap-every=SEC    Hot-swap to the next object every SEC seconds\n");
+    printf("                          (SIGUSR1 swaps immediately; with one object both\n");
+    printf("                          reload the file, e.g. after a rebuild)\n");
+    printf("  -T, --telemetry=NAME    Measure the throughput of a double_bandwidth run\n");
+    printf("                          started with --telemetry=NAME around each swap\n");
+    printf("  -h, --help              Show this help message\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s                           # Load simple scheduler\n", prog_name);
     printf("  %s cxl_pmu_simple.bpf.o      # Load simple scheduler\n", prog_name);
     printf("  %s cxl_pmu.bpf.o             # Load complex scheduler\n", prog_name);
+    printf("  %s -p /sys/fs/bpf/cxl -s 10 -T bw cxl_pmu_simple.bpf.o\n", prog_name);
+    printf("                                 # Reload every 10s, keeping task state\n");
     printf("\n");
     printf("Note: This program requires root privileges and sched_ext kernel support\n");
 }
 
+/*
+ * Maps worth carrying across policies: user-defined maps other than the
+ * struct_ops itself and per-CPU perf event arrays (their fds belong to the
+ * controller that filled them).
+ */
+static bool shareable_map(const struct bpf_map *map)
+{
+    enum bpf_map_type type = bpf_map__type(map);
+    return type != BPF_MAP_TYPE_STRUCT_OPS &&
+           type != BPF_MAP_TYPE_PERF_EVENT_ARRAY &&
+           !strchr(bpf_map__name(map), '.');
+}
+
+#define BTF_MAX_DEPTH 8
+
+static bool btf_same_name(const struct btf *a, __u32 a_off, const struct btf *b, __u32 b_off)
+{
+    const char *a_name = btf__name_by_offset(a, a_off);
+    const char *b_name = btf__name_by_offset(b, b_off);
+    return a_name && b_name && strcmp(a_name, b_name) == 0;
+}
+
+/*
+ * Structural comparison of two BTF types, typedefs and modifiers skipped:
+ * same kind and size, and for structs/unions the same member names,
+ * offsets and member types, recursively. Two policies that both call their
+ * value "struct task_ctx" but lay it out differently do not match.
+ */
+static bool btf_same_layout(const struct btf *a, __u32 a_id, const struct btf *b, __u32 b_id,
+                            int depth)
+{
+    const struct btf_type *ta, *tb;
+    int ra, rb, i;
+
+    if (!a_id || !b_id)
+        return a_id == b_id;
+    ra = btf__resolve_type(a, a_id);
+    rb = btf__resolve_type(b, b_id);
+    if (ra < 0 || rb < 0 || depth > BTF_MAX_DEPTH)
+        return false;
+    ta = btf__type_by_id(a, ra);
+    tb = btf__type_by_id(b, rb);
+    if (!ta || !tb || btf_kind(ta) != btf_kind(tb) || btf_vlen(ta) != btf_vlen(tb))
+        return false;
+
+    switch (btf_kind(ta)) {
+    case BTF_KIND_INT:
+        return ta->size == tb->size && btf_int_encoding(ta) == btf_int_encoding(tb) &&
+               btf_int_bits(ta) == btf_int_bits(tb) && btf_int_offset(ta) == btf_int_offset(tb);
+    case BTF_KIND_ENUM:
+        for (i = 0; i < btf_vlen(ta); i++) {
+            if (btf_enum(ta)[i].val != btf_enum(tb)[i].val)
+                return false;
+        }
+        return ta->size == tb->size;
+    case BTF_KIND_ARRAY:
+        return btf_array(ta)->nelems == btf_array(tb)->nelems &&
+               btf_same_layout(a, btf_array(ta)->type, b, btf_array(tb)->type, depth + 1);
+    case BTF_KIND_STRUCT:
+    case BTF_KIND_UNION:
+        if (ta->size != tb->size)
+            return false;
+        for (i = 0; i < btf_vlen(ta); i++) {
+            const struct btf_member *ma = btf_members(ta) + i, *mb = btf_members(tb) + i;
+            if (!btf_same_name(a, ma->name_off, b, mb->name_off) ||
+                btf_member_bit_offset(ta, i) != btf_member_bit_offset(tb, i) ||
+                btf_member_bitfield_size(ta, i) != btf_member_bitfield_size(tb, i) ||
+                !btf_same_layout(a, ma->type, b, mb->type, depth + 1))
+                return false;
+        }
+        return true;
+    case BTF_KIND_PTR:
+        return true;
+    default:
+        return btf__resolve_size(a, ra) == btf__resolve_size(b, rb);
+    }
+}
+
+/*
+ * Bind `map` to the map pinned under its name if one exists with the same
+ * type, sizes and key/value BTF layout. Returns 1 if bound, 0 otherwise.
+ */
+static int reuse_pinned_map(struct bpf_object *obj, struct bpf_map *map, const char *pin_dir)
+{
+    char path[512];
+    struct bpf_map_info info = {};
+    __u32 info_len = sizeof(info);
+    int fd, err, same = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", pin_dir, bpf_map__name(map));
+    fd = bpf_obj_get(path);
+    if (fd < 0)
+        return 0;
+
+    if (bpf_obj_get_info_by_fd(fd, &info, &info_len) == 0 &&
+        info.type == bpf_map__type(map) &&
+        info.key_size == bpf_map__key_size(map) &&
+        info.value_size == bpf_map__value_size(map) &&
+        info.max_entries == bpf_map__max_entries(map) &&
+        info.map_flags == bpf_map__map_flags(map)) {
+        /* Same size is not enough: the key and value layouts must match */
+        struct btf *pinned_btf = info.btf_id ? btf__load_from_kernel_by_id(info.btf_id) : NULL;
+        struct btf *btf = bpf_object__btf(obj);
+        same = pinned_btf && btf &&
+               btf_same_layout(pinned_btf, info.btf_key_type_id, btf,
+                               bpf_map__btf_key_type_id(map), 0) &&
+               btf_same_layout(pinned_btf, info.btf_value_type_id, btf,
+                               bpf_map__btf_value_type_id(map), 0);
+        btf__free(pinned_btf);
+    }
+
+    if (!same) {
+        printf("  %-20s not shared (layout differs from the pinned map)\n", bpf_map__name(map));
+        close(fd);
+        return 0;
+    }
+
+    err = bpf_map__reuse_fd(map, fd);
+    close(fd);
+    if (err) {
+        fprintf(stderr, "  %-20s failed to reuse pinned map: %s\n", bpf_map__name(map), strerror(-err));
+        return 0;
+    }
+    printf("  %-20s shared with the previous scheduler\n", bpf_map__name(map));
+    return 1;
+}
+
+/* Open and verify a scheduler object without attaching it */
+static int load_instance(struct sched_instance *inst, const char *file, const char *pin_dir)
+{
+    struct bpf_map *map;
+    char path[512];
+    int err;
+
+    memset(inst, 0, sizeof(*inst));
+    inst->file = file;
+
+    if (access(file, F_OK) != 0) {
+        fprintf(stderr, "Error: eBPF object file '%s' not found.\n", file);
+        fprintf(stderr, "Please run 'make all' to build the scheduler first.\n");
+        return -ENOENT;
+    }
+
+    inst->obj = bpf_object__open_file(file, NULL);
+    if (libbpf_get_error(inst->obj)) {
+        fprintf(stderr, "ERROR: opening BPF object file '%s' failed\n", file);
+        inst->obj = NULL;
+        return -EINVAL;
+    }
+
+    if (pin_dir) {
+        bpf_object__for_each_map(map, inst->obj) {
+            if (shareable_map(map))
+                inst->shared_maps += reuse_pinned_map(inst->obj, map, pin_dir);
+        }
+    }
+
+    /* Load & verify BPF programs */
+    printf("Loading and verifying eBPF programs from %s...\n", file);
+    err = bpf_object__load(inst->obj);
+    if (err) {
+        fprintf(stderr, "ERROR: loading BPF object file failed (error: %d)\n", err);
+        fprintf(stderr, "This may be due to:\n");
+        fprintf(stderr, "  - eBPF instruction limit exceeded (try simple version)\n");
+        fprintf(stderr, "  - Missing sched_ext kernel support\n");
+        fprintf(stderr, "  - Kernel version incompatibility\n");
+        bpf_object__close(inst->obj);
+        inst->obj = NULL;
+        return err;
+    }
+
+    /* Pin this policy's own maps so the next one can pick them up */
+    if (pin_dir) {
+        bpf_object__for_each_map(map, inst->obj) {
+            if (!shareable_map(map))
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", pin_dir, bpf_map__name(map));
+            if (access(path, F_OK) == 0)
+                continue;
+            err = bpf_map__pin(map, path);
+            if (err)
+                fprintf(stderr, "Warning: failed to pin %s: %s\n", path, strerror(-err));
+        }
+    }
+    return 0;
+}
+
+/*
+ * Attach the object's struct_ops. Right after a detach the kernel may still
+ * be disabling the previous scheduler, so -EBUSY/-EEXIST are retried.
+ */
+static int attach_instance(struct sched_instance *inst)
+{
+    struct bpf_map *map, *ops = NULL;
+    unsigned long long deadline = now_ns() + ATTACH_TIMEOUT_MS * 1000000ULL;
+
+    bpf_object__for_each_map(map, inst->obj) {
+        if (bpf_map__type(map) == BPF_MAP_TYPE_STRUCT_OPS) {
+            ops = map;
+            break;
+        }
+    }
+    if (!ops) {
+        fprintf(stderr, "ERROR: %s has no struct_ops scheduler\n", inst->file);
+        return -ENOENT;
+    }
+
+    for (;;) {
+        inst->link = bpf_map__attach_struct_ops(ops);
+        int err = libbpf_get_error(inst->link);
+        if (!err)
+            return 0;
+        inst->link = NULL;
+        if ((err != -EBUSY && err != -EEXIST) || now_ns() > deadline) {
+            fprintf(stderr, "ERROR: attaching %s failed: %s\n", inst->file, strerror(-err));
+            return err;
+        }
+        usleep(100);
+    }
+}
+
+static void destroy_instance(struct sched_instance *inst)
+{
+    bpf_link__destroy(inst->link);
+    bpf_object__close(inst->obj);
+    inst->link = NULL;
+    inst->obj = NULL;
+}
+
+static int open_telemetry(struct throughput_sampler *s, const char *name)
+{
+    char shm_name[256];
+    struct stat st;
+
+    snprintf(shm_name, sizeof(shm_name), "%s%s", name[0] == '/' ? "" : "/", name);
+    int fd = shm_open(shm_name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Warning: cannot open telemetry %s: %s\n", shm_name, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct cxl_telemetry_header)) {
+        close(fd);
+        return -1;
+    }
+    s->map_size = st.st_size;
+    s->hdr = mmap(NULL, s->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (s->hdr == MAP_FAILED || s->hdr->magic != CXL_TELEMETRY_MAGIC ||
+        cxl_telemetry_size(s->hdr->num_threads) > s->map_size) {
+        if (s->hdr != MAP_FAILED)
+            munmap(s->hdr, s->map_size);
+        s->hdr = NULL;
+        fprintf(stderr, "Warning: %s is not a telemetry segment\n", shm_name);
+        return -1;
+    }
+    return 0;
+}
+
+static unsigned long long telemetry_bytes(struct cxl_telemetry_header *hdr)
+{
+    struct cxl_telemetry_thread *threads = cxl_telemetry_threads(hdr);
+    unsigned long long total = 0;
+    for (__u32 i = 0; i < hdr->num_threads; i++)
+        total += cxl_telemetry_read(&threads[i].bytes_processed);
+    return total;
+}
+
+static void *sampler_main(void *arg)
+{
+    struct throughput_sampler *s = arg;
+    while (s->running && s->count < MAX_SAMPLES) {
+        s->t_ns[s->count] = now_ns();
+        s->bytes[s->count] = telemetry_bytes(s->hdr);
+        s->count++;
+        usleep(SAMPLE_INTERVAL_US);
+    }
+    return NULL;
+}
+
+/* Bytes/s between the samples closest to [from, to] */
+static double rate_between(struct throughput_sampler *s, unsigned long long from,
+                           unsigned long long to)
+{
+    int a = -1, b = -1;
+    for (int i = 0; i < s->count; i++) {
+        if (a < 0 && s->t_ns[i] >= from)
+            a = i;
+        if (s->t_ns[i] <= to)
+            b = i;
+    }
+    if (a < 0 || b <= a)
+        return 0;
+    return (double)(s->bytes[b] - s->bytes[a]) * 1e9 / (s->t_ns[b] - s->t_ns[a]);
+}
+
+static void report_throughput(struct throughput_sampler *s, unsigned long long detach_ns,
+                              unsigned long long attach_ns)
+{
+    const unsigned long long base = SWAP_BASELINE_MS * 1000000ULL;
+    const unsigned long long window = SAMPLE_WINDOW_MS * 1000000ULL;
+    double before = rate_between(s, detach_ns - base, detach_ns);
+    double after = rate_between(s, attach_ns + window, attach_ns + window + base);
+    double dip = before;
+
+    for (unsigned long long t = detach_ns - window; t < attach_ns + window; t += window / 2) {
+        double r = rate_between(s, t, t + window);
+        if (r > 0 && r < dip)
+            dip = r;
+    }
+    if (before <= 0) {
+        printf("  Throughput: no samples (is the benchmark running?)\n");
+        return;
+    }
+    printf("  Throughput: %.1f MB/s before, %.1f MB/s after, worst %d ms window %.1f MB/s (%.1f%%)\n",
+           before / (1024 * 1024), after / (1024 * 1024), SAMPLE_WINDOW_MS,
+           dip / (1024 * 1024), 100.0 * dip / before);
+}
+
+/*
+ * Replace `cur` with the scheduler in `file`. The new object is verified
+ * and bound to the pinned maps first; a failure leaves `cur` running.
+ * If neither the new nor the old scheduler can be attached, cur->link is
+ * NULL on return and no BPF scheduler is loaded.
+ */
+static int hot_swap(struct sched_instance *cur, const char *file, const char *pin_dir,
+                    struct throughput_sampler *sampler)
+{
+    struct sched_instance next;
+    unsigned long long t_load = now_ns();
+    int err;
+
+    printf("\n=== Hot swap: %s -> %s ===\n", cur->file, file);
+    err = load_instance(&next, file, pin_dir);
+    if (err) {
+        printf("Swap aborted, %s keeps running\n", cur->file);
+        return err;
+    }
+    printf("  Loaded in %.1f ms, %d map(s) shared\n", (now_ns() - t_load) / 1e6, next.shared_maps);
+
+    if (sampler) {
+        sampler->count = 0;
+        sampler->running = true;
+        if (pthread_create(&sampler->thread, NULL, sampler_main, sampler) != 0)
+            sampler = NULL;
+        else
+            usleep(SWAP_BASELINE_MS * 1000);
+    }
+
+    unsigned long long t_detach = now_ns();
+    bpf_link__destroy(cur->link);
+    cur->link = NULL;
+    err = attach_instance(&next);
+    unsigned long long t_attach = now_ns();
+
+    if (err) {
+        /* Fall back to the previous policy rather than the fair class */
+        fprintf(stderr, "Reattaching %s\n", cur->file);
+        destroy_instance(&next);
+        if (attach_instance(cur) != 0)
+            fprintf(stderr, "ERROR: %s could not be reattached, no BPF scheduler is loaded\n",
+                    cur->file);
+    } else {
+        printf("  Gap without a BPF scheduler: %.3f ms\n", (t_attach - t_detach) / 1e6);
+        bpf_object__close(cur->obj);
+        *cur = next;
+    }
+
+    if (sampler) {
+        usleep((SWAP_BASELINE_MS + SAMPLE_WINDOW_MS) * 1000);
+        sampler->running = false;
+        pthread_join(sampler->thread, NULL);
+        report_throughput(sampler, t_detach, t_attach);
+    }
+    return err;
+}
+
 int main(int argc, char **argv)
 {
-    struct bpf_object *obj;
-    struct bpf_link *link = NULL;
-    const char *obj_file = "cxl_pmu_simple.bpf.o";  // Default to simple version
+    static struct option long_options[] = {
+        {"pin-dir", required_argument, 0, 'p'},
+        {"swap-every", required_argument, 0, 's'},
+        {"telemetry", required_argument, 0, 'T'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+    struct sched_instance cur = {};
+    struct throughput_sampler *sampler = NULL;
+    const char *objects[MAX_OBJECTS];
+    const char *pin_dir = NULL, *telemetry = NULL;
+    int nr_objects = 0, current = 0, swap_every = 0, opt;
     int err;
 
     // Parse command line arguments
-    if (argc > 2) {
-        print_usage(argv[0]);
-        return 1;
-    }
-    
-    if (argc == 2) {
-        if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+    while ((opt = getopt_long(argc, argv, "p:s:T:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'p':
+            pin_dir = optarg;
+            break;
+        case 's':
+            swap_every = atoi(optarg);
+            break;
+        case 'T':
+            telemetry = optarg;
+            break;
+        case 'h':
             print_usage(argv[0]);
             return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
         }
-        obj_file = argv[1];
     }
-
-    // Check if the eBPF object file exists
-    if (access(obj_file, F_OK) != 0) {
-        fprintf(stderr, "Error: eBPF object file '%s' not found.\n", obj_file);
-        fprintf(stderr, "Please run 'make all' to build the scheduler first.\n");
+    for (; optind < argc && nr_objects < MAX_OBJECTS; optind++)
+        objects[nr_objects++] = argv[optind];
+    if (optind < argc) {
+        print_usage(argv[0]);
         return 1;
     }
+    if (nr_objects == 0)
+        objects[nr_objects++] = "cxl_pmu_simple.bpf.o";  // Default to simple version
 
-    printf("Loading CXL PMU scheduler from: %s\n", obj_file);
+    printf("Loading CXL PMU scheduler from: %s\n", objects[0]);
 
     libbpf_set_print(libbpf_print_fn);
 
@@ -96,25 +554,26 @@ int main(int argc, char **argv)
     /* Set up signal handlers */
     signal(SIGINT, sig_handler);
     signal(SIGTERM, sig_handler);
+    signal(SIGUSR1, sig_handler);
 
-    /* Open BPF application */
-    obj = bpf_object__open_file(obj_file, NULL);
-    if (libbpf_get_error(obj)) {
-        fprintf(stderr, "ERROR: opening BPF object file '%s' failed\n", obj_file);
+    if (pin_dir && mkdir(pin_dir, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "ERROR: cannot create pin directory %s: %s\n", pin_dir, strerror(errno));
         return 1;
     }
+    if (telemetry) {
+        sampler = calloc(1, sizeof(*sampler));
+        if (sampler && open_telemetry(sampler, telemetry) != 0) {
+            free(sampler);
+            sampler = NULL;
+        }
+    }
 
-    /* Load & verify BPF programs */
-    printf("Loading and verifying eBPF programs...\n");
-    err = bpf_object__load(obj);
-    if (err) {
-        fprintf(stderr, "ERROR: loading BPF object file failed (error: %d)\n", err);
-        fprintf(stderr, "This may be due to:\n");
-        fprintf(stderr, "  - eBPF instruction limit exceeded (try simple version)\n");
-        fprintf(stderr, "  - Missing sched_ext kernel support\n");
-        fprintf(stderr, "  - Kernel version incompatibility\n");
+    err = load_instance(&cur, objects[0], pin_dir);
+    if (err)
+        goto cleanup;
+    err = attach_instance(&cur);
+    if (err)
         goto cleanup;
-    }
 
     printf("✓ CXL PMU-aware scheduler loaded successfully\n");
     printf("✓ Scheduler is now active and managing tasks\n");
@@ -123,18 +582,37 @@ int main(int argc, char **argv)
     printf("  - Memory access pattern tracking\n");
     printf("  - Dynamic priority adjustment\n");
     printf("  - CXL-aware CPU selection\n");
+    if (pin_dir)
+        printf("\nShared state pinned under %s (SIGUSR1 to hot-swap)\n", pin_dir);
     printf("\nPress Ctrl-C to exit and unload the scheduler\n");
 
     /* Main loop */
+    int elapsed = 0;
     while (!exiting) {
         sleep(1);
+        elapsed++;
+        /* With a single object both triggers reload the same file */
+        if (swap_requested || (swap_every > 0 && elapsed >= swap_every)) {
+            int next = (current + 1) % nr_objects;
+            swap_requested = 0;
+            elapsed = 0;
+            err = hot_swap(&cur, objects[next], pin_dir, sampler);
+            if (err == 0)
+                current = next;
+            else if (!cur.link)
+                goto cleanup;
+        }
     }
 
     printf("\nShutting down scheduler...\n");
+    err = 0;
 
 cleanup:
-    bpf_link__destroy(link);
-    bpf_object__close(obj);
+    destroy_instance(&cur);
+    if (sampler) {
+        munmap(sampler->hdr, sampler->map_size);
+        free(sampler);
+    }
     printf("Scheduler unloaded.\n");
     return err < 0 ? -err : 0;
-}
\ No newline at end of file
+}
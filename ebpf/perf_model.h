@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Fitted per-host bandwidth/latency model shared by cxl_pmu.bpf.c and the
+ * controller, which loads it from the table written by
+ * script/fit_perf_model.py.
+ *
+ * One entry per (CPU node, memory node) pair, keyed by
+ * cpu_node * PERF_MODEL_MAX_NODES + mem_node:
+ * - bw_mbps[r][t]: total bandwidth with threads[t] threads at read ratio
+ *   r * 25%. Informational: the table is carried for tools reading the
+ *   map, and placement does not use it
+ * - lat_ns[l]: latency with the memory node loaded to
+ *   PERF_MODEL_LOAD_PCT[l] percent of peak_mbps, which is what
+ *   cxl_pmu.bpf.c interpolates
+ */
+
+#ifndef __PERF_MODEL_H
+#define __PERF_MODEL_H
+
+#ifndef __bpf__
+#include <linux/types.h>
+#endif
+
+#define PERF_MODEL_VERSION 1
+#define PERF_MODEL_MAX_NODES 8
+#define PERF_MODEL_THREAD_POINTS 8
+#define PERF_MODEL_RATIO_POINTS 5       /* read ratio 0, 25, 50, 75, 100% */
+#define PERF_MODEL_LOAD_POINTS 8
+
+/* Load breakpoints of lat_ns[], percent of peak_mbps */
+#define PERF_MODEL_LOAD_PCT { 0, 25, 50, 70, 80, 90, 95, 100 }
+
+struct perf_model_entry {
+	__u32 nr_threads;               /* used entries of threads[], 0 = no sweep */
+	__u32 threads[PERF_MODEL_THREAD_POINTS];        /* ascending */
+	__u32 bw_mbps[PERF_MODEL_RATIO_POINTS][PERF_MODEL_THREAD_POINTS];
+	__u32 peak_mbps;                /* 0 = no data for this pair */
+	__u32 idle_latency_ns;
+	__u32 lat_ns[PERF_MODEL_LOAD_POINTS];
+};
+
+struct perf_model_meta {
+	__u32 valid;
+	__u32 cxl_latency_ns;           /* latencies above this mean far memory */
+	__s32 home_mem_node[PERF_MODEL_MAX_NODES];      /* per CPU node, -1 = local */
+};
+
+#endif /* __PERF_MODEL_H */
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Binary layout of the task-context snapshot written by the iter/task
+ * program of cxl_pmu_simple.bpf.c and read by cxl_tasks.
+ *
+ * Reading the pinned iterator yields one task_snapshot_header followed by
+ * one task_snapshot_record per task that has a scheduler context. Records
+ * are fixed-size so a reader can walk the buffer without parsing.
+ */
+
+#ifndef __TASK_SNAPSHOT_H
+#define __TASK_SNAPSHOT_H
+
+#ifndef __bpf__
+#include <linux/types.h>
+#endif
+
+#define TASK_SNAPSHOT_MAGIC 0x43584c54   /* "CXLT" */
+#define TASK_SNAPSHOT_VERSION 1
+#define TASK_SNAPSHOT_PIN "/sys/fs/bpf/cxl_task_ctx"
+#define TASK_SNAPSHOT_COMM_LEN 16
+
+struct task_snapshot_header {
+	__u32 magic;
+	__u16 version;
+	__u16 record_size;          /* sizeof(struct task_snapshot_record) */
+	__u64 taken_ns;             /* bpf_ktime_get_ns() at the first record */
+};
+
+struct task_snapshot_record {
+	__u32 pid;
+	__u32 tgid;
+	char comm[TASK_SNAPSHOT_COMM_LEN];
+	__u64 dsq_vtime;
+	__u64 avg_runtime_ns;       /* EWMA of time used per run */
+	__u64 last_access_ns;
+	__u32 weight;
+	__u32 cgrp_slot;            /* (u32)-1 for the root cgroup */
+	__u32 thread_id;
+	__u32 priority_boost;
+	__u32 locality_score;
+	__u32 access_count;
+	__s32 last_cpu;
+	__u8 type;                  /* enum task_type */
+	__u8 is_reader;
+	__u8 is_memory_intensive;
+	__u8 has_pattern;           /* memory_patterns had an entry */
+};
+
+#endif /* __TASK_SNAPSHOT_H */
@@ -5,29 +5,67 @@
  * 1. System memory allocation (CXL integrated as system RAM)
  * 2. Direct physical memory access via /dev/mem
  * 3. Multi-threaded bandwidth testing
+ * 4. Page-fault / first-touch cost per NUMA node
+ * 5. TLB reach and page-table placement (data node x page-table node)
+ * 6. Noisy-neighbour interference between DRAM and CXL traffic
+ * 7. Partial-cacheline and misaligned write cost (temporal and NT stores)
+ * 8. SIMD gather/scatter over random index streams (sparse lookups)
  */
 
+#include "system_state.h"
+
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <fstream>
 #include <getopt.h>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <numa.h>
+#include <numaif.h>
+#include <pthread.h>
+#include <random>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/sysinfo.h>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 // Default parameters
 constexpr size_t DEFAULT_BUFFER_SIZE = 1 * 1024 * 1024 * 1024UL; // 1GB
 constexpr size_t DEFAULT_BLOCK_SIZE = 4096;                      // 4KB
 constexpr int DEFAULT_DURATION = 60;                             // seconds
 constexpr int DEFAULT_NUM_THREADS = 10;   // total threads
 constexpr float DEFAULT_READ_RATIO = 0.5; // 50% readers, 50% writers
+constexpr int DEFAULT_REFAULT_CYCLES = 3; // MADV_DONTNEED/re-touch rounds
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024UL; // 2MB
+constexpr size_t GIGANTIC_PAGE_SIZE = 1024 * 1024 * 1024UL; // 1GB
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t TLB_MIN_WORKING_SET = 1024 * 1024UL; // 1MB
+constexpr size_t TLB_CHASE_ACCESSES = 1 << 21;      // timed loads per point
+constexpr size_t INTERFERENCE_VICTIM_SIZE = 256 * 1024 * 1024UL; // 256MB
+constexpr size_t INTERFERENCE_CHASE_ACCESSES = 1 << 16; // loads per sample
+constexpr int INTERFERENCE_WARMUP_MS = 200;  // aggressors ramp up
+constexpr int INTERFERENCE_WINDOW_MS = 1000; // victim probe per cell
+constexpr size_t PARTIAL_SLOT_STRIDE = 256; // one partial write per slot
+constexpr int PARTIAL_CELL_MS = 250;        // timed writes per sweep point
+constexpr size_t SPARSE_INDEX_COUNT = 1 << 22; // random index stream length
+constexpr size_t SPARSE_CHUNK = 4096;          // indices per kernel call
+constexpr int SPARSE_CELL_MS = 250;            // timed run per sweep point
+
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
 
 struct ThreadStats {
   size_t bytes_processed = 0;
@@ -42,7 +80,12 @@ enum class MemoryMode {
   NUMA_AWARE,      // NUMA-aware system memory
   CXL_INTERLEAVE,  // CXL memory interleave mode (physical access)
   CXL_NUMA,        // CXL memory via NUMA allocation
-  CXL_MULTI        // Multiple CXL buffers on NUMA node
+  CXL_MULTI,       // Multiple CXL buffers on NUMA node
+  FAULT_BENCH,     // Page-fault and first-touch throughput per node
+  TLB_BENCH,       // TLB reach with data/page tables on DRAM or CXL
+  INTERFERENCE,    // Victim latency under DRAM/CXL bandwidth aggressors
+  PARTIAL_WRITE,   // Sub-line and misaligned write cost per node
+  GATHER           // SIMD gather/scatter over random indices per node
 };
 
 struct TestConfig {
@@ -59,6 +102,22 @@ struct TestConfig {
   std::vector<int> cxl_nodes = {0, 1}; // Default CXL NUMA nodes
   int num_cxl_buffers = 2; // Number of CXL buffers for multi mode
   std::vector<uint64_t> cxl_physical_addrs = {0x2080000000ULL, 0x2a5c0000000ULL}; // CXL Window 0, Window 1 physical addresses
+  int refault_cycles = DEFAULT_REFAULT_CYCLES; // Re-fault rounds for fault mode
+  std::string json_path; // Result JSON output (empty = none)
+  // Gather mode sweep
+  std::vector<int> index_widths = {32, 64};    // bits
+  std::vector<int> element_sizes = {4, 8};     // bytes
+  std::vector<int> vector_widths = {0, 256, 512}; // bits, 0 = scalar
+  std::vector<size_t> prefetch_distances = {0, 64}; // elements ahead
+};
+
+// Aggregated counters of a bandwidth run, for the JSON result file
+struct BandwidthResults {
+  double elapsed_seconds = 0;
+  size_t read_bytes = 0;
+  size_t read_ops = 0;
+  size_t write_bytes = 0;
+  size_t write_ops = 0;
 };
 
 void print_usage(const char *prog_name) {
@@ -82,6 +141,16 @@ void print_usage(const char *prog_name) {
          "mode (physical access)\n"
       << "                              cxl: CXL memory via NUMA node\n"
       << "                              multi: Multiple CXL buffers on NUMA node\n"
+      << "                              fault: Page-fault/first-touch cost "
+         "(4KB, THP, hugetlb, MAP_POPULATE)\n"
+      << "                              tlb: Random-access TLB reach for "
+         "-c nodes (data x page tables)\n"
+      << "                              interference: Victim latency vs "
+         "aggressors on every CPU/memory node\n"
+      << "                              partial: 1-128 B writes at "
+         "misaligned offsets on -c nodes\n"
+      << "                              gather: AVX2/AVX-512 gather/scatter "
+         "over random indices on -c nodes\n"
       << "  -a, --address=ADDR        Physical address for physical mode "
          "(hex)\n"
       << "  -n, --numa-node=NODE      NUMA node for numa mode\n"
@@ -90,6 +159,18 @@ void print_usage(const char *prog_name) {
          "0,1)\n"
       << "  -p, --cxl-addrs=ADDRS     CXL physical addresses (comma-separated hex, e.g., "
          "0x2080000000,0x2a5c0000000)\n"
+      << "  -R, --refault-cycles=NUM  MADV_DONTNEED/re-fault rounds for fault "
+         "mode (default: 3)\n"
+      << "  -j, --json=PATH           Write results and system-state deltas "
+         "as JSON\n"
+      << "  -W, --index-width=LIST    Gather index bits, 32 and/or 64 "
+         "(default: 32,64)\n"
+      << "  -E, --element-size=LIST   Gather element bytes, 4 and/or 8 "
+         "(default: 4,8)\n"
+      << "  -V, --vector-width=LIST   scalar, 256 (AVX2) and/or 512 (AVX-512) "
+         "(default: all)\n"
+      << "  -P, --prefetch=LIST       Software prefetch distances in elements "
+         "(default: 0,64)\n"
       << "  -h, --help                Show this help message\n\n"
       << "Examples:\n"
       << "  # System RAM test (CXL memory included in system RAM)\n"
@@ -103,7 +184,32 @@ void print_usage(const char *prog_name) {
       << "  # CXL memory test via NUMA node 2\n"
       << "  " << prog_name << " -m cxl -n 2 -t 16 -r 0.6 -d 60\n\n"
       << "  # Multiple CXL buffers on NUMA node 2 (simulates 2 devices)\n"
-      << "  " << prog_name << " -m multi -n 2 -c 2 -t 16 -r 0.6 -d 60\n";
+      << "  " << prog_name << " -m multi -n 2 -c 2 -t 16 -r 0.6 -d 60\n\n"
+      << "  # Fault throughput with 1..16 threads on every node (1GB per run)\n"
+      << "  " << prog_name << " -m fault -t 16 -b 1073741824\n\n"
+      << "  # Page-walk penalty: data and page tables on node 0 or 2, CPU on node 0\n"
+      << "  " << prog_name << " -m tlb -c 0,2 -n 0 -b 4294967296\n\n"
+      << "  # Victim on CPU node 0 vs up to 8 aggressors, memory nodes 0 and 2\n"
+      << "  " << prog_name << " -m interference -c 0,2 -n 0 -t 8 -r 1.0\n\n"
+      << "  # Partial/unaligned write cost on DRAM node 0 and CXL node 2\n"
+      << "  " << prog_name << " -m partial -c 0,2 -n 0 -t 4 -b 268435456\n\n"
+      << "  # Embedding-style 32-bit gathers, 4GB table on node 0 and 2\n"
+      << "  " << prog_name
+      << " -m gather -c 0,2 -n 0 -t 1 -W 32 -V 256,512 -P 0,16,64 -b 4294967296\n";
+}
+
+// Split "a,b,c"
+std::vector<std::string> split_list(const std::string &list) {
+  std::vector<std::string> items;
+  size_t pos = 0;
+  while (pos < list.length()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos)
+      comma = list.length();
+    items.push_back(list.substr(pos, comma - pos));
+    pos = comma + 1;
+  }
+  return items;
 }
 
 TestConfig parse_args(int argc, char *argv[]) {
@@ -121,11 +227,17 @@ TestConfig parse_args(int argc, char *argv[]) {
       {"interleave", no_argument, 0, 'i'},
       {"cxl-nodes", required_argument, 0, 'c'},
       {"cxl-addrs", required_argument, 0, 'p'},
+      {"refault-cycles", required_argument, 0, 'R'},
+      {"json", required_argument, 0, 'j'},
+      {"index-width", required_argument, 0, 'W'},
+      {"element-size", required_argument, 0, 'E'},
+      {"vector-width", required_argument, 0, 'V'},
+      {"prefetch", required_argument, 0, 'P'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}};
 
   int opt, option_index = 0;
-  while ((opt = getopt_long(argc, argv, "b:s:t:d:r:m:a:n:ic:p:h", long_options,
+  while ((opt = getopt_long(argc, argv, "b:s:t:d:r:m:a:n:ic:p:R:j:W:E:V:P:h", long_options,
                             &option_index)) != -1) {
     switch (opt) {
     case 'b':
@@ -167,9 +279,20 @@ TestConfig parse_args(int argc, char *argv[]) {
         config.use_numa = true;
         config.numa_node = 2; // Default to CXL NUMA node
         config.enable_interleave = true;
+      } else if (std::string(optarg) == "fault") {
+        config.mode = MemoryMode::FAULT_BENCH;
+      } else if (std::string(optarg) == "tlb") {
+        config.mode = MemoryMode::TLB_BENCH;
+      } else if (std::string(optarg) == "interference") {
+        config.mode = MemoryMode::INTERFERENCE;
+      } else if (std::string(optarg) == "partial") {
+        config.mode = MemoryMode::PARTIAL_WRITE;
+      } else if (std::string(optarg) == "gather") {
+        config.mode = MemoryMode::GATHER;
       } else {
-        std::cerr
-            << "Invalid mode. Use: system, physical, numa, interleave, cxl, or multi\n";
+        std::cerr << "Invalid mode. Use: system, physical, numa, interleave, "
+                     "cxl, multi, fault, tlb, interference, partial, or "
+                     "gather\n";
         exit(1);
       }
       break;
@@ -217,6 +340,43 @@ TestConfig parse_args(int argc, char *argv[]) {
       }
       break;
     }
+    case 'R':
+      config.refault_cycles = std::stoi(optarg);
+      break;
+    case 'j':
+      config.json_path = optarg;
+      break;
+    case 'W':
+    case 'E':
+    case 'V':
+    case 'P': {
+      std::vector<int> values;
+      for (const std::string &item : split_list(optarg)) {
+        values.push_back(item == "scalar" ? 0 : std::stoi(item));
+      }
+      bool valid = !values.empty();
+      for (int v : values) {
+        valid = valid && (opt == 'W'   ? v == 32 || v == 64
+                          : opt == 'E' ? v == 4 || v == 8
+                          : opt == 'V' ? v == 0 || v == 256 || v == 512
+                                       : v >= 0);
+      }
+      if (!valid) {
+        std::cerr << "Invalid value list for -" << static_cast<char>(opt)
+                  << ": " << optarg << "\n";
+        exit(1);
+      }
+      if (opt == 'W') {
+        config.index_widths = values;
+      } else if (opt == 'E') {
+        config.element_sizes = values;
+      } else if (opt == 'V') {
+        config.vector_widths = values;
+      } else {
+        config.prefetch_distances.assign(values.begin(), values.end());
+      }
+      break;
+    }
     case 'h':
       print_usage(argv[0]);
       exit(0);
@@ -231,9 +391,9 @@ TestConfig parse_args(int argc, char *argv[]) {
 
 void system_reader_thread(void *buffer, size_t buffer_size, size_t block_size,
                           std::atomic<bool> &stop_flag, ThreadStats &stats,
-                          int thread_id) {
+                          int thread_id, size_t start_offset) {
   std::vector<char> local_buffer(block_size);
-  size_t offset = 0;
+  size_t offset = start_offset;
 
   stats.thread_id = thread_id;
   stats.operation_type = "read";
@@ -254,9 +414,9 @@ void system_reader_thread(void *buffer, size_t buffer_size, size_t block_size,
 
 void system_writer_thread(void *buffer, size_t buffer_size, size_t block_size,
                           std::atomic<bool> &stop_flag, ThreadStats &stats,
-                          int thread_id) {
+                          int thread_id, size_t start_offset) {
   std::vector<char> local_buffer(block_size, 'W');
-  size_t offset = 0;
+  size_t offset = start_offset;
 
   stats.thread_id = thread_id;
   stats.operation_type = "write";
@@ -333,6 +493,1392 @@ void interleave_writer_thread(std::vector<void *> &buffers, size_t buffer_size,
   }
 }
 
+// Page kinds exercised by the fault benchmark
+enum class FaultKind {
+  SMALL_PAGE, // 4KB pages, THP disabled with MADV_NOHUGEPAGE
+  THP,        // Transparent huge pages via MADV_HUGEPAGE
+  HUGETLB,    // Pre-reserved 2MB pages via MAP_HUGETLB
+  POPULATE    // 4KB pages pre-faulted by MAP_POPULATE
+};
+
+const char *fault_kind_name(FaultKind kind) {
+  switch (kind) {
+  case FaultKind::SMALL_PAGE:
+    return "4KB";
+  case FaultKind::THP:
+    return "THP";
+  case FaultKind::HUGETLB:
+    return "hugetlb";
+  case FaultKind::POPULATE:
+    return "populate";
+  }
+  return "unknown";
+}
+
+// Sense-reversing spin barrier so all threads start faulting together
+class SpinBarrier {
+public:
+  explicit SpinBarrier(int count) : count_(count), waiting_(0), sense_(false) {}
+
+  void wait() {
+    bool sense = sense_.load(std::memory_order_relaxed);
+    if (waiting_.fetch_add(1, std::memory_order_acq_rel) == count_ - 1) {
+      waiting_.store(0, std::memory_order_relaxed);
+      sense_.store(!sense, std::memory_order_release);
+    } else {
+      while (sense_.load(std::memory_order_acquire) == sense) {
+      }
+    }
+  }
+
+private:
+  const int count_;
+  std::atomic<int> waiting_;
+  std::atomic<bool> sense_;
+};
+
+struct FaultPhase {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+  long faults = 0;
+  bool ok = true;
+};
+
+struct FaultThreadResult {
+  FaultPhase first_touch;
+  std::vector<FaultPhase> refault;
+};
+
+struct FaultRunResult {
+  bool available = false;
+  double first_touch_faults_per_sec = 0;
+  double first_touch_gbps = 0;
+  bool refault_available = false;
+  double refault_faults_per_sec = 0;
+  double refault_gbps = 0;
+};
+
+long thread_minor_faults() {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_minflt;
+}
+
+// Write one byte per base page; huge pages fault once per 2MB
+void touch_pages(char *region, size_t size) {
+  for (size_t offset = 0; offset < size; offset += DEFAULT_BLOCK_SIZE) {
+    region[offset] = 1;
+  }
+}
+
+// Map an anonymous region for the given kind, faulting it in when populating
+char *map_fault_region(FaultKind kind, size_t size) {
+  if (kind == FaultKind::HUGETLB) {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<char *>(ptr);
+  }
+  if (kind == FaultKind::POPULATE) {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<char *>(ptr);
+  }
+
+  // Over-map and trim so THP can back the whole region with 2MB pages
+  void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+  uintptr_t aligned = (base + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  if (aligned > base) {
+    munmap(raw, aligned - base);
+  }
+  size_t tail = base + size + HUGE_PAGE_SIZE - (aligned + size);
+  if (tail > 0) {
+    munmap(reinterpret_cast<void *>(aligned + size), tail);
+  }
+  char *region = reinterpret_cast<char *>(aligned);
+  madvise(region, size,
+          kind == FaultKind::THP ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+  return region;
+}
+
+void fault_thread(FaultKind kind, int node, size_t region_size,
+                  int refault_cycles, SpinBarrier &barrier,
+                  FaultThreadResult &result) {
+  // Bind this thread's future page allocations to the node under test
+  struct bitmask *mask = numa_allocate_nodemask();
+  numa_bitmask_setbit(mask, node);
+  set_mempolicy(MPOL_BIND, mask->maskp, mask->size + 1);
+  numa_free_nodemask(mask);
+
+  result.refault.resize(refault_cycles);
+
+  barrier.wait();
+  FaultPhase &first = result.first_touch;
+  long faults_before = thread_minor_faults();
+  first.start = std::chrono::steady_clock::now();
+  char *region = map_fault_region(kind, region_size);
+  if (region != nullptr && kind != FaultKind::POPULATE) {
+    touch_pages(region, region_size);
+  }
+  first.end = std::chrono::steady_clock::now();
+  first.faults = thread_minor_faults() - faults_before;
+  first.ok = region != nullptr;
+
+  for (int cycle = 0; cycle < refault_cycles; cycle++) {
+    FaultPhase &phase = result.refault[cycle];
+    barrier.wait();
+    phase.ok = region != nullptr &&
+               madvise(region, region_size, MADV_DONTNEED) == 0;
+    faults_before = thread_minor_faults();
+    phase.start = std::chrono::steady_clock::now();
+    if (phase.ok) {
+      touch_pages(region, region_size);
+    }
+    phase.end = std::chrono::steady_clock::now();
+    phase.faults = thread_minor_faults() - faults_before;
+  }
+
+  if (region != nullptr) {
+    munmap(region, region_size);
+  }
+}
+
+// Wall time of a phase is from the earliest start to the latest finish
+void accumulate_phase(const std::vector<const FaultPhase *> &phases,
+                      double &seconds, long &faults, bool &ok) {
+  auto start = phases.front()->start;
+  auto end = phases.front()->end;
+  for (const FaultPhase *phase : phases) {
+    start = std::min(start, phase->start);
+    end = std::max(end, phase->end);
+    faults += phase->faults;
+    ok = ok && phase->ok;
+  }
+  seconds += std::chrono::duration<double>(end - start).count();
+}
+
+FaultRunResult run_fault_case(FaultKind kind, int node, int num_threads,
+                              size_t region_size, int refault_cycles) {
+  SpinBarrier barrier(num_threads);
+  std::vector<FaultThreadResult> results(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(fault_thread, kind, node, region_size, refault_cycles,
+                         std::ref(barrier), std::ref(results[i]));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  FaultRunResult run;
+  double total_gb =
+      static_cast<double>(region_size) * num_threads / (1024.0 * 1024.0 * 1024.0);
+
+  std::vector<const FaultPhase *> phases;
+  for (const auto &r : results) {
+    phases.push_back(&r.first_touch);
+  }
+  double seconds = 0;
+  long faults = 0;
+  run.available = true;
+  accumulate_phase(phases, seconds, faults, run.available);
+  if (!run.available) {
+    return run;
+  }
+  run.first_touch_faults_per_sec = faults / seconds;
+  run.first_touch_gbps = total_gb / seconds;
+
+  if (refault_cycles > 0) {
+    seconds = 0;
+    faults = 0;
+    run.refault_available = true;
+    for (int cycle = 0; cycle < refault_cycles; cycle++) {
+      phases.clear();
+      for (const auto &r : results) {
+        phases.push_back(&r.refault[cycle]);
+      }
+      accumulate_phase(phases, seconds, faults, run.refault_available);
+    }
+    if (run.refault_available) {
+      run.refault_faults_per_sec = faults / seconds;
+      run.refault_gbps = total_gb * refault_cycles / seconds;
+    }
+  }
+  return run;
+}
+
+int run_fault_benchmark(const TestConfig &config,
+                        std::vector<JsonRow> &rows) {
+  if (numa_available() < 0) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+
+  std::vector<int> nodes;
+  if (config.numa_node >= 0) {
+    nodes.push_back(config.numa_node);
+  } else {
+    for (int node = 0; node <= numa_max_node(); node++) {
+      if (numa_node_size64(node, nullptr) > 0) {
+        nodes.push_back(node);
+      }
+    }
+  }
+
+  // 1, 2, 4, ... up to and including the requested thread count
+  std::vector<int> thread_counts;
+  for (int n = 1; n < config.num_threads; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  thread_counts.push_back(config.num_threads);
+
+  const FaultKind kinds[] = {FaultKind::SMALL_PAGE, FaultKind::THP,
+                             FaultKind::HUGETLB, FaultKind::POPULATE};
+
+  std::cout << "\nRe-fault cycles: " << config.refault_cycles << std::endl;
+
+  for (int node : nodes) {
+    std::cout << "\n=== Fault Results: NUMA node " << node << " ===" << std::endl;
+    std::cout << std::left << std::setw(10) << "kind" << std::right
+              << std::setw(8) << "threads" << std::setw(14) << "region MB"
+              << std::setw(16) << "touch flt/s" << std::setw(12) << "touch GB/s"
+              << std::setw(16) << "refault flt/s" << std::setw(14)
+              << "refault GB/s" << std::endl;
+
+    for (FaultKind kind : kinds) {
+      for (int num_threads : thread_counts) {
+        // Per-thread regions are whole 2MB pages so every kind maps the same size
+        size_t region_size = config.buffer_size / num_threads;
+        region_size = std::max(region_size & ~(HUGE_PAGE_SIZE - 1), HUGE_PAGE_SIZE);
+
+        FaultRunResult run = run_fault_case(kind, node, num_threads,
+                                            region_size, config.refault_cycles);
+
+        std::cout << std::left << std::setw(10) << fault_kind_name(kind)
+                  << std::right << std::setw(8) << num_threads << std::setw(14)
+                  << region_size / (1024 * 1024);
+        if (!run.available) {
+          std::cout << std::setw(16) << "unavailable" << std::endl;
+          if (kind == FaultKind::HUGETLB) {
+            // No reserved huge pages on this node; larger runs will fail too
+            break;
+          }
+          continue;
+        }
+        std::cout << std::fixed << std::setprecision(0) << std::setw(16)
+                  << run.first_touch_faults_per_sec << std::setprecision(2)
+                  << std::setw(12) << run.first_touch_gbps;
+        JsonRow &row = rows.emplace_back();
+        row.key("node", node)
+            .key("kind", fault_kind_name(kind))
+            .key("threads", num_threads)
+            .metric("first_touch_faults_per_sec",
+                    run.first_touch_faults_per_sec)
+            .metric("first_touch_gbps", run.first_touch_gbps);
+        if (run.refault_available) {
+          row.metric("refault_faults_per_sec", run.refault_faults_per_sec)
+              .metric("refault_gbps", run.refault_gbps);
+          std::cout << std::setprecision(0) << std::setw(16)
+                    << run.refault_faults_per_sec << std::setprecision(2)
+                    << std::setw(14) << run.refault_gbps;
+        } else {
+          std::cout << std::setw(16) << "n/a" << std::setw(14) << "n/a";
+        }
+        std::cout << std::defaultfloat << std::endl;
+      }
+    }
+  }
+  return 0;
+}
+
+// Page sizes exercised by the TLB benchmark
+enum class TlbPageSize {
+  PAGE_4KB, // Base pages, THP disabled
+  PAGE_2MB, // Transparent huge pages
+  PAGE_1GB  // hugetlb gigantic pages (must be reserved)
+};
+
+const char *tlb_page_name(TlbPageSize page) {
+  switch (page) {
+  case TlbPageSize::PAGE_4KB:
+    return "4KB";
+  case TlbPageSize::PAGE_2MB:
+    return "2MB (THP)";
+  case TlbPageSize::PAGE_1GB:
+    return "1GB (hugetlb)";
+  }
+  return "unknown";
+}
+
+size_t tlb_page_bytes(TlbPageSize page) {
+  switch (page) {
+  case TlbPageSize::PAGE_4KB:
+    return DEFAULT_BLOCK_SIZE;
+  case TlbPageSize::PAGE_2MB:
+    return HUGE_PAGE_SIZE;
+  case TlbPageSize::PAGE_1GB:
+    return GIGANTIC_PAGE_SIZE;
+  }
+  return DEFAULT_BLOCK_SIZE;
+}
+
+char *map_tlb_region(TlbPageSize page, size_t size) {
+  switch (page) {
+  case TlbPageSize::PAGE_4KB:
+    return map_fault_region(FaultKind::SMALL_PAGE, size);
+  case TlbPageSize::PAGE_2MB:
+    return map_fault_region(FaultKind::THP, size);
+  case TlbPageSize::PAGE_1GB: {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB,
+                     -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<char *>(ptr);
+  }
+  }
+  return nullptr;
+}
+
+// Build a random cycle visiting one random cache line in every `stride`
+// bytes (default: every 4KB page) of the working set. Faults happen here, so
+// page tables follow the task policy. Returns the first element of the cycle.
+char *build_tlb_chain(char *region, size_t working_set, std::mt19937_64 &rng,
+                      size_t stride = DEFAULT_BLOCK_SIZE) {
+  size_t num_pages = working_set / stride;
+  const size_t lines_per_page = stride / CACHE_LINE_SIZE;
+
+  std::vector<char *> slots(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    slots[i] = region + i * stride + (rng() % lines_per_page) * CACHE_LINE_SIZE;
+  }
+  std::shuffle(slots.begin(), slots.end(), rng);
+  for (size_t i = 0; i < num_pages; i++) {
+    *reinterpret_cast<char **>(slots[i]) = slots[(i + 1) % num_pages];
+  }
+  return slots[0];
+}
+
+double chase_ns_per_access(char *start, size_t accesses) {
+  char *p = start;
+  for (size_t i = 0; i < accesses; i++) {
+    p = *reinterpret_cast<char **>(p);
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < accesses; i++) {
+    p = *reinterpret_cast<char **>(p);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  // Keep the dependent loads from being optimized away
+  char *volatile sink = p;
+  (void)sink;
+  return std::chrono::duration<double, std::nano>(end - begin).count() /
+         accesses;
+}
+
+// Returns ns/access, or a negative value when the pages cannot be mapped
+double run_tlb_case(TlbPageSize page, int data_node, int pt_node,
+                    size_t working_set) {
+  size_t page_bytes = tlb_page_bytes(page);
+  size_t region_size = (working_set + page_bytes - 1) / page_bytes * page_bytes;
+
+  // Page-table pages come from the task policy at fault time, data pages
+  // from the VMA policy set with mbind below
+  struct bitmask *pt_mask = numa_allocate_nodemask();
+  numa_bitmask_setbit(pt_mask, pt_node);
+  set_mempolicy(MPOL_BIND, pt_mask->maskp, pt_mask->size + 1);
+  numa_free_nodemask(pt_mask);
+
+  double ns = -1;
+  char *region = map_tlb_region(page, region_size);
+  if (region != nullptr) {
+    struct bitmask *data_mask = numa_allocate_nodemask();
+    numa_bitmask_setbit(data_mask, data_node);
+    if (mbind(region, region_size, MPOL_BIND, data_mask->maskp,
+              data_mask->size + 1, 0) == 0) {
+      std::mt19937_64 rng(working_set);
+      char *start = build_tlb_chain(region, working_set, rng);
+      ns = chase_ns_per_access(start, TLB_CHASE_ACCESSES);
+    }
+    numa_free_nodemask(data_mask);
+    munmap(region, region_size);
+  }
+
+  set_mempolicy(MPOL_DEFAULT, nullptr, 0);
+  return ns;
+}
+
+int run_tlb_benchmark(const TestConfig &config,
+                      std::vector<JsonRow> &rows) {
+  if (numa_available() < 0) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+
+  std::vector<int> nodes;
+  for (int node : config.cxl_nodes) {
+    if (node > numa_max_node() || numa_node_size64(node, nullptr) <= 0) {
+      std::cerr << "Skipping NUMA node " << node << ": no memory" << std::endl;
+      continue;
+    }
+    nodes.push_back(node);
+  }
+  if (nodes.empty()) {
+    std::cerr << "No usable NUMA nodes given with -c" << std::endl;
+    return 1;
+  }
+
+  if (config.numa_node >= 0 && numa_run_on_node(config.numa_node) != 0) {
+    std::cerr << "Failed to run on NUMA node " << config.numa_node << ": "
+              << strerror(errno) << std::endl;
+    return 1;
+  }
+
+  std::vector<size_t> working_sets;
+  for (size_t ws = TLB_MIN_WORKING_SET; ws <= config.buffer_size; ws *= 2) {
+    working_sets.push_back(ws);
+  }
+
+  std::cout << "\nCPU node: "
+            << (config.numa_node >= 0 ? std::to_string(config.numa_node)
+                                      : std::string("any"))
+            << ", accesses per point: " << TLB_CHASE_ACCESSES << std::endl;
+
+  const TlbPageSize pages[] = {TlbPageSize::PAGE_4KB, TlbPageSize::PAGE_2MB,
+                               TlbPageSize::PAGE_1GB};
+  for (TlbPageSize page : pages) {
+    std::cout << "\n=== TLB Results: " << tlb_page_name(page)
+              << " pages, ns/access (data node/page-table node) ==="
+              << std::endl;
+    std::cout << std::left << std::setw(14) << "working set" << std::right;
+    for (int data_node : nodes) {
+      for (int pt_node : nodes) {
+        std::cout << std::setw(12)
+                  << ("D" + std::to_string(data_node) + "/PT" +
+                      std::to_string(pt_node));
+      }
+    }
+    std::cout << std::endl;
+
+    for (size_t ws : working_sets) {
+      std::cout << std::left << std::setw(14)
+                << (std::to_string(ws / (1024 * 1024)) + " MB") << std::right
+                << std::fixed << std::setprecision(1);
+      for (int data_node : nodes) {
+        for (int pt_node : nodes) {
+          double ns = run_tlb_case(page, data_node, pt_node, ws);
+          if (ns < 0) {
+            std::cout << std::setw(12) << "n/a";
+          } else {
+            std::cout << std::setw(12) << ns;
+            rows.emplace_back()
+                .key("page", tlb_page_name(page))
+                .key("data_node", data_node)
+                .key("pt_node", pt_node)
+                .key("working_set_mb", ws / (1024 * 1024))
+                .metric("latency_ns", ns);
+          }
+        }
+      }
+      std::cout << std::defaultfloat << std::endl;
+    }
+  }
+  return 0;
+}
+
+// CPUs of a NUMA node, empty for memory-only (CXL) nodes
+std::vector<int> numa_node_cpus(int node) {
+  std::vector<int> cpus;
+  struct bitmask *mask = numa_allocate_cpumask();
+  if (numa_node_to_cpus(node, mask) == 0) {
+    for (unsigned int cpu = 0; cpu < mask->size; cpu++) {
+      if (numa_bitmask_isbitset(mask, cpu)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  numa_free_cpumask(mask);
+  return cpus;
+}
+
+bool pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+struct VictimSample {
+  double latency_ns = 0;   // median pointer-chase latency
+  double bandwidth_mbps = 0; // single-thread sequential read
+};
+
+// Latency probe for the first half of the window, then a sequential-read
+// bandwidth probe for the second half, on the calling thread
+VictimSample probe_victim(char *chain_start, char *buffer, size_t size,
+                          int window_ms) {
+  VictimSample sample;
+  auto half = std::chrono::milliseconds(window_ms / 2);
+
+  std::vector<double> latencies;
+  auto until = std::chrono::steady_clock::now() + half;
+  while (latencies.empty() || std::chrono::steady_clock::now() < until) {
+    latencies.push_back(
+        chase_ns_per_access(chain_start, INTERFERENCE_CHASE_ACCESSES));
+  }
+  std::nth_element(latencies.begin(),
+                   latencies.begin() + latencies.size() / 2, latencies.end());
+  sample.latency_ns = latencies[latencies.size() / 2];
+
+  std::vector<char> local(DEFAULT_BLOCK_SIZE);
+  size_t bytes = 0, offset = 0;
+  auto start = std::chrono::steady_clock::now();
+  until = start + half;
+  do {
+    for (int i = 0; i < 64; i++) {
+      std::memcpy(local.data(), buffer + offset, DEFAULT_BLOCK_SIZE);
+      offset = (offset + DEFAULT_BLOCK_SIZE) % (size - DEFAULT_BLOCK_SIZE);
+    }
+    bytes += 64 * DEFAULT_BLOCK_SIZE;
+  } while (std::chrono::steady_clock::now() < until);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              start)
+                    .count();
+  sample.bandwidth_mbps = bytes / (1024.0 * 1024.0) / secs;
+  return sample;
+}
+
+struct InterferenceCell {
+  int aggressors = 0;
+  double aggressor_mbps = 0;
+  VictimSample victim;
+};
+
+// Runs `aggressor_cpus` streaming threads (readers per read_ratio, the rest
+// writers) on `aggressor_buffer` while the victim probes on `victim_cpu`
+InterferenceCell run_interference_cell(const TestConfig &config, int victim_cpu,
+                                       char *chain_start, char *victim_buffer,
+                                       size_t victim_size,
+                                       const std::vector<int> &aggressor_cpus,
+                                       void *aggressor_buffer) {
+  InterferenceCell cell;
+  cell.aggressors = aggressor_cpus.size();
+
+  int num_readers = static_cast<int>(cell.aggressors * config.read_ratio);
+  size_t blocks = (config.buffer_size - config.block_size) / config.block_size;
+  std::vector<ThreadStats> stats(cell.aggressors);
+  std::atomic<bool> stop_flag(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < cell.aggressors; i++) {
+    int cpu = aggressor_cpus[i];
+    // Scattered start blocks, so aggressors do not stream the same lines in
+    // lockstep and hit in the LLC instead of loading the memory node
+    size_t start = (i * 0x9e3779b1ULL) % blocks * config.block_size;
+    threads.emplace_back([&, i, cpu, start] {
+      pin_to_cpu(cpu);
+      if (i < num_readers) {
+        system_reader_thread(aggressor_buffer, config.buffer_size,
+                             config.block_size, stop_flag, stats[i], i,
+                             start);
+      } else {
+        system_writer_thread(aggressor_buffer, config.buffer_size,
+                             config.block_size, stop_flag, stats[i], i,
+                             start);
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(INTERFERENCE_WARMUP_MS));
+  std::thread victim([&] {
+    pin_to_cpu(victim_cpu);
+    cell.victim = probe_victim(chain_start, victim_buffer, victim_size,
+                               INTERFERENCE_WINDOW_MS);
+  });
+  victim.join();
+  stop_flag.store(true, std::memory_order_relaxed);
+  for (auto &t : threads) {
+    t.join();
+  }
+  double secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  size_t bytes = 0;
+  for (const auto &s : stats) {
+    bytes += s.bytes_processed;
+  }
+  cell.aggressor_mbps = bytes / (1024.0 * 1024.0) / secs;
+  return cell;
+}
+
+// Victim latency probe on (CPU node, memory node) against bandwidth
+// aggressors on every (CPU node, memory node) pair at stepped thread counts
+int run_interference_benchmark(const TestConfig &config,
+                               std::vector<JsonRow> &rows) {
+  if (numa_available() < 0) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+
+  std::vector<int> cpu_nodes, mem_nodes;
+  for (int node = 0; node <= numa_max_node(); node++) {
+    if (!numa_node_cpus(node).empty()) {
+      cpu_nodes.push_back(node);
+    }
+  }
+  for (int node : config.cxl_nodes) {
+    if (node > numa_max_node() || numa_node_size64(node, nullptr) <= 0) {
+      std::cerr << "Skipping NUMA node " << node << ": no memory" << std::endl;
+      continue;
+    }
+    mem_nodes.push_back(node);
+  }
+  if (cpu_nodes.empty() || mem_nodes.empty()) {
+    std::cerr << "No usable CPU nodes or memory nodes (-c)" << std::endl;
+    return 1;
+  }
+  std::vector<int> victim_cpu_nodes = cpu_nodes;
+  if (config.numa_node >= 0) {
+    victim_cpu_nodes = {config.numa_node};
+  }
+
+  // Aggressor buffers, one per memory node, faulted in up front
+  std::map<int, void *> aggressor_buffers;
+  for (int node : mem_nodes) {
+    void *buf = numa_alloc_onnode(config.buffer_size, node);
+    if (!buf) {
+      std::cerr << "Failed to allocate " << config.buffer_size
+                << " bytes on node " << node << std::endl;
+      for (auto &entry : aggressor_buffers) {
+        numa_free(entry.second, config.buffer_size);
+      }
+      return 1;
+    }
+    std::memset(buf, 'A', config.buffer_size);
+    aggressor_buffers[node] = buf;
+  }
+
+  size_t victim_size = std::min(config.buffer_size, INTERFERENCE_VICTIM_SIZE);
+  std::cout << "\nVictim working set: " << victim_size / (1024 * 1024)
+            << " MB, window " << INTERFERENCE_WINDOW_MS
+            << " ms per cell, aggressor block " << config.block_size
+            << " bytes, read ratio " << config.read_ratio << std::endl;
+
+  for (int victim_cpu_node : victim_cpu_nodes) {
+    std::vector<int> victim_node_cpus = numa_node_cpus(victim_cpu_node);
+    if (victim_node_cpus.empty()) {
+      std::cerr << "NUMA node " << victim_cpu_node << " has no CPUs"
+                << std::endl;
+      continue;
+    }
+    int victim_cpu = victim_node_cpus.front();
+
+    for (int victim_mem_node : mem_nodes) {
+      char *victim_buffer = static_cast<char *>(
+          numa_alloc_onnode(victim_size, victim_mem_node));
+      if (!victim_buffer) {
+        std::cerr << "Failed to allocate victim buffer on node "
+                  << victim_mem_node << std::endl;
+        continue;
+      }
+      std::mt19937_64 rng(victim_size);
+      // Every cache line, so the chase misses the LLC like a cold service
+      char *chain_start =
+          build_tlb_chain(victim_buffer, victim_size, rng, CACHE_LINE_SIZE);
+
+      InterferenceCell idle = run_interference_cell(
+          config, victim_cpu, chain_start, victim_buffer, victim_size, {},
+          nullptr);
+
+      std::cout << "\n=== Interference: victim CPU " << victim_cpu << " (node "
+                << victim_cpu_node << "), memory node " << victim_mem_node
+                << " ===" << std::endl;
+      std::cout << std::fixed << std::setprecision(1)
+                << "Idle: " << idle.victim.latency_ns << " ns, "
+                << idle.victim.bandwidth_mbps << " MB/s" << std::endl;
+      rows.emplace_back()
+          .key("victim_cpu_node", victim_cpu_node)
+          .key("victim_mem_node", victim_mem_node)
+          .key("threads", 0)
+          .metric("victim_latency_ns", idle.victim.latency_ns)
+          .metric("victim_bandwidth_mbps", idle.victim.bandwidth_mbps);
+      std::cout << std::left << std::setw(12) << "aggressor" << std::right
+                << std::setw(9) << "threads" << std::setw(13) << "aggr MB/s"
+                << std::setw(12) << "victim ns" << std::setw(10) << "lat +%"
+                << std::setw(13) << "victim MB/s" << std::setw(10) << "bw -%"
+                << std::endl;
+
+      // Worst (highest-intensity) degradation per aggressor placement
+      std::map<std::pair<int, int>, InterferenceCell> worst;
+      for (int aggr_cpu_node : cpu_nodes) {
+        std::vector<int> cpus;
+        for (int cpu : numa_node_cpus(aggr_cpu_node)) {
+          if (cpu != victim_cpu) {
+            cpus.push_back(cpu);
+          }
+        }
+        int max_threads = std::min<int>(config.num_threads, cpus.size());
+        if (max_threads == 0) {
+          std::cout << "  node " << aggr_cpu_node
+                    << ": no CPUs left for aggressors" << std::endl;
+          continue;
+        }
+
+        // 1, 2, 4, ... up to and including the thread cap
+        std::vector<int> intensities;
+        for (int n = 1; n < max_threads; n *= 2) {
+          intensities.push_back(n);
+        }
+        intensities.push_back(max_threads);
+
+        for (int aggr_mem_node : mem_nodes) {
+          std::string label = "C" + std::to_string(aggr_cpu_node) + "->M" +
+                              std::to_string(aggr_mem_node);
+          for (int n : intensities) {
+            std::vector<int> aggressor_cpus(cpus.begin(), cpus.begin() + n);
+            InterferenceCell cell = run_interference_cell(
+                config, victim_cpu, chain_start, victim_buffer, victim_size,
+                aggressor_cpus, aggressor_buffers[aggr_mem_node]);
+            double lat_pct =
+                (cell.victim.latency_ns / idle.victim.latency_ns - 1) * 100;
+            double bw_pct = (1 - cell.victim.bandwidth_mbps /
+                                     idle.victim.bandwidth_mbps) *
+                            100;
+            std::cout << std::left << std::setw(12) << label << std::right
+                      << std::setw(9) << n << std::setw(13)
+                      << cell.aggressor_mbps << std::setw(12)
+                      << cell.victim.latency_ns << std::setw(10) << lat_pct
+                      << std::setw(13) << cell.victim.bandwidth_mbps
+                      << std::setw(10) << bw_pct << std::endl;
+            rows.emplace_back()
+                .key("victim_cpu_node", victim_cpu_node)
+                .key("victim_mem_node", victim_mem_node)
+                .key("aggressor_cpu_node", aggr_cpu_node)
+                .key("aggressor_mem_node", aggr_mem_node)
+                .key("threads", n)
+                .metric("aggressor_bandwidth_mbps", cell.aggressor_mbps)
+                .metric("victim_latency_ns", cell.victim.latency_ns)
+                .metric("victim_bandwidth_mbps", cell.victim.bandwidth_mbps);
+            worst[{aggr_cpu_node, aggr_mem_node}] = cell;
+          }
+        }
+      }
+
+      if (!worst.empty()) {
+        std::cout << "\nLatency increase % at max intensity "
+                     "(rows: aggressor CPU node, columns: aggressor memory node)"
+                  << std::endl;
+        std::cout << std::setw(8) << "";
+        for (int mem_node : mem_nodes) {
+          std::cout << std::setw(10) << ("M" + std::to_string(mem_node));
+        }
+        std::cout << std::endl;
+        for (int cpu_node : cpu_nodes) {
+          std::cout << std::setw(8) << ("C" + std::to_string(cpu_node));
+          for (int mem_node : mem_nodes) {
+            auto it = worst.find({cpu_node, mem_node});
+            if (it == worst.end()) {
+              std::cout << std::setw(10) << "n/a";
+            } else {
+              std::cout << std::setw(10)
+                        << (it->second.victim.latency_ns /
+                                idle.victim.latency_ns -
+                            1) * 100;
+            }
+          }
+          std::cout << std::endl;
+        }
+      }
+      std::cout << std::defaultfloat;
+
+      numa_free(victim_buffer, victim_size);
+    }
+  }
+
+  for (auto &entry : aggressor_buffers) {
+    numa_free(entry.second, config.buffer_size);
+  }
+  return 0;
+}
+
+// Partial-line writes: every store lands in its own PARTIAL_SLOT_STRIDE
+// slot, at `offset` bytes into the slot's first cache line
+template <size_t SIZE, bool NT>
+inline void partial_store(char *dst, const char *src) {
+#if defined(__x86_64__)
+  if constexpr (NT) {
+    size_t done = 0;
+    for (; done + 8 <= SIZE; done += 8) {
+      long long v;
+      std::memcpy(&v, src + done, 8);
+      _mm_stream_si64(reinterpret_cast<long long *>(dst + done), v);
+    }
+    if constexpr (SIZE % 8 >= 4) {
+      int v;
+      std::memcpy(&v, src + done, 4);
+      _mm_stream_si32(reinterpret_cast<int *>(dst + done), v);
+      done += 4;
+    }
+    if constexpr (SIZE % 4 != 0) {
+      // No sub-dword movnti; maskmovdqu is the byte-granular NT store
+      alignas(16) char tail[16] = {};
+      std::memcpy(tail, src + done, SIZE % 4);
+      const __m128i mask = _mm_cmpgt_epi8(
+          _mm_set1_epi8(SIZE % 4), _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8,
+                                                 9, 10, 11, 12, 13, 14, 15));
+      _mm_maskmoveu_si128(_mm_load_si128(reinterpret_cast<__m128i *>(tail)),
+                          mask, dst + done);
+    }
+    return;
+  }
+#endif
+  std::memcpy(dst, src, SIZE);
+}
+
+using PartialWriteFn = uint64_t (*)(char *, size_t, size_t,
+                                    const std::atomic<bool> &);
+
+template <size_t SIZE, bool NT>
+uint64_t partial_write_loop(char *base, size_t slots, size_t offset,
+                            const std::atomic<bool> &stop) {
+  alignas(CACHE_LINE_SIZE) char src[SIZE];
+  std::memset(src, 0x5a, SIZE);
+  uint64_t writes = 0;
+  size_t slot = 0;
+  while (!stop.load(std::memory_order_relaxed)) {
+    for (int i = 0; i < 1024; i++) {
+      partial_store<SIZE, NT>(base + slot * PARTIAL_SLOT_STRIDE + offset, src);
+      if (++slot == slots) {
+        slot = 0;
+      }
+    }
+    writes += 1024;
+  }
+#if defined(__x86_64__)
+  if constexpr (NT) {
+    _mm_sfence();
+  }
+#endif
+  return writes;
+}
+
+struct PartialKernel {
+  size_t size;
+  PartialWriteFn temporal;
+  PartialWriteFn nt;
+};
+
+template <size_t SIZE> constexpr PartialKernel partial_kernel() {
+  return {SIZE, partial_write_loop<SIZE, false>,
+          partial_write_loop<SIZE, true>};
+}
+
+// Write sizes swept by partial mode (1-128 B)
+const PartialKernel PARTIAL_KERNELS[] = {
+    partial_kernel<1>(),  partial_kernel<2>(),  partial_kernel<4>(),
+    partial_kernel<8>(),  partial_kernel<16>(), partial_kernel<32>(),
+    partial_kernel<48>(), partial_kernel<64>(), partial_kernel<96>(),
+    partial_kernel<128>()};
+
+// Misalignment within a cache line; 56 and 63 make most sizes straddle lines
+const size_t PARTIAL_OFFSETS[] = {0, 1, 8, 32, 56, 63};
+
+struct PartialCell {
+  double writes_per_sec = 0;
+  double effective_mbps = 0; // bytes the program asked to write
+  double line_mbps = 0;      // whole cache lines those writes dirty
+};
+
+PartialCell run_partial_cell(char *region, size_t region_size,
+                             PartialWriteFn fn, size_t size, size_t offset,
+                             int num_threads) {
+  size_t slots = region_size / PARTIAL_SLOT_STRIDE / num_threads;
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> writes(num_threads, 0);
+  std::vector<std::thread> threads;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      writes[t] = fn(region + t * slots * PARTIAL_SLOT_STRIDE, slots, offset,
+                     stop);
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(PARTIAL_CELL_MS));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &t : threads) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+  uint64_t total = 0;
+  for (uint64_t w : writes) {
+    total += w;
+  }
+  size_t lines = (offset + size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+  constexpr double MB = 1024.0 * 1024.0;
+
+  PartialCell cell;
+  cell.writes_per_sec = total / secs;
+  cell.effective_mbps = total * size / MB / secs;
+  cell.line_mbps = total * lines * CACHE_LINE_SIZE / MB / secs;
+  return cell;
+}
+
+int run_partial_benchmark(const TestConfig &config,
+                          std::vector<JsonRow> &rows) {
+  if (numa_available() < 0) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+  if (config.numa_node >= 0 && numa_run_on_node(config.numa_node) != 0) {
+    std::cerr << "Failed to run on NUMA node " << config.numa_node << ": "
+              << strerror(errno) << std::endl;
+    return 1;
+  }
+
+  int num_threads = std::max(1, config.num_threads);
+  size_t region_size = config.buffer_size / PARTIAL_SLOT_STRIDE /
+                       num_threads * num_threads * PARTIAL_SLOT_STRIDE;
+  if (region_size == 0) {
+    std::cerr << "Buffer too small for " << num_threads << " threads"
+              << std::endl;
+    return 1;
+  }
+
+#if defined(__x86_64__)
+  const bool nt_supported = true;
+#else
+  const bool nt_supported = false;
+  std::cerr << "Non-temporal stores are only implemented on x86-64"
+            << std::endl;
+#endif
+
+  std::cout << "\nCPU node: "
+            << (config.numa_node >= 0 ? std::to_string(config.numa_node)
+                                      : std::string("any"))
+            << ", threads: " << num_threads << ", region: "
+            << region_size / (1024 * 1024) << " MB per node, "
+            << PARTIAL_CELL_MS << " ms per point" << std::endl;
+  std::cout << "effective = requested bytes, wasted = rest of every cache "
+               "line written"
+            << std::endl;
+
+  for (int node : config.cxl_nodes) {
+    if (node > numa_max_node() || numa_node_size64(node, nullptr) <= 0) {
+      std::cerr << "Skipping NUMA node " << node << ": no memory" << std::endl;
+      continue;
+    }
+    char *region = static_cast<char *>(numa_alloc_onnode(region_size, node));
+    if (!region) {
+      std::cerr << "Failed to allocate " << region_size << " bytes on node "
+                << node << std::endl;
+      continue;
+    }
+    std::memset(region, 0, region_size);
+
+    std::cout << "\n=== Partial-Line Write Results: node " << node
+              << " ===" << std::endl;
+    std::cout << std::setw(10) << "store" << std::setw(6) << "size"
+              << std::setw(8) << "offset" << std::setw(7) << "lines"
+              << std::setw(12) << "Mwrites/s" << std::setw(16)
+              << "effective MB/s" << std::setw(13) << "wasted MB/s"
+              << std::setw(12) << "efficiency" << std::endl;
+
+    for (int nt = 0; nt <= 1; nt++) {
+      if (nt && !nt_supported) {
+        break;
+      }
+      for (const PartialKernel &kernel : PARTIAL_KERNELS) {
+        for (size_t offset : PARTIAL_OFFSETS) {
+          PartialCell cell =
+              run_partial_cell(region, region_size,
+                               nt ? kernel.nt : kernel.temporal, kernel.size,
+                               offset, num_threads);
+          size_t lines =
+              (offset + kernel.size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+          std::cout << std::setw(10) << (nt ? "nt" : "temporal")
+                    << std::setw(6) << kernel.size << std::setw(8) << offset
+                    << std::setw(7) << lines << std::fixed
+                    << std::setprecision(2) << std::setw(12)
+                    << cell.writes_per_sec / 1e6 << std::setprecision(1)
+                    << std::setw(16) << cell.effective_mbps << std::setw(13)
+                    << cell.line_mbps - cell.effective_mbps << std::setw(11)
+                    << cell.effective_mbps / cell.line_mbps * 100 << "%"
+                    << std::defaultfloat << std::endl;
+          rows.emplace_back()
+              .key("node", node)
+              .key("store", nt ? "nt" : "temporal")
+              .key("size", kernel.size)
+              .key("offset", offset)
+              .metric("writes_per_sec", cell.writes_per_sec)
+              .metric("effective_bandwidth_mbps", cell.effective_mbps)
+              .metric("line_bandwidth_mbps", cell.line_mbps);
+        }
+      }
+    }
+    numa_free(region, region_size);
+  }
+  return 0;
+}
+
+// Sparse gather/scatter: random index streams over a table on each node.
+// A kernel runs over `n` indices (a multiple of 16) and returns a checksum.
+using SparseKernel = uint64_t (*)(void *table, const void *indices, size_t n,
+                                  size_t prefetch);
+
+enum class SparseOp { GATHER, SCATTER };
+
+template <typename IndexT, typename ElemT, bool WRITE>
+inline void sparse_prefetch(ElemT *table, const IndexT *idx, size_t count) {
+  for (size_t j = 0; j < count; j++) {
+    __builtin_prefetch(&table[idx[j]], WRITE ? 1 : 0, 3);
+  }
+}
+
+template <typename IndexT, typename ElemT, SparseOp OP>
+uint64_t sparse_scalar(void *table_ptr, const void *idx_ptr, size_t n,
+                       size_t prefetch) {
+  ElemT *table = static_cast<ElemT *>(table_ptr);
+  const IndexT *idx = static_cast<const IndexT *>(idx_ptr);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (prefetch && i + prefetch < n) {
+      sparse_prefetch<IndexT, ElemT, OP == SparseOp::SCATTER>(
+          table, idx + i + prefetch, 1);
+    }
+    if (OP == SparseOp::GATHER) {
+      sum += table[idx[i]];
+    } else {
+      table[idx[i]] = static_cast<ElemT>(i);
+    }
+  }
+  return sum;
+}
+
+#if defined(__x86_64__)
+// AVX2 has gathers only; each call gathers one 256-bit vector of elements
+template <typename IndexT, typename ElemT>
+__attribute__((target("avx2"))) uint64_t
+sparse_gather_avx2(void *table_ptr, const void *idx_ptr, size_t n,
+                   size_t prefetch) {
+  const ElemT *table = static_cast<const ElemT *>(table_ptr);
+  const IndexT *idx = static_cast<const IndexT *>(idx_ptr);
+  // Elements per gather: 8 for 32-bit index and element, 4 otherwise
+  constexpr size_t lanes = sizeof(IndexT) == 4 && sizeof(ElemT) == 4 ? 8 : 4;
+  __m256i acc = _mm256_setzero_si256();
+  for (size_t i = 0; i < n; i += lanes) {
+    if (prefetch && i + prefetch + lanes <= n) {
+      sparse_prefetch<IndexT, ElemT, false>(const_cast<ElemT *>(table),
+                                            idx + i + prefetch, lanes);
+    }
+    const void *p = idx + i;
+    __m256i v;
+    if constexpr (sizeof(IndexT) == 4 && sizeof(ElemT) == 4) {
+      v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(table),
+                                 _mm256_loadu_si256((const __m256i *)p), 4);
+    } else if constexpr (sizeof(IndexT) == 4) {
+      v = _mm256_i32gather_epi64(reinterpret_cast<const long long *>(table),
+                                 _mm_loadu_si128((const __m128i *)p), 8);
+    } else if constexpr (sizeof(ElemT) == 4) {
+      v = _mm256_cvtepu32_epi64(
+          _mm256_i64gather_epi32(reinterpret_cast<const int *>(table),
+                                 _mm256_loadu_si256((const __m256i *)p), 4));
+    } else {
+      v = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(table),
+                                 _mm256_loadu_si256((const __m256i *)p), 8);
+    }
+    acc = _mm256_add_epi64(acc, v);
+  }
+  alignas(32) uint64_t lanes_sum[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes_sum), acc);
+  return lanes_sum[0] + lanes_sum[1] + lanes_sum[2] + lanes_sum[3];
+}
+
+// AVX-512F gathers and scatters one 512-bit index or element vector
+template <typename IndexT, typename ElemT, SparseOp OP>
+__attribute__((target("avx512f"))) uint64_t
+sparse_avx512(void *table_ptr, const void *idx_ptr, size_t n, size_t prefetch) {
+  ElemT *table = static_cast<ElemT *>(table_ptr);
+  const IndexT *idx = static_cast<const IndexT *>(idx_ptr);
+  constexpr size_t lanes = sizeof(IndexT) == 4 && sizeof(ElemT) == 4 ? 16 : 8;
+  __m512i acc = _mm512_setzero_si512();
+  __m512i value = _mm512_set1_epi64(0x5a5a5a5a5a5a5a5aLL);
+  for (size_t i = 0; i < n; i += lanes) {
+    if (prefetch && i + prefetch + lanes <= n) {
+      sparse_prefetch<IndexT, ElemT, OP == SparseOp::SCATTER>(
+          table, idx + i + prefetch, lanes);
+    }
+    const void *p = idx + i;
+    if constexpr (OP == SparseOp::GATHER) {
+      // Masked forms with a zero source: same instructions, but GCC's
+      // unmasked wrappers trip -Wmaybe-uninitialized on _mm512_undefined_*
+      const __m512i zero = _mm512_setzero_si512();
+      __m512i v;
+      if constexpr (sizeof(IndexT) == 4 && sizeof(ElemT) == 4) {
+        v = _mm512_mask_i32gather_epi32(zero, 0xffff, _mm512_loadu_si512(p),
+                                        table, 4);
+      } else if constexpr (sizeof(IndexT) == 4) {
+        v = _mm512_mask_i32gather_epi64(
+            zero, 0xff, _mm256_loadu_si256((const __m256i *)p), table, 8);
+      } else if constexpr (sizeof(ElemT) == 4) {
+        v = _mm512_maskz_cvtepu32_epi64(0xff, _mm512_mask_i64gather_epi32(
+            _mm256_setzero_si256(), 0xff, _mm512_loadu_si512(p), table, 4));
+      } else {
+        v = _mm512_mask_i64gather_epi64(zero, 0xff, _mm512_loadu_si512(p),
+                                        table, 8);
+      }
+      acc = _mm512_add_epi64(acc, v);
+    } else {
+      if constexpr (sizeof(IndexT) == 4 && sizeof(ElemT) == 4) {
+        _mm512_i32scatter_epi32(table, _mm512_loadu_si512(p), value, 4);
+      } else if constexpr (sizeof(IndexT) == 4) {
+        _mm512_i32scatter_epi64(table, _mm256_loadu_si256((const __m256i *)p),
+                                value, 8);
+      } else if constexpr (sizeof(ElemT) == 4) {
+        _mm512_i64scatter_epi32(table, _mm512_loadu_si512(p),
+                                _mm256_set1_epi32(0x5a5a5a5a), 4);
+      } else {
+        _mm512_i64scatter_epi64(table, _mm512_loadu_si512(p), value, 8);
+      }
+    }
+  }
+  alignas(64) uint64_t lanes_sum[8];
+  _mm512_store_si512(lanes_sum, acc);
+  uint64_t sum = 0;
+  for (uint64_t v : lanes_sum) {
+    sum += v;
+  }
+  return sum;
+}
+#endif
+
+struct SparseKernelEntry {
+  SparseOp op;
+  int vector_bits; // 0 = scalar
+  int index_bits;
+  int element_bytes;
+  SparseKernel fn;
+};
+
+template <typename IndexT, typename ElemT>
+void add_sparse_kernels(std::vector<SparseKernelEntry> &kernels) {
+  int ib = sizeof(IndexT) * 8, eb = sizeof(ElemT);
+  kernels.push_back({SparseOp::GATHER, 0, ib, eb,
+                     sparse_scalar<IndexT, ElemT, SparseOp::GATHER>});
+  kernels.push_back({SparseOp::SCATTER, 0, ib, eb,
+                     sparse_scalar<IndexT, ElemT, SparseOp::SCATTER>});
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(
+        {SparseOp::GATHER, 256, ib, eb, sparse_gather_avx2<IndexT, ElemT>});
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    kernels.push_back({SparseOp::GATHER, 512, ib, eb,
+                       sparse_avx512<IndexT, ElemT, SparseOp::GATHER>});
+    kernels.push_back({SparseOp::SCATTER, 512, ib, eb,
+                       sparse_avx512<IndexT, ElemT, SparseOp::SCATTER>});
+  }
+#endif
+}
+
+// Kernels this CPU can run, selected at runtime
+std::vector<SparseKernelEntry> sparse_kernels() {
+  std::vector<SparseKernelEntry> kernels;
+  add_sparse_kernels<uint32_t, uint32_t>(kernels);
+  add_sparse_kernels<uint32_t, uint64_t>(kernels);
+  add_sparse_kernels<uint64_t, uint32_t>(kernels);
+  add_sparse_kernels<uint64_t, uint64_t>(kernels);
+  return kernels;
+}
+
+// Uniformly random indices into a table of `elements` entries
+std::vector<char> make_sparse_indices(int index_bits, size_t elements) {
+  std::vector<char> indices(SPARSE_INDEX_COUNT * index_bits / 8);
+  std::mt19937_64 rng(elements);
+  for (size_t i = 0; i < SPARSE_INDEX_COUNT; i++) {
+    uint64_t v = rng() % elements;
+    if (index_bits == 32) {
+      reinterpret_cast<uint32_t *>(indices.data())[i] = v;
+    } else {
+      reinterpret_cast<uint64_t *>(indices.data())[i] = v;
+    }
+  }
+  return indices;
+}
+
+// Returns elements/s over SPARSE_CELL_MS with `num_threads` threads, each
+// cycling through its own slice of the index stream
+double run_sparse_cell(const SparseKernelEntry &kernel, char *table,
+                       const std::vector<char> &indices, size_t prefetch,
+                       int num_threads) {
+  size_t slice = SPARSE_INDEX_COUNT / num_threads / SPARSE_CHUNK * SPARSE_CHUNK;
+  size_t index_bytes = kernel.index_bits / 8;
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> elements(num_threads, 0);
+  std::vector<std::thread> threads;
+  uint64_t checksum = 0;
+  std::mutex checksum_mutex;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      const char *base = indices.data() + t * slice * index_bytes;
+      uint64_t sum = 0, done = 0;
+      size_t pos = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        sum += kernel.fn(table, base + pos * index_bytes, SPARSE_CHUNK,
+                         prefetch);
+        done += SPARSE_CHUNK;
+        pos = pos + SPARSE_CHUNK == slice ? 0 : pos + SPARSE_CHUNK;
+      }
+      elements[t] = done;
+      std::lock_guard<std::mutex> lock(checksum_mutex);
+      checksum += sum;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(SPARSE_CELL_MS));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &t : threads) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+  // Keep the gathered values live
+  volatile uint64_t sink = checksum;
+  (void)sink;
+  uint64_t total = 0;
+  for (uint64_t e : elements) {
+    total += e;
+  }
+  return total / secs;
+}
+
+int run_gather_benchmark(const TestConfig &config,
+                         std::vector<JsonRow> &rows) {
+  if (numa_available() < 0) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+  if (config.numa_node >= 0 && numa_run_on_node(config.numa_node) != 0) {
+    std::cerr << "Failed to run on NUMA node " << config.numa_node << ": "
+              << strerror(errno) << std::endl;
+    return 1;
+  }
+
+  int num_threads = std::max(1, config.num_threads);
+  if (SPARSE_INDEX_COUNT / num_threads < SPARSE_CHUNK) {
+    std::cerr << "Too many threads for the index stream" << std::endl;
+    return 1;
+  }
+
+  std::vector<SparseKernelEntry> kernels;
+  for (const SparseKernelEntry &k : sparse_kernels()) {
+    auto wanted = [](const std::vector<int> &list, int v) {
+      return std::find(list.begin(), list.end(), v) != list.end();
+    };
+    if (wanted(config.vector_widths, k.vector_bits) &&
+        wanted(config.index_widths, k.index_bits) &&
+        wanted(config.element_sizes, k.element_bytes)) {
+      kernels.push_back(k);
+    }
+  }
+  for (int bits : config.vector_widths) {
+    bool supported = false;
+    for (const SparseKernelEntry &k : kernels) {
+      supported = supported || k.vector_bits == bits;
+    }
+    if (!supported) {
+      std::cerr << "Skipping " << bits
+                << "-bit vectors: not supported by this CPU" << std::endl;
+    }
+  }
+
+  std::cout << "\nCPU node: "
+            << (config.numa_node >= 0 ? std::to_string(config.numa_node)
+                                      : std::string("any"))
+            << ", threads: " << num_threads << ", table: "
+            << config.buffer_size / (1024 * 1024) << " MB per node, "
+            << SPARSE_INDEX_COUNT << " random indices, " << SPARSE_CELL_MS
+            << " ms per point" << std::endl;
+  std::cout << "useful = element bytes, lines = 64 B moved per random access"
+            << std::endl;
+
+  for (int node : config.cxl_nodes) {
+    if (node > numa_max_node() || numa_node_size64(node, nullptr) <= 0) {
+      std::cerr << "Skipping NUMA node " << node << ": no memory" << std::endl;
+      continue;
+    }
+    char *table = static_cast<char *>(numa_alloc_onnode(config.buffer_size, node));
+    if (!table) {
+      std::cerr << "Failed to allocate " << config.buffer_size
+                << " bytes on node " << node << std::endl;
+      continue;
+    }
+    std::memset(table, 1, config.buffer_size);
+
+    std::cout << "\n=== Gather/Scatter Results: table on node " << node
+              << " ===" << std::endl;
+    std::cout << std::setw(9) << "op" << std::setw(8) << "vector"
+              << std::setw(7) << "index" << std::setw(6) << "elem"
+              << std::setw(10) << "prefetch" << std::setw(12) << "Melem/s"
+              << std::setw(13) << "useful MB/s" << std::setw(13)
+              << "lines MB/s" << std::endl;
+
+    std::vector<char> indices;
+    int indices_bits = 0, indices_elem = 0;
+    for (const SparseKernelEntry &k : kernels) {
+      if (k.index_bits != indices_bits || k.element_bytes != indices_elem) {
+        size_t elements = config.buffer_size / k.element_bytes;
+        if (k.index_bits == 32) {
+          // Gather/scatter treat 32-bit indices as signed
+          elements = std::min<size_t>(elements, INT32_MAX);
+        }
+        indices = make_sparse_indices(k.index_bits, elements);
+        indices_bits = k.index_bits;
+        indices_elem = k.element_bytes;
+      }
+      for (size_t prefetch : config.prefetch_distances) {
+        double rate = run_sparse_cell(k, table, indices, prefetch, num_threads);
+        constexpr double MB = 1024.0 * 1024.0;
+        std::cout << std::setw(9)
+                  << (k.op == SparseOp::GATHER ? "gather" : "scatter")
+                  << std::setw(8)
+                  << (k.vector_bits ? std::to_string(k.vector_bits)
+                                    : std::string("scalar"))
+                  << std::setw(7) << k.index_bits << std::setw(6)
+                  << k.element_bytes << std::setw(10) << prefetch << std::fixed
+                  << std::setprecision(1) << std::setw(12) << rate / 1e6
+                  << std::setw(13) << rate * k.element_bytes / MB
+                  << std::setw(13) << rate * CACHE_LINE_SIZE / MB
+                  << std::defaultfloat << std::endl;
+        rows.emplace_back()
+            .key("node", node)
+            .key("op", k.op == SparseOp::GATHER ? "gather" : "scatter")
+            .key("vector_bits", k.vector_bits)
+            .key("index_bits", k.index_bits)
+            .key("element_bytes", k.element_bytes)
+            .key("prefetch", prefetch)
+            .metric("elements_per_sec", rate)
+            .metric("useful_bandwidth_mbps", rate * k.element_bytes / MB)
+            .metric("line_bandwidth_mbps", rate * CACHE_LINE_SIZE / MB);
+      }
+    }
+    numa_free(table, config.buffer_size);
+  }
+  return 0;
+}
+
 void show_system_info() {
   std::cout << "\n=== System Information ===" << std::endl;
 
@@ -362,6 +1908,78 @@ void show_system_info() {
   std::cout << std::endl;
 }
 
+const char *mode_name(MemoryMode mode) {
+  switch (mode) {
+  case MemoryMode::SYSTEM_RAM:
+    return "system";
+  case MemoryMode::PHYSICAL_ACCESS:
+    return "physical";
+  case MemoryMode::NUMA_AWARE:
+    return "numa";
+  case MemoryMode::CXL_INTERLEAVE:
+    return "interleave";
+  case MemoryMode::CXL_NUMA:
+    return "cxl";
+  case MemoryMode::CXL_MULTI:
+    return "multi";
+  case MemoryMode::FAULT_BENCH:
+    return "fault";
+  case MemoryMode::TLB_BENCH:
+    return "tlb";
+  case MemoryMode::INTERFERENCE:
+    return "interference";
+  case MemoryMode::PARTIAL_WRITE:
+    return "partial";
+  case MemoryMode::GATHER:
+    return "gather";
+  }
+  return "unknown";
+}
+
+// Bandwidth modes write one "results" object; sweep modes (fault, tlb,
+// interference, partial, gather) write an array with one entry per table row
+void write_json_results(const TestConfig &config,
+                        const BandwidthResults *results,
+                        const std::vector<JsonRow> &rows,
+                        const SystemStateRecorder &state) {
+  std::ofstream out(config.json_path);
+  if (!out) {
+    std::cerr << "Failed to open " << config.json_path << ": "
+              << strerror(errno) << std::endl;
+    return;
+  }
+
+  out << "{\n  \"benchmark\": \"cxl_memory_test\",\n  \"environment\": ";
+  write_json_environment(out);
+  out << ",\n  \"config\": {"
+      << "\"mode\": " << json_string(mode_name(config.mode))
+      << ", \"buffer_size\": " << config.buffer_size
+      << ", \"block_size\": " << config.block_size
+      << ", \"duration\": " << config.duration
+      << ", \"num_threads\": " << config.num_threads
+      << ", \"read_ratio\": " << config.read_ratio
+      << ", \"numa_node\": " << config.numa_node << "},\n";
+  if (results) {
+    constexpr double MB = 1024.0 * 1024.0;
+    double secs = results->elapsed_seconds;
+    out << "  \"results\": {\"elapsed_seconds\": " << secs
+        << ", \"read_bandwidth_mbps\": " << results->read_bytes / MB / secs
+        << ", \"write_bandwidth_mbps\": " << results->write_bytes / MB / secs
+        << ", \"total_bandwidth_mbps\": "
+        << (results->read_bytes + results->write_bytes) / MB / secs
+        << ", \"read_iops\": " << results->read_ops / secs
+        << ", \"write_iops\": " << results->write_ops / secs << "},\n";
+  } else {
+    out << "  \"results\": ";
+    write_json_rows(out, rows);
+    out << ",\n";
+  }
+  out << "  \"system_state\": ";
+  state.write_json(out);
+  out << "\n}\n";
+  std::cout << "Results written to " << config.json_path << std::endl;
+}
+
 int main(int argc, char *argv[]) {
   TestConfig config = parse_args(argc, argv);
 
@@ -400,6 +2018,21 @@ int main(int argc, char *argv[]) {
   case MemoryMode::CXL_MULTI:
     mode_str = "Multiple CXL buffers on NUMA node";
     break;
+  case MemoryMode::FAULT_BENCH:
+    mode_str = "Page-fault and first-touch benchmark";
+    break;
+  case MemoryMode::TLB_BENCH:
+    mode_str = "TLB reach and page-table placement benchmark";
+    break;
+  case MemoryMode::INTERFERENCE:
+    mode_str = "DRAM/CXL noisy-neighbour interference matrix";
+    break;
+  case MemoryMode::PARTIAL_WRITE:
+    mode_str = "Partial-cacheline and misaligned write cost";
+    break;
+  case MemoryMode::GATHER:
+    mode_str = "SIMD gather/scatter over random indices";
+    break;
   }
   std::cout << "  Memory mode: " << mode_str << std::endl;
 
@@ -424,6 +2057,33 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Snapshot vmstat/numastat/PSI/interrupts around the run
+  SystemStateRecorder system_state;
+  system_state.start();
+
+  if (config.mode == MemoryMode::FAULT_BENCH ||
+      config.mode == MemoryMode::TLB_BENCH ||
+      config.mode == MemoryMode::INTERFERENCE ||
+      config.mode == MemoryMode::PARTIAL_WRITE ||
+      config.mode == MemoryMode::GATHER) {
+    std::vector<JsonRow> rows;
+    int ret = config.mode == MemoryMode::FAULT_BENCH
+                  ? run_fault_benchmark(config, rows)
+              : config.mode == MemoryMode::TLB_BENCH
+                  ? run_tlb_benchmark(config, rows)
+              : config.mode == MemoryMode::INTERFERENCE
+                  ? run_interference_benchmark(config, rows)
+              : config.mode == MemoryMode::PARTIAL_WRITE
+                  ? run_partial_benchmark(config, rows)
+                  : run_gather_benchmark(config, rows);
+    system_state.stop();
+    system_state.print_summary(std::cout);
+    if (ret == 0 && !config.json_path.empty()) {
+      write_json_results(config, nullptr, rows, system_state);
+    }
+    return ret;
+  }
+
   std::cout << "\nInitializing memory..." << std::endl;
 
   void *buffer = nullptr;
@@ -574,7 +2234,7 @@ int main(int argc, char *argv[]) {
       } else {
         threads.emplace_back(system_reader_thread, buffer, config.buffer_size,
                              config.block_size, std::ref(stop_flag),
-                             std::ref(thread_stats[i]), i);
+                             std::ref(thread_stats[i]), i, 0);
       }
     }
 
@@ -589,7 +2249,7 @@ int main(int argc, char *argv[]) {
         threads.emplace_back(system_writer_thread, buffer, config.buffer_size,
                              config.block_size, std::ref(stop_flag),
                              std::ref(thread_stats[num_readers + i]),
-                             num_readers + i);
+                             num_readers + i, 0);
       }
     }
 
@@ -605,6 +2265,7 @@ int main(int argc, char *argv[]) {
         t.join();
       }
     }
+    system_state.stop();
 
     // Calculate results
     double elapsed_seconds =
@@ -665,6 +2326,17 @@ int main(int argc, char *argv[]) {
               << (total_bandwidth_mbps * 100.0) / (40000.0)
               << "% (assuming 40GB/s peak)" << std::endl;
 
+    system_state.print_summary(std::cout);
+    if (!config.json_path.empty()) {
+      BandwidthResults results;
+      results.elapsed_seconds = elapsed_seconds;
+      results.read_bytes = total_read_bytes;
+      results.read_ops = total_read_ops;
+      results.write_bytes = total_write_bytes;
+      results.write_ops = total_write_ops;
+      write_json_results(config, &results, {}, system_state);
+    }
+
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
@@ -0,0 +1,358 @@
+/**
+ * cxl_tasks.cpp - One-shot dump of the scheduler's per-task context
+ *
+ * Reads the task iterator pinned by cxl_bandwidth_scheduler (see
+ * ebpf/task_snapshot.h) in a single pass: the kernel walks every task once
+ * and returns fixed-size binary records, so a full-system snapshot costs one
+ * open() and a few large read()s instead of a map lookup per pid. A saved
+ * snapshot (`cat /sys/fs/bpf/cxl_task_ctx > snap.bin`) can be read with -f.
+ */
+
+#include "../ebpf/task_snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+constexpr size_t READ_CHUNK = 1 << 20;
+constexpr uint32_t CGRP_SLOT_NONE = static_cast<uint32_t>(-1);
+
+// enum task_type in cxl_pmu_simple.bpf.c
+const char *const TYPE_NAMES[] = {"unknown", "vectordb", "kworker", "regular",
+                                  "bandwidth"};
+constexpr int NUM_TYPES = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+
+enum class SortKey { PID, RUNTIME, VTIME, LOCALITY, BOOST };
+
+struct TasksConfig {
+  std::string path = TASK_SNAPSHOT_PIN;
+  int type = -1; // -1 = all types
+  long pid = -1; // matches pid or tgid
+  std::string comm;
+  bool readers_only = false;
+  bool writers_only = false;
+  bool summary = false;
+  SortKey sort = SortKey::PID;
+  size_t top = 0; // 0 = all tasks
+};
+
+void print_usage(const char *prog_name) {
+  std::cerr
+      << "Usage: " << prog_name << " [OPTIONS]\n"
+      << "Options:\n"
+      << "  -f, --file=PATH           Pinned iterator or saved snapshot "
+         "(default: "
+      << TASK_SNAPSHOT_PIN << ")\n"
+      << "  -t, --type=NAME           Only tasks of this class (unknown, "
+         "vectordb,\n"
+      << "                            kworker, regular, bandwidth)\n"
+      << "  -p, --pid=PID             Only this thread or process\n"
+      << "  -c, --comm=TEXT           Only tasks whose comm contains TEXT\n"
+      << "  -r, --readers             Only tasks classified as readers\n"
+      << "  -w, --writers             Only tasks classified as writers\n"
+      << "  -s, --sort=KEY            pid, runtime, vtime, locality or boost "
+         "(default: pid)\n"
+      << "  -n, --top=NUM             Print at most NUM tasks (default: 0=all)\n"
+      << "  -S, --summary             Per-class counts only\n"
+      << "  -h, --help                Show this help message\n"
+      << "\nExamples:\n"
+      << "  sudo " << prog_name << " -t bandwidth -s runtime -n 20\n"
+      << "  sudo " << prog_name << " -c double_bandwidth -w\n"
+      << "  sudo cat " << TASK_SNAPSHOT_PIN << " > snap.bin && " << prog_name
+      << " -f snap.bin -S\n";
+}
+
+int parse_type(const std::string &name) {
+  for (int i = 0; i < NUM_TYPES; i++) {
+    if (name == TYPE_NAMES[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+TasksConfig parse_args(int argc, char *argv[]) {
+  TasksConfig config;
+
+  static struct option long_options[] = {{"file", required_argument, 0, 'f'},
+                                         {"type", required_argument, 0, 't'},
+                                         {"pid", required_argument, 0, 'p'},
+                                         {"comm", required_argument, 0, 'c'},
+                                         {"readers", no_argument, 0, 'r'},
+                                         {"writers", no_argument, 0, 'w'},
+                                         {"sort", required_argument, 0, 's'},
+                                         {"top", required_argument, 0, 'n'},
+                                         {"summary", no_argument, 0, 'S'},
+                                         {"help", no_argument, 0, 'h'},
+                                         {0, 0, 0, 0}};
+
+  int opt, option_index = 0;
+  while ((opt = getopt_long(argc, argv, "f:t:p:c:rws:n:Sh", long_options,
+                            &option_index)) != -1) {
+    switch (opt) {
+    case 'f':
+      config.path = optarg;
+      break;
+    case 't':
+      config.type = parse_type(optarg);
+      if (config.type < 0) {
+        std::cerr << "Unknown task type: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    case 'p':
+      config.pid = std::stol(optarg);
+      break;
+    case 'c':
+      config.comm = optarg;
+      break;
+    case 'r':
+      config.readers_only = true;
+      break;
+    case 'w':
+      config.writers_only = true;
+      break;
+    case 's': {
+      std::string key = optarg;
+      if (key == "pid") {
+        config.sort = SortKey::PID;
+      } else if (key == "runtime") {
+        config.sort = SortKey::RUNTIME;
+      } else if (key == "vtime") {
+        config.sort = SortKey::VTIME;
+      } else if (key == "locality") {
+        config.sort = SortKey::LOCALITY;
+      } else if (key == "boost") {
+        config.sort = SortKey::BOOST;
+      } else {
+        std::cerr << "Unknown sort key: " << key << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'n':
+      config.top = std::stoull(optarg);
+      break;
+    case 'S':
+      config.summary = true;
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      exit(0);
+    default:
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (config.readers_only && config.writers_only) {
+    std::cerr << "--readers and --writers are mutually exclusive" << std::endl;
+    exit(1);
+  }
+  return config;
+}
+
+// Whole file in one pass; each open() of a pinned iterator is a fresh walk
+bool read_snapshot(const std::string &path, std::vector<char> &buf) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Failed to open " << path << ": " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  size_t used = 0;
+  while (true) {
+    if (buf.size() - used < READ_CHUNK) {
+      buf.resize(used + READ_CHUNK);
+    }
+    ssize_t n = read(fd, buf.data() + used, buf.size() - used);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Failed to read " << path << ": " << strerror(errno)
+                << std::endl;
+      close(fd);
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    used += n;
+  }
+  close(fd);
+  buf.resize(used);
+  return true;
+}
+
+const char *type_name(uint8_t type) {
+  return type < NUM_TYPES ? TYPE_NAMES[type] : "?";
+}
+
+bool matches(const task_snapshot_record &rec, const TasksConfig &config) {
+  if (config.type >= 0 && rec.type != config.type) {
+    return false;
+  }
+  if (config.pid >= 0 && rec.pid != config.pid && rec.tgid != config.pid) {
+    return false;
+  }
+  if (!config.comm.empty() &&
+      std::string(rec.comm, strnlen(rec.comm, sizeof(rec.comm)))
+              .find(config.comm) == std::string::npos) {
+    return false;
+  }
+  if (config.readers_only && !(rec.has_pattern && rec.is_reader)) {
+    return false;
+  }
+  if (config.writers_only && !(rec.has_pattern && !rec.is_reader)) {
+    return false;
+  }
+  return true;
+}
+
+void sort_records(std::vector<task_snapshot_record> &records, SortKey key) {
+  auto by = [&](auto field) {
+    std::stable_sort(records.begin(), records.end(),
+                     [&](const task_snapshot_record &a,
+                         const task_snapshot_record &b) {
+                       return field(a) > field(b);
+                     });
+  };
+  switch (key) {
+  case SortKey::PID:
+    break; // iterator order is already by pid
+  case SortKey::RUNTIME:
+    by([](const task_snapshot_record &r) { return r.avg_runtime_ns; });
+    break;
+  case SortKey::VTIME:
+    by([](const task_snapshot_record &r) { return r.dsq_vtime; });
+    break;
+  case SortKey::LOCALITY:
+    by([](const task_snapshot_record &r) { return r.locality_score; });
+    break;
+  case SortKey::BOOST:
+    by([](const task_snapshot_record &r) { return r.priority_boost; });
+    break;
+  }
+}
+
+void print_tasks(const std::vector<task_snapshot_record> &records,
+                 size_t top) {
+  std::cout << std::setw(8) << "pid" << std::setw(8) << "tgid" << "  "
+            << std::left << std::setw(16) << "comm" << std::setw(10) << "class"
+            << std::right << std::setw(4) << "rw" << std::setw(5) << "cpu"
+            << std::setw(6) << "boost" << std::setw(6) << "loc"
+            << std::setw(10) << "accesses" << std::setw(12) << "avg run us"
+            << std::setw(7) << "weight" << std::setw(7) << "cgrp"
+            << std::setw(16) << "vtime" << "\n";
+
+  size_t shown = 0;
+  for (const auto &rec : records) {
+    if (top > 0 && shown++ >= top) {
+      break;
+    }
+    const char *rw = !rec.has_pattern ? "-" : rec.is_reader ? "R" : "W";
+    std::string cgrp = rec.cgrp_slot == CGRP_SLOT_NONE
+                           ? std::string("root")
+                           : std::to_string(rec.cgrp_slot);
+    std::cout << std::setw(8) << rec.pid << std::setw(8) << rec.tgid << "  "
+              << std::left << std::setw(16)
+              << std::string(rec.comm, strnlen(rec.comm, sizeof(rec.comm)))
+              << std::setw(10) << type_name(rec.type) << std::right
+              << std::setw(4) << rw << std::setw(5) << rec.last_cpu
+              << std::setw(6) << rec.priority_boost << std::setw(6)
+              << rec.locality_score << std::setw(10) << rec.access_count
+              << std::setw(12) << std::fixed << std::setprecision(1)
+              << rec.avg_runtime_ns / 1e3 << std::setw(7) << rec.weight
+              << std::setw(7) << cgrp << std::setw(16) << rec.dsq_vtime
+              << "\n";
+  }
+}
+
+void print_summary(const std::vector<task_snapshot_record> &records) {
+  uint64_t count[NUM_TYPES] = {}, readers[NUM_TYPES] = {},
+           writers[NUM_TYPES] = {}, runtime[NUM_TYPES] = {};
+  for (const auto &rec : records) {
+    int t = rec.type < NUM_TYPES ? rec.type : 0;
+    count[t]++;
+    runtime[t] += rec.avg_runtime_ns;
+    if (rec.has_pattern) {
+      (rec.is_reader ? readers : writers)[t]++;
+    }
+  }
+
+  std::cout << std::left << std::setw(12) << "class" << std::right
+            << std::setw(8) << "tasks" << std::setw(9) << "readers"
+            << std::setw(9) << "writers" << std::setw(14) << "avg run us"
+            << "\n";
+  for (int t = 0; t < NUM_TYPES; t++) {
+    if (!count[t]) {
+      continue;
+    }
+    std::cout << std::left << std::setw(12) << TYPE_NAMES[t] << std::right
+              << std::setw(8) << count[t] << std::setw(9) << readers[t]
+              << std::setw(9) << writers[t] << std::setw(14) << std::fixed
+              << std::setprecision(1) << runtime[t] / 1e3 / count[t] << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  TasksConfig config = parse_args(argc, argv);
+
+  std::vector<char> buf;
+  auto start = std::chrono::steady_clock::now();
+  if (!read_snapshot(config.path, buf)) {
+    return 1;
+  }
+  double read_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  task_snapshot_header hdr;
+  if (buf.size() < sizeof(hdr)) {
+    std::cerr << config.path << " is empty (is the scheduler loaded?)"
+              << std::endl;
+    return 1;
+  }
+  memcpy(&hdr, buf.data(), sizeof(hdr));
+  if (hdr.magic != TASK_SNAPSHOT_MAGIC ||
+      hdr.version != TASK_SNAPSHOT_VERSION ||
+      hdr.record_size < sizeof(task_snapshot_record)) {
+    std::cerr << "Unrecognized snapshot layout in " << config.path
+              << std::endl;
+    return 1;
+  }
+
+  // Stride by the producer's record size so appended fields are skipped
+  size_t total = (buf.size() - sizeof(hdr)) / hdr.record_size;
+  std::vector<task_snapshot_record> records;
+  records.reserve(total);
+  for (size_t i = 0; i < total; i++) {
+    task_snapshot_record rec;
+    memcpy(&rec, buf.data() + sizeof(hdr) + i * hdr.record_size, sizeof(rec));
+    if (matches(rec, config)) {
+      records.push_back(rec);
+    }
+  }
+
+  std::cout << total << " tasks (" << buf.size() / 1024 << " KB) read in "
+            << std::fixed << std::setprecision(2) << read_ms << " ms, "
+            << records.size() << " match\n\n";
+
+  if (config.summary) {
+    print_summary(records);
+  } else {
+    sort_records(records, config.sort);
+    print_tasks(records, config.top);
+  }
+  return 0;
+}
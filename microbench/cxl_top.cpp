@@ -0,0 +1,237 @@
+/**
+ * cxl_top.cpp - Live viewer for benchmark telemetry segments
+ *
+ * Attaches read-only to the shared-memory segment published by
+ * `double_bandwidth --telemetry=NAME` and redraws per-class, per-node and
+ * per-thread bandwidth every refresh interval (default 10 Hz).
+ */
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+constexpr int DEFAULT_INTERVAL_MS = 100; // 10 Hz
+constexpr size_t DEFAULT_TOP_THREADS = 20;
+
+struct TopConfig {
+  std::string shm_name;
+  int interval_ms = DEFAULT_INTERVAL_MS;
+  size_t top = DEFAULT_TOP_THREADS; // 0 = all threads
+};
+
+struct ThreadSample {
+  uint64_t bytes = 0;
+  uint64_t ops = 0;
+};
+
+void print_usage(const char *prog_name) {
+  std::cerr
+      << "Usage: " << prog_name << " [OPTIONS] NAME\n"
+      << "Options:\n"
+      << "  -i, --interval=MS         Refresh interval in milliseconds "
+         "(default: 100)\n"
+      << "  -n, --top=NUM             Threads shown, busiest first (default: "
+         "20, 0=all)\n"
+      << "  -h, --help                Show this help message\n";
+}
+
+TopConfig parse_args(int argc, char *argv[]) {
+  TopConfig config;
+
+  static struct option long_options[] = {{"interval", required_argument, 0, 'i'},
+                                         {"top", required_argument, 0, 'n'},
+                                         {"help", no_argument, 0, 'h'},
+                                         {0, 0, 0, 0}};
+
+  int opt, option_index = 0;
+  while ((opt = getopt_long(argc, argv, "i:n:h", long_options,
+                            &option_index)) != -1) {
+    switch (opt) {
+    case 'i':
+      config.interval_ms = std::max(1, std::stoi(optarg));
+      break;
+    case 'n':
+      config.top = std::stoull(optarg);
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      exit(0);
+    default:
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  config.shm_name = argv[optind];
+  if (config.shm_name[0] != '/')
+    config.shm_name = "/" + config.shm_name;
+  return config;
+}
+
+const char *phase_name(uint32_t phase) {
+  switch (phase) {
+  case CXL_TELEMETRY_SETUP:
+    return "setup";
+  case CXL_TELEMETRY_RUNNING:
+    return "running";
+  case CXL_TELEMETRY_DONE:
+    return "done";
+  }
+  return "unknown";
+}
+
+double monotonic_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void draw(const cxl_telemetry_header *hdr,
+          const std::vector<ThreadSample> &prev,
+          const std::vector<ThreadSample> &cur, double dt, size_t top) {
+  const auto *slots =
+      cxl_telemetry_threads(const_cast<cxl_telemetry_header *>(hdr));
+  constexpr double MB = 1024.0 * 1024.0;
+
+  std::vector<double> rates(cur.size());
+  double class_rate[2] = {0, 0};
+  std::map<int, double> node_rate;
+  for (size_t i = 0; i < cur.size(); i++) {
+    rates[i] = (cur[i].bytes - prev[i].bytes) / MB / dt;
+    class_rate[slots[i].thread_class == CXL_TELEMETRY_WRITE] += rates[i];
+    node_rate[slots[i].numa_node] += rates[i];
+  }
+
+  double elapsed = 0;
+  if (hdr->phase != CXL_TELEMETRY_SETUP) {
+    elapsed = monotonic_seconds() - hdr->start_ns / 1e9;
+  }
+
+  std::cout << "\033[H\033[2J" << std::fixed << std::setprecision(1);
+  std::cout << hdr->benchmark << " pid " << hdr->pid << "  phase "
+            << phase_name(hdr->phase) << "  elapsed " << elapsed << "/"
+            << hdr->duration << " s  threads " << hdr->num_threads << "\n\n";
+  std::cout << "read " << class_rate[0] << " MB/s  write " << class_rate[1]
+            << " MB/s  total " << class_rate[0] + class_rate[1] << " MB/s\n";
+  for (const auto &entry : node_rate) {
+    std::cout << "  node "
+              << (entry.first < 0 ? std::string("any")
+                                  : std::to_string(entry.first))
+              << ": " << entry.second << " MB/s\n";
+  }
+
+  std::vector<size_t> order(cur.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return rates[a] > rates[b]; });
+  if (top > 0 && order.size() > top) {
+    order.resize(top);
+  }
+
+  std::cout << "\n"
+            << std::setw(8) << "thread" << std::setw(10) << "tid"
+            << std::setw(7) << "class" << std::setw(6) << "node"
+            << std::setw(12) << "MB/s" << std::setw(14) << "ops/s"
+            << std::setw(14) << "total MB" << "\n";
+  for (size_t i : order) {
+    const cxl_telemetry_thread &t = slots[i];
+    std::cout << std::setw(8) << t.thread_id << std::setw(10) << t.tid
+              << std::setw(7)
+              << (t.thread_class == CXL_TELEMETRY_WRITE ? "write" : "read")
+              << std::setw(6) << t.numa_node << std::setw(12) << rates[i]
+              << std::setw(14) << (cur[i].ops - prev[i].ops) / dt
+              << std::setw(14) << cur[i].bytes / MB << "\n";
+  }
+  std::cout << std::flush;
+}
+
+int main(int argc, char *argv[]) {
+  TopConfig config = parse_args(argc, argv);
+
+  int fd = shm_open(config.shm_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    std::cerr << "Failed to open shared memory " << config.shm_name << ": "
+              << strerror(errno) << std::endl;
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(cxl_telemetry_header)) {
+    std::cerr << "Shared memory " << config.shm_name << " is too small"
+              << std::endl;
+    close(fd);
+    return 1;
+  }
+
+  void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Failed to map shared memory: " << strerror(errno)
+              << std::endl;
+    return 1;
+  }
+
+  const auto *hdr = static_cast<const cxl_telemetry_header *>(mem);
+  if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != CXL_TELEMETRY_MAGIC ||
+      hdr->version != CXL_TELEMETRY_VERSION ||
+      cxl_telemetry_size(hdr->num_threads) >
+          static_cast<uint64_t>(st.st_size)) {
+    std::cerr << "Unrecognized segment layout in " << config.shm_name
+              << std::endl;
+    munmap(mem, st.st_size);
+    return 1;
+  }
+
+  const auto *slots =
+      cxl_telemetry_threads(const_cast<cxl_telemetry_header *>(hdr));
+  auto sample = [&](std::vector<ThreadSample> &out) {
+    for (uint32_t i = 0; i < hdr->num_threads; i++) {
+      out[i].bytes = cxl_telemetry_read(&slots[i].bytes_processed);
+      out[i].ops = cxl_telemetry_read(&slots[i].operations);
+    }
+  };
+
+  std::vector<ThreadSample> prev(hdr->num_threads), cur(hdr->num_threads);
+  sample(prev);
+  double last = monotonic_seconds();
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.interval_ms));
+    uint32_t phase = __atomic_load_n(&hdr->phase, __ATOMIC_ACQUIRE);
+    sample(cur);
+    double now = monotonic_seconds();
+    draw(hdr, prev, cur, now - last, config.top);
+    prev.swap(cur);
+    last = now;
+
+    // The segment stays mapped after the benchmark unlinks it on exit
+    if (phase == CXL_TELEMETRY_DONE ||
+        (kill(hdr->pid, 0) != 0 && errno == ESRCH)) {
+      break;
+    }
+  }
+
+  munmap(mem, st.st_size);
+  return 0;
+}
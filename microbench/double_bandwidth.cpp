@@ -5,17 +5,31 @@
  * the ratio of readers to writers, simulating bidirectional traffic.
  */
 
+#include "resctrl.h"
+#include "system_state.h"
+#include "telemetry.h"
+
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <fstream>
 #include <getopt.h>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <numa.h>
+#include <pthread.h>
+#include <random>
+#include <sched.h>
+#include <sstream>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <thread>
@@ -33,13 +47,21 @@ constexpr int DEFAULT_NUM_THREADS = 500;    // total threads
 constexpr float DEFAULT_READ_RATIO = 0.5;   // 50% readers, 50% writers
 constexpr size_t DEFAULT_MAX_BANDWIDTH = 0; // 0 means unlimited (MB/s)
 constexpr int DEFAULT_NUMA_NODE = 1;        // Default NUMA node
+constexpr int RESCTRL_SAMPLE_MS = 1000;     // MBM reporting interval
+constexpr size_t CACHE_LINE_SIZE = 64;
 
-struct ThreadStats {
-  size_t bytes_processed = 0;
-  size_t operations = 0;
-  int thread_id = 0;   // 新增：线程ID
-  size_t cpu_hash = 0; // Added for CPU workload hashing
-};
+// Thread names the CXL scheduler (ebpf/cxl_pmu_simple) tells readers from
+// writers by; comm holds 15 characters, and the "doub" prefix keeps the
+// threads recognised as bandwidth tasks
+constexpr const char *READER_THREAD_NAME = "double_bw_rd";
+constexpr const char *WRITER_THREAD_NAME = "double_bw_wr";
+
+// Software prefetch instruction issued ahead of each reader block
+enum class PrefetchHint { NONE, T0, T2, NTA };
+
+// Per-thread counters use the telemetry slot layout, so with --telemetry the
+// workers count straight into the shared segment
+using ThreadStats = cxl_telemetry_thread;
 
 // Rate limiter using token bucket algorithm
 class RateLimiter {
@@ -112,8 +134,54 @@ struct BenchmarkConfig {
   size_t cpu_workload_size = 0;      // CPU workload size in bytes (default: 0)
   int numa_node = DEFAULT_NUMA_NODE; // NUMA node to bind to
   bool enable_numa = true;           // Enable NUMA binding
+  std::string json_path;             // Result JSON output (empty = none)
+  std::string telemetry_name;        // Shared-memory telemetry segment
+  std::string resctrl_root = RESCTRL_DEFAULT_ROOT;
+  std::string resctrl_group;         // resctrl group for all threads
+  uint64_t l3_mask = 0;              // L3 way mask (0 = leave unchanged)
+  int mba_percent = 0;               // MBA throttle (0 = leave unchanged)
+  PrefetchHint prefetch = PrefetchHint::NONE; // Reader software prefetch
+  size_t prefetch_distance = 0;      // Bytes ahead of the current block
+  bool prefetch_sweep = false;       // Run the prefetch sweep instead
+  std::vector<int> prefetch_sweep_nodes; // Memory nodes (empty = all)
+  bool find_knee = false;            // Run the saturation-knee search instead
+  std::vector<int> knee_nodes;       // Memory nodes (empty = all)
+  std::vector<float> knee_ratios;    // Read ratios (empty = read_ratio)
 };
 
+// Issue one software prefetch per cache line of [p, p + size)
+inline void prefetch_lines(PrefetchHint hint, const char *p, size_t size) {
+  for (size_t off = 0; off < size; off += CACHE_LINE_SIZE) {
+    switch (hint) {
+    case PrefetchHint::T0:
+      __builtin_prefetch(p + off, 0, 3); // prefetcht0
+      break;
+    case PrefetchHint::T2:
+      __builtin_prefetch(p + off, 0, 1); // prefetcht2
+      break;
+    case PrefetchHint::NTA:
+      __builtin_prefetch(p + off, 0, 0); // prefetchnta
+      break;
+    case PrefetchHint::NONE:
+      return;
+    }
+  }
+}
+
+const char *prefetch_hint_name(PrefetchHint hint) {
+  switch (hint) {
+  case PrefetchHint::NONE:
+    return "none";
+  case PrefetchHint::T0:
+    return "t0";
+  case PrefetchHint::T2:
+    return "t2";
+  case PrefetchHint::NTA:
+    return "nta";
+  }
+  return "unknown";
+}
+
 void print_usage(const char *prog_name) {
   std::cerr
       << "Usage: " << prog_name << " [OPTIONS]\n"
@@ -137,7 +205,36 @@ void print_usage(const char *prog_name) {
       << "  -N, --numa-node=NODE      Bind threads to a specific NUMA node "
          "(default: 1)\n"
       << "  -n, --no-numa             Disable NUMA binding\n"
-      << "  -h, --help                Show this help message\n";
+      << "  -j, --json=PATH           Write results and system-state deltas "
+         "as JSON\n"
+      << "  -T, --telemetry=NAME      Publish live counters in shared memory "
+         "/NAME (see cxl_top)\n"
+      << "  -G, --resctrl-group=NAME  Run all threads in resctrl group NAME "
+         "and report its MBM bandwidth\n"
+      << "  -L, --l3-mask=HEX         L3 cache way mask for the resctrl "
+         "group\n"
+      << "  -M, --mba=PERCENT         Memory bandwidth allocation for the "
+         "resctrl group\n"
+      << "  -R, --resctrl-root=PATH   resctrl mount point (default: "
+         "/sys/fs/resctrl)\n"
+      << "  -P, --prefetch=HINT       Reader software prefetch: t0, t2 or "
+         "nta (default: none)\n"
+      << "  -F, --prefetch-distance=BYTES  Prefetch this far ahead of the "
+         "current block (default: 4 blocks)\n"
+      << "  -S, --prefetch-sweep[=NODES]  Sweep prefetch hints and distances "
+         "per memory node (comma list, default: all) and exit\n"
+      << "  -K, --find-knee[=NODES]   Find the fewest threads reaching 95% of "
+         "peak bandwidth per memory node (default: all), up to -t, and exit\n"
+      << "  -k, --knee-ratios=LIST    Read ratios for --find-knee (default: "
+         "the -r value)\n"
+      << "  -h, --help                Show this help message\n"
+      << "\nExamples:\n"
+      << "  " << prog_name
+      << " -t 8 -r 1.0 -P nta -F 8192   # readers prefetch 8KB ahead\n"
+      << "  " << prog_name
+      << " -t 4 -b 268435456 --prefetch-sweep=0,2   # find the best distance\n"
+      << "  " << prog_name
+      << " -t 256 --find-knee=0,2 -k 0,0.5,1   # threads per node worth running\n";
 }
 
 BenchmarkConfig parse_args(int argc, char *argv[]) {
@@ -156,11 +253,22 @@ BenchmarkConfig parse_args(int argc, char *argv[]) {
       {"cpu-workload", required_argument, 0, 'w'},
       {"numa-node", optional_argument, 0, 'N'},
       {"no-numa", no_argument, 0, 'n'},
+      {"json", required_argument, 0, 'j'},
+      {"telemetry", required_argument, 0, 'T'},
+      {"resctrl-group", required_argument, 0, 'G'},
+      {"l3-mask", required_argument, 0, 'L'},
+      {"mba", required_argument, 0, 'M'},
+      {"resctrl-root", required_argument, 0, 'R'},
+      {"prefetch", required_argument, 0, 'P'},
+      {"prefetch-distance", required_argument, 0, 'F'},
+      {"prefetch-sweep", optional_argument, 0, 'S'},
+      {"find-knee", optional_argument, 0, 'K'},
+      {"knee-ratios", required_argument, 0, 'k'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}};
 
   int opt, option_index = 0;
-  while ((opt = getopt_long(argc, argv, "b:s:t:d:r:B:D:mchw:N:n", long_options,
+  while ((opt = getopt_long(argc, argv, "b:s:t:d:r:B:D:mchw:N:nj:T:G:L:M:R:P:F:S::K::k:", long_options,
                             &option_index)) != -1) {
     switch (opt) {
     case 'b':
@@ -203,6 +311,76 @@ BenchmarkConfig parse_args(int argc, char *argv[]) {
     case 'n':
       config.enable_numa = false;
       break;
+    case 'j':
+      config.json_path = optarg;
+      break;
+    case 'T':
+      config.telemetry_name = optarg;
+      if (config.telemetry_name[0] != '/')
+        config.telemetry_name = "/" + config.telemetry_name;
+      break;
+    case 'G':
+      config.resctrl_group = optarg;
+      break;
+    case 'L':
+      config.l3_mask = std::stoull(optarg, nullptr, 16);
+      break;
+    case 'M':
+      config.mba_percent = std::stoi(optarg);
+      if (config.mba_percent < 1 || config.mba_percent > 100) {
+        std::cerr << "MBA percentage must be between 1 and 100\n";
+        exit(1);
+      }
+      break;
+    case 'R':
+      config.resctrl_root = optarg;
+      break;
+    case 'P':
+      if (strcmp(optarg, "t0") == 0) {
+        config.prefetch = PrefetchHint::T0;
+      } else if (strcmp(optarg, "t2") == 0) {
+        config.prefetch = PrefetchHint::T2;
+      } else if (strcmp(optarg, "nta") == 0) {
+        config.prefetch = PrefetchHint::NTA;
+      } else if (strcmp(optarg, "none") != 0) {
+        std::cerr << "Prefetch hint must be t0, t2, nta or none\n";
+        exit(1);
+      }
+      break;
+    case 'F':
+      config.prefetch_distance = std::stoull(optarg);
+      break;
+    case 'S': {
+      config.prefetch_sweep = true;
+      std::stringstream nodes(optarg ? optarg : "");
+      std::string node;
+      while (std::getline(nodes, node, ',')) {
+        config.prefetch_sweep_nodes.push_back(std::stoi(node));
+      }
+      break;
+    }
+    case 'K': {
+      config.find_knee = true;
+      std::stringstream nodes(optarg ? optarg : "");
+      std::string node;
+      while (std::getline(nodes, node, ',')) {
+        config.knee_nodes.push_back(std::stoi(node));
+      }
+      break;
+    }
+    case 'k': {
+      std::stringstream ratios(optarg);
+      std::string ratio;
+      while (std::getline(ratios, ratio, ',')) {
+        float r = std::stof(ratio);
+        if (r < 0.0 || r > 1.0) {
+          std::cerr << "Read ratios must be between 0.0 and 1.0\n";
+          exit(1);
+        }
+        config.knee_ratios.push_back(r);
+      }
+      break;
+    }
     case 'h':
       print_usage(argv[0]);
       exit(0);
@@ -212,18 +390,31 @@ BenchmarkConfig parse_args(int argc, char *argv[]) {
     }
   }
 
+  if ((config.l3_mask || config.mba_percent) && config.resctrl_group.empty()) {
+    std::cerr << "--l3-mask and --mba require --resctrl-group\n";
+    exit(1);
+  }
+  if (config.prefetch != PrefetchHint::NONE && config.prefetch_distance == 0) {
+    config.prefetch_distance = 4 * config.block_size;
+  }
+
   return config;
 }
 
 void reader_thread(void *buffer, size_t buffer_size, size_t block_size,
                    std::atomic<bool> &stop_flag, ThreadStats &stats,
                    RateLimiter *rate_limiter, int thread_id,
-                   size_t cpu_workload_size, int numa_node, bool enable_numa) {
+                   size_t cpu_workload_size, int numa_node, bool enable_numa,
+                   PrefetchHint prefetch, size_t prefetch_distance) {
   std::vector<char> local_buffer(block_size);
+  const char *base = static_cast<const char *>(buffer);
+  size_t span = buffer_size - block_size;
   size_t offset = 0;
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), READER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -247,16 +438,21 @@ void reader_thread(void *buffer, size_t buffer_size, size_t block_size,
       rate_limiter->wait_for_tokens(block_size);
     }
 
+    // Prefetch the block `prefetch_distance` ahead, wrapping like offset
+    if (prefetch != PrefetchHint::NONE) {
+      prefetch_lines(prefetch, base + (offset + prefetch_distance) % span,
+                     block_size);
+    }
+
     // Read block from the buffer
-    std::memcpy(local_buffer.data(), static_cast<char *>(buffer) + offset,
-                block_size);
+    std::memcpy(local_buffer.data(), base + offset, block_size);
 
     // Move to next block with wrap-around
-    offset = (offset + block_size) % (buffer_size - block_size);
+    offset = (offset + block_size) % span;
 
     // Update statistics
-    stats.bytes_processed += block_size;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, block_size);
+    cxl_telemetry_add(&stats.operations, 1);
 
     if (cpu_workload_size > 0) {
       size_t work = std::min(cpu_workload_size, block_size);
@@ -279,6 +475,8 @@ void writer_thread(void *buffer, size_t buffer_size, size_t block_size,
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), WRITER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -310,8 +508,8 @@ void writer_thread(void *buffer, size_t buffer_size, size_t block_size,
     offset = (offset + block_size) % (buffer_size - block_size);
 
     // Update statistics
-    stats.bytes_processed += block_size;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, block_size);
+    cxl_telemetry_add(&stats.operations, 1);
 
     if (cpu_workload_size > 0) {
       size_t work = std::min(cpu_workload_size, block_size);
@@ -334,6 +532,8 @@ void device_reader_thread(int fd, size_t file_size, size_t block_size,
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), READER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -372,8 +572,8 @@ void device_reader_thread(int fd, size_t file_size, size_t block_size,
     offset = (offset + block_size) % (file_size - block_size);
 
     // Update statistics
-    stats.bytes_processed += bytes_read;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, bytes_read);
+    cxl_telemetry_add(&stats.operations, 1);
   }
 }
 
@@ -386,6 +586,8 @@ void device_writer_thread(int fd, size_t file_size, size_t block_size,
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), WRITER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -423,8 +625,8 @@ void device_writer_thread(int fd, size_t file_size, size_t block_size,
     offset = (offset + block_size) % (file_size - block_size);
 
     // Update statistics
-    stats.bytes_processed += bytes_written;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, bytes_written);
+    cxl_telemetry_add(&stats.operations, 1);
   }
 }
 
@@ -437,6 +639,8 @@ void mmap_reader_thread(void *mapped_area, size_t file_size, size_t block_size,
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), READER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -468,8 +672,8 @@ void mmap_reader_thread(void *mapped_area, size_t file_size, size_t block_size,
     offset = (offset + block_size) % (file_size - block_size);
 
     // Update statistics
-    stats.bytes_processed += block_size;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, block_size);
+    cxl_telemetry_add(&stats.operations, 1);
   }
 }
 
@@ -482,6 +686,8 @@ void mmap_writer_thread(void *mapped_area, size_t file_size, size_t block_size,
 
   // 保存线程ID用于调度和统计
   stats.thread_id = thread_id;
+  stats.tid = gettid();
+  pthread_setname_np(pthread_self(), WRITER_THREAD_NAME);
 
   // NUMA binding
   if (enable_numa) {
@@ -513,14 +719,1022 @@ void mmap_writer_thread(void *mapped_area, size_t file_size, size_t block_size,
     offset = (offset + block_size) % (file_size - block_size);
 
     // Update statistics
-    stats.bytes_processed += block_size;
-    stats.operations++;
+    cxl_telemetry_add(&stats.bytes_processed, block_size);
+    cxl_telemetry_add(&stats.operations, 1);
+  }
+}
+
+// Owns the --telemetry shared-memory segment and unlinks it on every exit
+class TelemetrySegment {
+public:
+  ~TelemetrySegment() {
+    if (hdr_) {
+      munmap(hdr_, cxl_telemetry_size(hdr_->num_threads));
+      shm_unlink(name_.c_str());
+    }
+  }
+
+  // Returns false (after a warning) if the segment cannot be created
+  bool create(const BenchmarkConfig &config) {
+    name_ = config.telemetry_name;
+    uint64_t size = cxl_telemetry_size(config.num_threads);
+    int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+      std::cerr << "Warning: Failed to create telemetry segment " << name_
+                << ": " << strerror(errno) << std::endl;
+      if (fd >= 0) {
+        close(fd);
+        shm_unlink(name_.c_str());
+      }
+      return false;
+    }
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+      std::cerr << "Warning: Failed to map telemetry segment: "
+                << strerror(errno) << std::endl;
+      shm_unlink(name_.c_str());
+      return false;
+    }
+
+    hdr_ = static_cast<cxl_telemetry_header *>(mem);
+    hdr_->version = CXL_TELEMETRY_VERSION;
+    hdr_->num_threads = config.num_threads;
+    hdr_->phase = CXL_TELEMETRY_SETUP;
+    hdr_->pid = getpid();
+    hdr_->duration = config.duration;
+    hdr_->buffer_size = config.buffer_size;
+    hdr_->block_size = config.block_size;
+    std::strncpy(hdr_->benchmark, "double_bandwidth",
+                 sizeof(hdr_->benchmark) - 1);
+    // Publish the magic last so readers never see a half-written header
+    __atomic_store_n(&hdr_->magic, CXL_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  ThreadStats *threads() { return cxl_telemetry_threads(hdr_); }
+
+  void set_phase(cxl_telemetry_phase phase) {
+    if (!hdr_) {
+      return;
+    }
+    if (phase == CXL_TELEMETRY_RUNNING) {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      hdr_->start_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    __atomic_store_n(&hdr_->phase, phase, __ATOMIC_RELEASE);
+  }
+
+private:
+  std::string name_;
+  cxl_telemetry_header *hdr_ = nullptr;
+};
+
+// While alive, SIGINT/SIGTERM only set a flag. Runs that change
+// machine-wide state (prefetcher MSRs, a resctrl group) poll interrupted()
+// and return early, so the destructors that undo the change still run.
+class InterruptGuard {
+public:
+  InterruptGuard() {
+    struct sigaction sa = {};
+    sa.sa_handler = [](int) { interrupted_ = 1; };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_int_);
+    sigaction(SIGTERM, &sa, &old_term_);
+  }
+
+  ~InterruptGuard() {
+    sigaction(SIGINT, &old_int_, nullptr);
+    sigaction(SIGTERM, &old_term_, nullptr);
+  }
+
+  static bool interrupted() { return interrupted_; }
+
+private:
+  static inline volatile sig_atomic_t interrupted_ = 0;
+  struct sigaction old_int_, old_term_;
+};
+
+// Owns the --resctrl-group control group: programs its schemata, moves the
+// main thread into it before the workers are spawned (they inherit it) and
+// reports the group's MBM counters. A group created here is removed on exit,
+// including after SIGINT/SIGTERM (see InterruptGuard).
+class ResctrlGroup {
+public:
+  ~ResctrlGroup() {
+    if (created_) {
+      resctrl_remove_group(root_.c_str(), name_.c_str());
+    }
+  }
+
+  // Returns false (after an error message) if the group cannot be set up
+  bool setup(const BenchmarkConfig &config) {
+    root_ = config.resctrl_root;
+    name_ = config.resctrl_group;
+    int ret = resctrl_create_group(root_.c_str(), name_.c_str());
+    if (ret < 0) {
+      return fail("create group", ret);
+    }
+    created_ = ret == 1;
+
+    if (config.l3_mask &&
+        (ret = resctrl_set_l3_mask(root_.c_str(), name_.c_str(),
+                                   config.l3_mask)) != 0) {
+      return fail("set L3 mask", ret);
+    }
+    if (config.mba_percent &&
+        (ret = resctrl_set_mba(root_.c_str(), name_.c_str(),
+                               config.mba_percent)) != 0) {
+      return fail("set MBA", ret);
+    }
+    if ((ret = resctrl_assign_task(root_.c_str(), name_.c_str(), gettid())) !=
+        0) {
+      return fail("assign task", ret);
+    }
+
+    mbm_available_ = resctrl_read_mbm(root_.c_str(), name_.c_str(), &start_) > 0;
+    if (!mbm_available_) {
+      std::cerr << "Warning: MBM counters unavailable for resctrl group "
+                << name_ << std::endl;
+    }
+    last_ = start_;
+    active_ = true;
+    return true;
+  }
+
+  bool active() const { return active_; }
+
+  // Sleep until `deadline` or an interrupt, printing the group's MBM
+  // bandwidth every RESCTRL_SAMPLE_MS
+  void sample_until(std::chrono::steady_clock::time_point deadline) {
+    auto last_time = std::chrono::steady_clock::now();
+    while (last_time < deadline && !InterruptGuard::interrupted()) {
+      std::this_thread::sleep_until(
+          std::min(deadline, last_time + std::chrono::milliseconds(
+                                             RESCTRL_SAMPLE_MS)));
+      auto now = std::chrono::steady_clock::now();
+      resctrl_mbm cur;
+      if (mbm_available_ &&
+          resctrl_read_mbm(root_.c_str(), name_.c_str(), &cur) > 0) {
+        double dt = std::chrono::duration<double>(now - last_time).count();
+        std::cout << "resctrl " << name_ << ": MBM local "
+                  << (cur.local_bytes - last_.local_bytes) / MB / dt
+                  << " MB/s, total "
+                  << (cur.total_bytes - last_.total_bytes) / MB / dt
+                  << " MB/s" << std::endl;
+        last_ = cur;
+      }
+      last_time = now;
+    }
+  }
+
+  // Final reading; returns false if MBM is not available
+  bool finish(resctrl_mbm &delta) {
+    resctrl_mbm end;
+    if (!mbm_available_ ||
+        resctrl_read_mbm(root_.c_str(), name_.c_str(), &end) <= 0) {
+      return false;
+    }
+    delta.local_bytes = end.local_bytes - start_.local_bytes;
+    delta.total_bytes = end.total_bytes - start_.total_bytes;
+    return true;
+  }
+
+  const std::string &name() const { return name_; }
+
+private:
+  static constexpr double MB = 1024.0 * 1024.0;
+
+  bool fail(const char *what, int err) {
+    std::cerr << "resctrl: failed to " << what << " for group " << root_
+              << "/" << name_ << ": " << strerror(-err) << std::endl;
+    return false;
+  }
+
+  std::string root_, name_;
+  bool created_ = false;
+  bool active_ = false;
+  bool mbm_available_ = false;
+  resctrl_mbm start_{}, last_{};
+};
+
+void write_json_results(const BenchmarkConfig &config, int num_readers,
+                        int num_writers, double elapsed_seconds,
+                        size_t total_read_bytes, size_t total_read_ops,
+                        size_t total_write_bytes, size_t total_write_ops,
+                        const SystemStateRecorder &state,
+                        const resctrl_mbm *mbm) {
+  std::ofstream out(config.json_path);
+  if (!out) {
+    std::cerr << "Failed to open " << config.json_path << ": "
+              << strerror(errno) << std::endl;
+    return;
+  }
+
+  constexpr double MB = 1024.0 * 1024.0;
+  out << "{\n  \"benchmark\": \"double_bandwidth\",\n  \"environment\": ";
+  write_json_environment(out);
+  out << ",\n  \"config\": {"
+      << "\"buffer_size\": " << config.buffer_size
+      << ", \"block_size\": " << config.block_size
+      << ", \"duration\": " << config.duration
+      << ", \"num_threads\": " << config.num_threads
+      << ", \"read_ratio\": " << config.read_ratio
+      << ", \"max_bandwidth_mbps\": " << config.max_bandwidth_mbps
+      << ", \"device\": " << json_string(config.device_path)
+      << ", \"use_mmap\": " << (config.use_mmap ? "true" : "false")
+      << ", \"numa_node\": " << (config.enable_numa ? config.numa_node : -1)
+      << ", \"resctrl_group\": " << json_string(config.resctrl_group)
+      << ", \"l3_mask\": " << config.l3_mask
+      << ", \"mba_percent\": " << config.mba_percent
+      << ", \"prefetch\": " << json_string(prefetch_hint_name(config.prefetch))
+      << ", \"prefetch_distance\": " << config.prefetch_distance
+      << "},\n  \"results\": {"
+      << "\"elapsed_seconds\": " << elapsed_seconds
+      << ", \"num_readers\": " << num_readers
+      << ", \"num_writers\": " << num_writers
+      << ", \"read_bandwidth_mbps\": "
+      << total_read_bytes / MB / elapsed_seconds
+      << ", \"write_bandwidth_mbps\": "
+      << total_write_bytes / MB / elapsed_seconds
+      << ", \"total_bandwidth_mbps\": "
+      << (total_read_bytes + total_write_bytes) / MB / elapsed_seconds
+      << ", \"read_iops\": " << total_read_ops / elapsed_seconds
+      << ", \"write_iops\": " << total_write_ops / elapsed_seconds;
+  if (mbm) {
+    out << ", \"mbm_local_bandwidth_mbps\": "
+        << mbm->local_bytes / MB / elapsed_seconds
+        << ", \"mbm_total_bandwidth_mbps\": "
+        << mbm->total_bytes / MB / elapsed_seconds;
+  }
+  out << "},\n  \"system_state\": ";
+  state.write_json(out);
+  out << "\n}\n";
+  std::cout << "Results written to " << config.json_path << std::endl;
+}
+
+// Sequential sweep points are prefetch distances in bytes; random points
+// are batch sizes (random blocks whose lines are prefetched before any of
+// them is read). 0 is the no-prefetch baseline.
+const size_t PREFETCH_SEQ_DISTANCES[] = {0,    256,  512,   1024, 2048,
+                                         4096, 8192, 16384, 32768};
+const size_t PREFETCH_RANDOM_BATCHES[] = {0, 1, 2, 4, 8, 16, 32};
+constexpr size_t PREFETCH_MAX_BATCH = 32;
+constexpr int PREFETCH_POINT_MS = 300; // timed reads per sweep point
+
+// Read `block`-sized chunks of `buffer` until `stop`; returns bytes read
+uint64_t prefetch_sweep_reader(const char *buffer, size_t buffer_size,
+                               size_t block, bool random, PrefetchHint hint,
+                               size_t distance, size_t start_block,
+                               const std::atomic<bool> &stop) {
+  std::vector<char> local(block);
+  size_t blocks = buffer_size / block;
+  size_t span = blocks * block;
+  size_t cur = start_block % blocks;
+  uint64_t rng = 0x9e3779b97f4a7c15ULL ^ start_block;
+  uint64_t bytes = 0;
+  size_t batch[PREFETCH_MAX_BATCH];
+
+  auto next_random = [&]() {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (rng % blocks) * block;
+  };
+
+  while (!stop.load(std::memory_order_relaxed)) {
+    if (!random) {
+      size_t off = cur * block;
+      if (distance) {
+        size_t pf = (off + distance) % span;
+        prefetch_lines(hint, buffer + pf, std::min(block, span - pf));
+      }
+      std::memcpy(local.data(), buffer + off, block);
+      cur = cur + 1 == blocks ? 0 : cur + 1;
+      bytes += block;
+    } else if (distance == 0) {
+      std::memcpy(local.data(), buffer + next_random(), block);
+      bytes += block;
+    } else {
+      for (size_t i = 0; i < distance; i++) {
+        batch[i] = next_random();
+        prefetch_lines(hint, buffer + batch[i], block);
+      }
+      for (size_t i = 0; i < distance; i++) {
+        std::memcpy(local.data(), buffer + batch[i], block);
+      }
+      bytes += distance * block;
+    }
+  }
+  // Keep the copies from being optimized away
+  volatile char sink = local[0];
+  (void)sink;
+  return bytes;
+}
+
+// MB/s of `num_threads` readers over PREFETCH_POINT_MS
+double run_prefetch_point(const char *buffer, const BenchmarkConfig &config,
+                          bool random, PrefetchHint hint, size_t distance) {
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> bytes(config.num_threads, 0);
+  std::vector<std::thread> threads;
+  size_t blocks = config.buffer_size / config.block_size;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < config.num_threads; t++) {
+    threads.emplace_back([&, t] {
+      bytes[t] = prefetch_sweep_reader(
+          buffer, config.buffer_size, config.block_size, random, hint,
+          distance, blocks / config.num_threads * t, stop);
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(PREFETCH_POINT_MS));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &t : threads) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+  uint64_t total = 0;
+  for (uint64_t b : bytes) {
+    total += b;
+  }
+  return total / (1024.0 * 1024.0) / secs;
+}
+
+struct PrefetchBest {
+  double baseline_mbps = 0;
+  double best_mbps = 0;
+  PrefetchHint hint = PrefetchHint::NONE;
+  size_t distance = 0;
+};
+
+// Sweep hints x distances for one node and pattern, printing a table
+PrefetchBest sweep_prefetch_pattern(const char *buffer,
+                                    const BenchmarkConfig &config,
+                                    bool random) {
+  const PrefetchHint hints[] = {PrefetchHint::T0, PrefetchHint::T2,
+                                PrefetchHint::NTA};
+  std::vector<size_t> points;
+  if (random) {
+    points.assign(std::begin(PREFETCH_RANDOM_BATCHES),
+                  std::end(PREFETCH_RANDOM_BATCHES));
+  } else {
+    points.assign(std::begin(PREFETCH_SEQ_DISTANCES),
+                  std::end(PREFETCH_SEQ_DISTANCES));
+  }
+
+  std::cout << "  " << (random ? "random" : "sequential") << " ("
+            << (random ? "batch, blocks" : "distance, bytes") << "), MB/s"
+            << std::endl;
+  std::cout << std::setw(14) << (random ? "batch" : "distance");
+  for (PrefetchHint hint : hints) {
+    std::cout << std::setw(12) << prefetch_hint_name(hint);
+  }
+  std::cout << std::endl << std::fixed << std::setprecision(1);
+
+  PrefetchBest best;
+  for (size_t point : points) {
+    if (InterruptGuard::interrupted()) {
+      break;
+    }
+    std::cout << std::setw(14) << point;
+    if (point == 0) {
+      best.baseline_mbps =
+          run_prefetch_point(buffer, config, random, PrefetchHint::NONE, 0);
+      best.best_mbps = best.baseline_mbps;
+      std::cout << std::setw(12) << best.baseline_mbps << "  (no prefetch)"
+                << std::endl;
+      continue;
+    }
+    for (PrefetchHint hint : hints) {
+      double mbps = run_prefetch_point(buffer, config, random, hint, point);
+      std::cout << std::setw(12) << mbps;
+      if (mbps > best.best_mbps) {
+        best = {best.baseline_mbps, mbps, hint, point};
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "  best: ";
+  if (best.hint == PrefetchHint::NONE) {
+    std::cout << "no prefetch";
+  } else {
+    std::cout << prefetch_hint_name(best.hint) << " at " << best.distance
+              << (random ? " blocks" : " bytes") << ", " << best.best_mbps
+              << " MB/s (" << std::showpos
+              << (best.best_mbps / best.baseline_mbps - 1) * 100
+              << std::noshowpos << "% vs no prefetch)";
+  }
+  std::cout << std::defaultfloat << std::endl << std::endl;
+  return best;
+}
+
+// Toggles the Intel hardware prefetchers through MSR 0x1A4 (bits 0-3: L2
+// streamer, L2 adjacent line, L1 streamer, L1 IP) on every online CPU and
+// restores the saved values on destruction
+class HwPrefetchControl {
+public:
+  ~HwPrefetchControl() { restore(); }
+
+  // Returns false with a reason if the MSRs cannot be written
+  bool disable(std::string &reason) {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    bool intel = false;
+    while (std::getline(cpuinfo, line)) {
+      if (line.rfind("vendor_id", 0) == 0) {
+        intel = line.find("GenuineIntel") != std::string::npos;
+        break;
+      }
+    }
+    if (!intel) {
+      reason = "MSR 0x1A4 prefetch control is Intel-specific";
+      return false;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (long cpu = 0; cpu < cpus; cpu++) {
+      std::string path = "/dev/cpu/" + std::to_string(cpu) + "/msr";
+      int fd = open(path.c_str(), O_RDWR);
+      if (fd < 0) {
+        if (errno == ENOENT && cpu > 0) {
+          continue; // offline CPU
+        }
+        reason = path + ": " + strerror(errno) +
+                 " (needs root and the msr module)";
+        restore();
+        return false;
+      }
+      uint64_t value;
+      if (pread(fd, &value, sizeof(value), MSR_MISC_FEATURE_CONTROL) !=
+          sizeof(value)) {
+        reason = "cannot read MSR 0x1A4: " + std::string(strerror(errno));
+        close(fd);
+        restore();
+        return false;
+      }
+      uint64_t disabled = value | HW_PREFETCH_DISABLE_BITS;
+      if (pwrite(fd, &disabled, sizeof(disabled), MSR_MISC_FEATURE_CONTROL) !=
+          sizeof(disabled)) {
+        reason = "cannot write MSR 0x1A4: " + std::string(strerror(errno));
+        close(fd);
+        restore();
+        return false;
+      }
+      saved_.push_back({fd, value});
+    }
+    return !saved_.empty();
+  }
+
+  void restore() {
+    for (const auto &entry : saved_) {
+      if (pwrite(entry.first, &entry.second, sizeof(entry.second),
+                 MSR_MISC_FEATURE_CONTROL) != sizeof(entry.second)) {
+        std::cerr << "Warning: failed to restore MSR 0x1A4: "
+                  << strerror(errno) << std::endl;
+      }
+      close(entry.first);
+    }
+    saved_.clear();
+  }
+
+private:
+  static constexpr off_t MSR_MISC_FEATURE_CONTROL = 0x1a4;
+  static constexpr uint64_t HW_PREFETCH_DISABLE_BITS = 0xf;
+  std::vector<std::pair<int, uint64_t>> saved_; // (msr fd, original value)
+};
+
+// --prefetch-sweep: software prefetch sweep per memory node and pattern,
+// repeated with the hardware prefetchers disabled when possible
+int run_prefetch_sweep(const BenchmarkConfig &config) {
+  std::vector<int> nodes = config.prefetch_sweep_nodes;
+  if (nodes.empty()) {
+    if (numa_available() == -1) {
+      nodes.push_back(-1);
+    } else {
+      for (int node = 0; node <= numa_max_node(); node++) {
+        if (numa_node_size64(node, nullptr) > 0) {
+          nodes.push_back(node);
+        }
+      }
+    }
+  }
+  if (config.enable_numa && numa_run_on_node(config.numa_node) != 0) {
+    std::cerr << "Warning: Failed to run on NUMA node " << config.numa_node
+              << ": " << strerror(errno) << std::endl;
+  }
+
+  std::cout << "=== Prefetch Sensitivity Sweep ===" << std::endl;
+  std::cout << "Buffer: " << config.buffer_size << " bytes per node, block "
+            << config.block_size << " bytes, " << config.num_threads
+            << " reader thread(s), " << PREFETCH_POINT_MS << " ms per point"
+            << std::endl;
+
+  // best[hw_off][random][node]
+  std::map<int, PrefetchBest> best[2][2];
+  InterruptGuard interrupt_guard;
+  HwPrefetchControl hw;
+  for (int hw_off = 0; hw_off <= 1 && !InterruptGuard::interrupted();
+       hw_off++) {
+    if (hw_off) {
+      std::string reason;
+      if (!hw.disable(reason)) {
+        std::cout << "Hardware prefetchers left enabled: " << reason
+                  << std::endl;
+        break;
+      }
+    }
+    for (int node : nodes) {
+      if (InterruptGuard::interrupted()) {
+        break;
+      }
+      char *buffer = static_cast<char *>(
+          node < 0 ? numa_alloc_local(config.buffer_size)
+                   : numa_alloc_onnode(config.buffer_size, node));
+      if (!buffer) {
+        std::cerr << "Failed to allocate " << config.buffer_size
+                  << " bytes on node " << node << std::endl;
+        continue;
+      }
+      std::memset(buffer, 'A', config.buffer_size);
+
+      std::cout << "\n--- memory node " << node << ", hardware prefetchers "
+                << (hw_off ? "disabled" : "enabled") << " ---" << std::endl;
+      for (int random = 0; random <= 1; random++) {
+        best[hw_off][random][node] =
+            sweep_prefetch_pattern(buffer, config, random);
+      }
+      numa_free(buffer, config.buffer_size);
+    }
+  }
+  hw.restore();
+  if (InterruptGuard::interrupted()) {
+    std::cerr << "Interrupted; hardware prefetchers restored" << std::endl;
+    return 1;
+  }
+
+  std::cout << "=== Prefetch Summary (MB/s) ===" << std::endl;
+  std::cout << std::setw(6) << "node" << std::setw(12) << "pattern"
+            << std::setw(12) << "HW" << std::setw(12) << "HW+SW";
+  bool have_off = !best[1][0].empty();
+  if (have_off) {
+    std::cout << std::setw(12) << "none" << std::setw(12) << "SW only";
+  }
+  std::cout << std::endl << std::fixed << std::setprecision(1);
+  for (int node : nodes) {
+    for (int random = 0; random <= 1; random++) {
+      auto on = best[0][random].find(node);
+      if (on == best[0][random].end()) {
+        continue;
+      }
+      std::cout << std::setw(6) << node << std::setw(12)
+                << (random ? "random" : "sequential") << std::setw(12)
+                << on->second.baseline_mbps << std::setw(12)
+                << on->second.best_mbps;
+      auto off = best[1][random].find(node);
+      if (off != best[1][random].end()) {
+        std::cout << std::setw(12) << off->second.baseline_mbps
+                  << std::setw(12) << off->second.best_mbps;
+      }
+      std::cout << std::endl;
+    }
+  }
+  std::cout << std::defaultfloat;
+  return 0;
+}
+
+// Saturation-knee search: bandwidth is measured on a persistent worker pool
+// at 1, 2, 4, ... threads until doubling stops paying off, then the fewest
+// threads reaching KNEE_PEAK_FRACTION of the peak are bisected between the
+// last two doublings
+constexpr double KNEE_PEAK_FRACTION = 0.95;
+constexpr double KNEE_PLATEAU_GAIN = 0.03; // a doubling gaining less is flat
+constexpr int KNEE_PLATEAU_STEPS = 2;      // flat doublings before stopping
+constexpr int KNEE_WARMUP_MS = 100;        // after changing the thread count
+constexpr int KNEE_POINT_MS = 400;         // timed copies per point
+constexpr size_t KNEE_CHASE_SIZE = 64 * 1024 * 1024; // latency probe chain
+constexpr size_t KNEE_CHASE_ACCESSES = 1 << 16;
+constexpr int KNEE_CHASE_RUNS = 5;         // median of this many chases
+
+// Copy workers that stay alive across search points: set_active() wakes
+// the first `active` workers (readers first, then writers) and parks the
+// rest, so a point costs no thread creation or buffer faulting. Workers
+// run on `cpus`, which leaves out the latency probe's CPU when there is
+// one to spare.
+class KneeWorkerPool {
+public:
+  KneeWorkerPool(char *buffer, size_t buffer_size, size_t block_size,
+                 const cpu_set_t &cpus)
+      : buffer_(buffer), buffer_size_(buffer_size), block_size_(block_size),
+        cpus_(cpus) {}
+
+  ~KneeWorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_.store(true);
+    }
+    cv_.notify_all();
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  void set_active(int active, float read_ratio) {
+    while (static_cast<int>(threads_.size()) < active) {
+      slots_.push_back(std::make_unique<Slot>());
+      threads_.emplace_back(&KneeWorkerPool::worker, this,
+                            static_cast<int>(threads_.size()),
+                            slots_.back().get());
+    }
+    int readers = static_cast<int>(active * read_ratio);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < slots_.size(); i++) {
+        slots_[i]->writer.store(static_cast<int>(i) >= readers,
+                                std::memory_order_relaxed);
+      }
+      active_.store(active);
+    }
+    cv_.notify_all();
+  }
+
+  uint64_t total_bytes() const {
+    uint64_t total = 0;
+    for (const auto &slot : slots_) {
+      total += slot->bytes.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<bool> writer{false};
+  };
+
+  void worker(int id, Slot *slot) {
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus_), &cpus_);
+    std::vector<char> local(block_size_, 'W');
+    size_t blocks = buffer_size_ / block_size_;
+    size_t cur = (id * 0x9e3779b1ULL) % blocks;
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return shutdown_.load() || id < active_.load(); });
+      }
+      if (shutdown_.load()) {
+        break;
+      }
+      while (id < active_.load(std::memory_order_relaxed) &&
+             !shutdown_.load(std::memory_order_relaxed)) {
+        bool writer = slot->writer.load(std::memory_order_relaxed);
+        for (int i = 0; i < 64; i++) {
+          char *p = buffer_ + cur * block_size_;
+          if (writer) {
+            std::memcpy(p, local.data(), block_size_);
+          } else {
+            std::memcpy(local.data(), p, block_size_);
+          }
+          cur = cur + 1 == blocks ? 0 : cur + 1;
+        }
+        slot->bytes.fetch_add(64 * block_size_, std::memory_order_relaxed);
+      }
+    }
+    // Keep the reads from being optimized away
+    volatile char sink = local[0];
+    (void)sink;
   }
+
+  char *buffer_;
+  size_t buffer_size_;
+  size_t block_size_;
+  cpu_set_t cpus_;
+  std::vector<std::thread> threads_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<int> active_{0};
+  std::atomic<bool> shutdown_{false};
+};
+
+// MB/s of the pool with `threads` active workers
+double measure_knee_point(KneeWorkerPool &pool, int threads, float read_ratio) {
+  pool.set_active(threads, read_ratio);
+  std::this_thread::sleep_for(std::chrono::milliseconds(KNEE_WARMUP_MS));
+  uint64_t start_bytes = pool.total_bytes();
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(KNEE_POINT_MS));
+  uint64_t bytes = pool.total_bytes() - start_bytes;
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  return bytes / (1024.0 * 1024.0) / secs;
+}
+
+// Random cyclic chain through every cache line of `buffer`
+char *build_chase_chain(char *buffer, size_t size) {
+  size_t lines = size / CACHE_LINE_SIZE;
+  std::vector<size_t> order(lines);
+  for (size_t i = 0; i < lines; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(lines));
+  for (size_t i = 0; i < lines; i++) {
+    char *line = buffer + order[i] * CACHE_LINE_SIZE;
+    *reinterpret_cast<char **>(line) =
+        buffer + order[(i + 1) % lines] * CACHE_LINE_SIZE;
+  }
+  return buffer + order[0] * CACHE_LINE_SIZE;
+}
+
+// Median dependent-load latency in ns along the chain
+double chase_latency_ns(char *start) {
+  std::vector<double> runs;
+  char *p = start;
+  for (int r = 0; r < KNEE_CHASE_RUNS; r++) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < KNEE_CHASE_ACCESSES; i++) {
+      p = *reinterpret_cast<char **>(p);
+    }
+    runs.push_back(std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count() /
+                   KNEE_CHASE_ACCESSES);
+  }
+  char *volatile sink = p;
+  (void)sink;
+  std::sort(runs.begin(), runs.end());
+  return runs[runs.size() / 2];
+}
+
+struct KneeResult {
+  int cpu_node = -1; // node of the workers and probe, -1 = not bound
+  int node = -1;     // memory node
+  float read_ratio = 0;
+  double peak_mbps = 0;
+  int knee_threads = 0;
+  double knee_mbps = 0;
+  double idle_ns = 0;
+  double loaded_ns = 0;
+};
+
+// Exponential then binary search for one memory node and read ratio
+KneeResult search_knee(KneeWorkerPool &pool, char *chain, int max_threads,
+                       float read_ratio) {
+  std::map<int, double> measured;
+  auto measure = [&](int threads, const char *step) {
+    auto it = measured.find(threads);
+    if (it != measured.end()) {
+      return it->second;
+    }
+    double mbps = measure_knee_point(pool, threads, read_ratio);
+    measured[threads] = mbps;
+    std::cout << std::setw(10) << threads << std::setw(12) << mbps
+              << std::setw(10) << step << std::endl;
+    return mbps;
+  };
+
+  std::cout << std::setw(10) << "threads" << std::setw(12) << "MB/s"
+            << std::setw(10) << "step" << std::endl
+            << std::fixed << std::setprecision(1);
+
+  double peak = 0;
+  int flat = 0;
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    double mbps = measure(threads, "double");
+    flat = mbps > peak * (1 + KNEE_PLATEAU_GAIN) ? 0 : flat + 1;
+    peak = std::max(peak, mbps);
+    if (flat >= KNEE_PLATEAU_STEPS || threads == max_threads) {
+      break;
+    }
+  }
+
+  // Fewest measured threads reaching the target, bisected against the
+  // largest measured count below it
+  double target = KNEE_PEAK_FRACTION * peak;
+  int lo = 0, hi = 0;
+  for (const auto &point : measured) {
+    if (point.second >= target) {
+      hi = point.first;
+      break;
+    }
+    lo = point.first;
+  }
+  while (hi - lo > 1) {
+    int mid = lo + (hi - lo) / 2;
+    if (measure(mid, "bisect") >= target) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+
+  KneeResult result;
+  result.read_ratio = read_ratio;
+  result.peak_mbps = peak;
+  result.knee_threads = hi;
+  result.knee_mbps = measured[hi];
+
+  pool.set_active(0, read_ratio);
+  result.idle_ns = chase_latency_ns(chain);
+  pool.set_active(hi, read_ratio);
+  std::this_thread::sleep_for(std::chrono::milliseconds(KNEE_WARMUP_MS));
+  result.loaded_ns = chase_latency_ns(chain);
+  pool.set_active(0, read_ratio);
+
+  std::cout << "  knee: " << hi << " threads, " << result.knee_mbps
+            << " MB/s (" << result.knee_mbps / peak * 100 << "% of peak "
+            << peak << " MB/s), latency " << result.idle_ns << " ns idle, "
+            << result.loaded_ns << " ns loaded" << std::endl
+            << std::defaultfloat;
+  return result;
+}
+
+// CPUs the calling thread may run on
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+void write_knee_json(const BenchmarkConfig &config, int probe_cpu,
+                     const std::vector<KneeResult> &results,
+                     const SystemStateRecorder &state) {
+  std::ofstream out(config.json_path);
+  if (!out) {
+    std::cerr << "Failed to open " << config.json_path << ": "
+              << strerror(errno) << std::endl;
+    return;
+  }
+
+  std::vector<JsonRow> rows;
+  for (const KneeResult &r : results) {
+    rows.push_back(JsonRow()
+                       .key("cpu_node", r.cpu_node)
+                       .key("node", r.node)
+                       .key("read_pct", std::lround(r.read_ratio * 100))
+                       .metric("peak_mbps", r.peak_mbps)
+                       .metric("knee_threads", r.knee_threads)
+                       .metric("knee_mbps", r.knee_mbps)
+                       .metric("idle_latency_ns", r.idle_ns)
+                       .metric("loaded_latency_ns", r.loaded_ns));
+  }
+
+  out << "{\n  \"benchmark\": \"double_bandwidth\",\n  \"environment\": ";
+  write_json_environment(out);
+  out << ",\n  \"config\": {"
+      << "\"mode\": \"find_knee\""
+      << ", \"buffer_size\": " << config.buffer_size
+      << ", \"block_size\": " << config.block_size
+      << ", \"num_threads\": " << config.num_threads
+      << ", \"numa_node\": " << (config.enable_numa ? config.numa_node : -1)
+      << ", \"probe_cpu\": " << probe_cpu << "},\n  \"results\": ";
+  write_json_rows(out, rows);
+  out << ",\n  \"system_state\": ";
+  state.write_json(out);
+  out << "\n}\n";
+  std::cout << "Results written to " << config.json_path << std::endl;
+}
+
+// --find-knee: per memory node and read ratio, the fewest threads reaching
+// 95% of peak bandwidth and the latency a dependent load sees there
+int run_knee_search(const BenchmarkConfig &config) {
+  std::vector<int> nodes = config.knee_nodes;
+  if (nodes.empty()) {
+    if (numa_available() == -1) {
+      nodes.push_back(-1);
+    } else {
+      for (int node = 0; node <= numa_max_node(); node++) {
+        if (numa_node_size64(node, nullptr) > 0) {
+          nodes.push_back(node);
+        }
+      }
+    }
+  }
+  std::vector<float> ratios = config.knee_ratios;
+  if (ratios.empty()) {
+    ratios.push_back(config.read_ratio);
+  }
+  int max_threads = std::max(1, config.num_threads);
+  int cpu_node = config.enable_numa ? config.numa_node : -1;
+  // Every point runs on the same CPUs; the first one is reserved for the
+  // latency probe so the chase never competes with a copy worker
+  if (config.enable_numa && numa_run_on_node(config.numa_node) != 0) {
+    std::cerr << "Warning: Failed to run on NUMA node " << config.numa_node
+              << ": " << strerror(errno) << std::endl;
+  }
+  std::vector<int> cpus = allowed_cpus();
+  cpu_set_t worker_cpus;
+  CPU_ZERO(&worker_cpus);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &worker_cpus);
+  }
+  int probe_cpu = -1;
+  if (cpus.size() > 1) {
+    probe_cpu = cpus.front();
+    CPU_CLR(probe_cpu, &worker_cpus);
+    cpu_set_t probe;
+    CPU_ZERO(&probe);
+    CPU_SET(probe_cpu, &probe);
+    pthread_setaffinity_np(pthread_self(), sizeof(probe), &probe);
+  }
+
+  std::cout << "=== Saturation Knee Search ===" << std::endl;
+  std::cout << "Buffer: " << config.buffer_size << " bytes per node, block "
+            << config.block_size << " bytes, up to " << max_threads
+            << " threads, " << KNEE_POINT_MS << " ms per point, knee at "
+            << KNEE_PEAK_FRACTION * 100 << "% of peak" << std::endl;
+  std::cout << "CPUs: "
+            << (cpu_node >= 0 ? "NUMA node " + std::to_string(cpu_node)
+                              : std::string("not bound (-n)"))
+            << std::endl;
+  if (probe_cpu >= 0) {
+    std::cout << "Latency probe on CPU " << probe_cpu << ", workers on "
+              << cpus.size() - 1 << " other CPUs" << std::endl;
+  } else {
+    std::cout << "Warning: one CPU available, the latency probe shares it "
+                 "with the workers"
+              << std::endl;
+  }
+
+  SystemStateRecorder state;
+  state.start();
+  std::vector<KneeResult> results;
+  for (int node : nodes) {
+    char *buffer = static_cast<char *>(
+        node < 0 ? numa_alloc_local(config.buffer_size)
+                 : numa_alloc_onnode(config.buffer_size, node));
+    char *chain_buffer = static_cast<char *>(
+        node < 0 ? numa_alloc_local(KNEE_CHASE_SIZE)
+                 : numa_alloc_onnode(KNEE_CHASE_SIZE, node));
+    if (!buffer || !chain_buffer) {
+      std::cerr << "Failed to allocate buffers on node " << node << std::endl;
+      if (buffer) {
+        numa_free(buffer, config.buffer_size);
+      }
+      if (chain_buffer) {
+        numa_free(chain_buffer, KNEE_CHASE_SIZE);
+      }
+      continue;
+    }
+    std::memset(buffer, 'A', config.buffer_size);
+    char *chain = build_chase_chain(chain_buffer, KNEE_CHASE_SIZE);
+
+    {
+      KneeWorkerPool pool(buffer, config.buffer_size, config.block_size,
+                          worker_cpus);
+      for (float ratio : ratios) {
+        std::cout << "\n--- memory node " << node << ", read ratio " << ratio
+                  << " ---" << std::endl;
+        KneeResult result = search_knee(pool, chain, max_threads, ratio);
+        result.cpu_node = cpu_node;
+        result.node = node;
+        results.push_back(result);
+      }
+    }
+    numa_free(chain_buffer, KNEE_CHASE_SIZE);
+    numa_free(buffer, config.buffer_size);
+  }
+  state.stop();
+
+  std::cout << "\n=== Knee Summary ===" << std::endl;
+  std::cout << std::setw(9) << "cpu node" << std::setw(9) << "mem node"
+            << std::setw(8) << "read%"
+            << std::setw(12) << "peak MB/s" << std::setw(10) << "knee thr"
+            << std::setw(12) << "knee MB/s" << std::setw(10) << "idle ns"
+            << std::setw(12) << "loaded ns" << std::endl
+            << std::fixed << std::setprecision(1);
+  for (const KneeResult &r : results) {
+    std::cout << std::setw(9) << r.cpu_node << std::setw(9) << r.node
+              << std::setw(8) << r.read_ratio * 100
+              << std::setw(12) << r.peak_mbps << std::setw(10)
+              << r.knee_threads << std::setw(12) << r.knee_mbps
+              << std::setw(10) << r.idle_ns << std::setw(12) << r.loaded_ns
+              << std::endl;
+  }
+  std::cout << std::defaultfloat;
+  if (!config.json_path.empty()) {
+    write_knee_json(config, probe_cpu, results, state);
+  }
+  return results.empty() ? 1 : 0;
 }
 
 int main(int argc, char *argv[]) {
   BenchmarkConfig config = parse_args(argc, argv);
-  config.numa_node=1;
   // Initialize and validate NUMA if enabled
   if (config.enable_numa) {
     if (numa_available() == -1) {
@@ -541,6 +1755,13 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (config.prefetch_sweep) {
+    return run_prefetch_sweep(config);
+  }
+  if (config.find_knee) {
+    return run_knee_search(config);
+  }
+
   // Calculate reader and writer thread counts
   int num_readers = static_cast<int>(config.num_threads * config.read_ratio);
   int num_writers = config.num_threads - num_readers;
@@ -569,6 +1790,11 @@ int main(int argc, char *argv[]) {
   std::cout << "Total threads: " << config.num_threads << std::endl;
   std::cout << "Read ratio: " << config.read_ratio << " (" << num_readers
             << " readers, " << num_writers << " writers)" << std::endl;
+  if (config.prefetch != PrefetchHint::NONE) {
+    std::cout << "Reader prefetch: " << prefetch_hint_name(config.prefetch)
+              << ", " << config.prefetch_distance << " bytes ahead"
+              << std::endl;
+  }
 
   if (config.max_bandwidth_mbps > 0) {
     size_t read_bandwidth =
@@ -600,13 +1826,53 @@ int main(int argc, char *argv[]) {
     std::cout << "NUMA binding: Disabled" << std::endl;
   }
 
+  // Join the resctrl group before any worker exists so all of them inherit
+  // it. With a group, Ctrl-C ends the run early instead of leaving the group
+  // and its schemata behind; the guard outlives the group's cleanup.
+  std::unique_ptr<InterruptGuard> interrupt_guard;
+  ResctrlGroup resctrl;
+  if (!config.resctrl_group.empty()) {
+    interrupt_guard = std::make_unique<InterruptGuard>();
+    if (!resctrl.setup(config)) {
+      return 1;
+    }
+    std::cout << "resctrl group: " << config.resctrl_root << "/"
+              << config.resctrl_group;
+    if (config.l3_mask) {
+      std::cout << " L3 mask 0x" << std::hex << config.l3_mask << std::dec;
+    }
+    if (config.mba_percent) {
+      std::cout << " MBA " << config.mba_percent << "%";
+    }
+    std::cout << std::endl;
+  }
+
   std::cout << "\nStarting benchmark..." << std::endl;
 
   // Prepare threads and resources
   std::vector<std::thread> threads;
-  std::vector<ThreadStats> thread_stats(config.num_threads);
+  std::vector<ThreadStats> local_stats;
+  ThreadStats *thread_stats = nullptr;
   std::atomic<bool> stop_flag(false);
 
+  TelemetrySegment telemetry;
+  if (!config.telemetry_name.empty() && telemetry.create(config)) {
+    thread_stats = telemetry.threads();
+    std::cout << "Telemetry: /dev/shm" << config.telemetry_name << std::endl;
+  } else {
+    local_stats.resize(config.num_threads);
+    thread_stats = local_stats.data();
+  }
+  for (int i = 0; i < config.num_threads; i++) {
+    thread_stats[i].thread_class =
+        i < num_readers ? CXL_TELEMETRY_READ : CXL_TELEMETRY_WRITE;
+    thread_stats[i].numa_node = config.enable_numa ? config.numa_node : -1;
+  }
+
+  // Snapshot vmstat/numastat/PSI/interrupts around the run
+  SystemStateRecorder system_state;
+  system_state.start();
+
   void *buffer = nullptr;
   int fd = -1;
   void *mapped_area = nullptr;
@@ -631,7 +1897,8 @@ int main(int argc, char *argv[]) {
                              config.block_size, std::ref(stop_flag),
                              std::ref(thread_stats[i]), read_limiter.get(),
                              reader_id, config.cpu_workload_size,
-                             config.numa_node, config.enable_numa);
+                             config.numa_node, config.enable_numa,
+                             config.prefetch, config.prefetch_distance);
       }
 
       // 为写线程分配奇数ID (1, 3, 5...)
@@ -707,10 +1974,18 @@ int main(int argc, char *argv[]) {
     }
 
     // Run the benchmark for the specified duration
+    telemetry.set_phase(CXL_TELEMETRY_RUNNING);
     auto start_time = std::chrono::steady_clock::now();
-    std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    if (resctrl.active()) {
+      resctrl.sample_until(start_time + std::chrono::seconds(config.duration));
+    } else {
+      std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+    }
     stop_flag.store(true, std::memory_order_relaxed);
     auto end_time = std::chrono::steady_clock::now();
+    if (InterruptGuard::interrupted()) {
+      std::cout << "Interrupted; reporting the run so far" << std::endl;
+    }
 
     // Wait for all threads to finish
     for (auto &t : threads) {
@@ -718,6 +1993,8 @@ int main(int argc, char *argv[]) {
         t.join();
       }
     }
+    system_state.stop();
+    telemetry.set_phase(CXL_TELEMETRY_DONE);
 
     // Calculate total stats
     double elapsed_seconds =
@@ -768,6 +2045,25 @@ int main(int argc, char *argv[]) {
               << std::endl;
     std::cout << "Total IOPS: " << total_iops << " ops/s" << std::endl;
 
+    resctrl_mbm mbm;
+    bool have_mbm = resctrl.active() && resctrl.finish(mbm);
+    if (have_mbm) {
+      std::cout << "MBM local bandwidth (" << resctrl.name() << "): "
+                << (mbm.local_bytes / (1024.0 * 1024.0)) / elapsed_seconds
+                << " MB/s" << std::endl;
+      std::cout << "MBM total bandwidth (" << resctrl.name() << "): "
+                << (mbm.total_bytes / (1024.0 * 1024.0)) / elapsed_seconds
+                << " MB/s" << std::endl;
+    }
+
+    system_state.print_summary(std::cout);
+    if (!config.json_path.empty()) {
+      write_json_results(config, num_readers, num_writers, elapsed_seconds,
+                         total_read_bytes, total_read_ops, total_write_bytes,
+                         total_write_ops, system_state,
+                         have_mbm ? &mbm : nullptr);
+    }
+
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
   }
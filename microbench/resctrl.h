@@ -0,0 +1,215 @@
+/**
+ * resctrl.h - Minimal client for the Linux resctrl filesystem
+ *
+ * Creates control groups under a resctrl mount, programs their L3 cache
+ * allocation (CAT) way mask and memory-bandwidth allocation (MBA)
+ * percentage, assigns tasks, and reads the MBM local/total byte counters.
+ * Works for Intel RDT and AMD PQoS alike since both are exposed through
+ * the same files. Every function takes the mount point explicitly so tests
+ * can point it at a fake directory tree instead of /sys/fs/resctrl.
+ *
+ * Plain C so both the benchmarks and the BPF scheduler controller can use
+ * it. Functions return 0 (or a count) on success and -errno on failure.
+ */
+
+#ifndef CXL_RESCTRL_H
+#define CXL_RESCTRL_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define RESCTRL_DEFAULT_ROOT "/sys/fs/resctrl"
+#define RESCTRL_PATH_MAX 512
+#define RESCTRL_MAX_DOMAINS 64
+
+struct resctrl_mbm {
+  uint64_t local_bytes; /* summed over all L3 monitoring domains */
+  uint64_t total_bytes;
+};
+
+static inline int resctrl_path(char *buf, size_t len, const char *root,
+                               const char *group, const char *file) {
+  int n = snprintf(buf, len, "%s/%s%s%s", root, group, file ? "/" : "",
+                   file ? file : "");
+  return n < 0 || (size_t)n >= len ? -ENAMETOOLONG : 0;
+}
+
+/* Returns 1 if the group was created, 0 if it already existed */
+static inline int resctrl_create_group(const char *root, const char *group) {
+  char path[RESCTRL_PATH_MAX];
+  int err = resctrl_path(path, sizeof(path), root, group, NULL);
+  if (err)
+    return err;
+  if (mkdir(path, 0755) == 0)
+    return 1;
+  return errno == EEXIST ? 0 : -errno;
+}
+
+static inline int resctrl_remove_group(const char *root, const char *group) {
+  char path[RESCTRL_PATH_MAX];
+  int err = resctrl_path(path, sizeof(path), root, group, NULL);
+  if (err)
+    return err;
+  return rmdir(path) == 0 ? 0 : -errno;
+}
+
+static inline int resctrl_write_file(const char *path, const char *data) {
+  int fd = open(path, O_WRONLY | O_APPEND);
+  if (fd < 0)
+    return -errno;
+  ssize_t len = (ssize_t)strlen(data);
+  int err = write(fd, data, len) == len ? 0 : -errno;
+  close(fd);
+  return err;
+}
+
+/*
+ * Collect the domain ids of `resource` ("L3", "MB", ...) from the group's
+ * schemata, e.g. "    L3:0=7ff;1=7ff" yields {0, 1}. Returns the number of
+ * domains, or -ENOENT if the resource is not supported.
+ */
+static inline int resctrl_domains(const char *root, const char *group,
+                                  const char *resource, int *ids, int max_ids) {
+  char path[RESCTRL_PATH_MAX], line[1024];
+  int err = resctrl_path(path, sizeof(path), root, group, "schemata");
+  if (err)
+    return err;
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return -errno;
+
+  size_t rlen = strlen(resource);
+  int count = -ENOENT;
+  while (fgets(line, sizeof(line), f)) {
+    const char *p = line + strspn(line, " \t");
+    if (strncmp(p, resource, rlen) != 0 || p[rlen] != ':')
+      continue;
+    count = 0;
+    for (p += rlen + 1; *p && count < max_ids;) {
+      char *end;
+      long id = strtol(p, &end, 10);
+      if (end == p || *end != '=')
+        break;
+      ids[count++] = (int)id;
+      p = strchr(end, ';');
+      if (!p)
+        break;
+      p++;
+    }
+    break;
+  }
+  fclose(f);
+  return count;
+}
+
+/* Apply the same `value` to every domain of `resource` */
+static inline int resctrl_set_schemata(const char *root, const char *group,
+                                       const char *resource,
+                                       const char *value) {
+  int ids[RESCTRL_MAX_DOMAINS];
+  int n = resctrl_domains(root, group, resource, ids, RESCTRL_MAX_DOMAINS);
+  if (n <= 0)
+    return n == 0 ? -ENOENT : n;
+
+  char line[1024], path[RESCTRL_PATH_MAX];
+  int len = snprintf(line, sizeof(line), "%s:", resource);
+  for (int i = 0; i < n && len < (int)sizeof(line); i++) {
+    len += snprintf(line + len, sizeof(line) - len, "%s%d=%s", i ? ";" : "",
+                    ids[i], value);
+  }
+  if (len + 2 > (int)sizeof(line))
+    return -E2BIG;
+  strcat(line, "\n");
+
+  int err = resctrl_path(path, sizeof(path), root, group, "schemata");
+  return err ? err : resctrl_write_file(path, line);
+}
+
+/* Capacity bitmask of L3 ways, in hex as resctrl expects */
+static inline int resctrl_set_l3_mask(const char *root, const char *group,
+                                      uint64_t mask) {
+  char value[32];
+  snprintf(value, sizeof(value), "%llx", (unsigned long long)mask);
+  return resctrl_set_schemata(root, group, "L3", value);
+}
+
+/* Bandwidth throttle as a percentage of peak (rounded up by the kernel to
+ * the hardware granularity) */
+static inline int resctrl_set_mba(const char *root, const char *group,
+                                  unsigned percent) {
+  char value[16];
+  snprintf(value, sizeof(value), "%u", percent);
+  return resctrl_set_schemata(root, group, "MB", value);
+}
+
+/* Move one task (thread id) into the group. Threads created afterwards
+ * inherit their creator's group. */
+static inline int resctrl_assign_task(const char *root, const char *group,
+                                      int tid) {
+  char path[RESCTRL_PATH_MAX], data[32];
+  int err = resctrl_path(path, sizeof(path), root, group, "tasks");
+  if (err)
+    return err;
+  snprintf(data, sizeof(data), "%d\n", tid);
+  return resctrl_write_file(path, data);
+}
+
+static inline int resctrl_read_counter(const char *path, uint64_t *value) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return -errno;
+  unsigned long long v;
+  /* "Unavailable" or "Error" when the RMID has no valid reading */
+  int ok = fscanf(f, "%llu", &v) == 1;
+  fclose(f);
+  if (!ok)
+    return -EAGAIN;
+  *value = v;
+  return 0;
+}
+
+/*
+ * Sum mbm_local_bytes/mbm_total_bytes over the group's mon_data/mon_L3_*
+ * domains. Returns the number of domains read. The counters are
+ * cumulative; callers compute rates from successive readings.
+ */
+static inline int resctrl_read_mbm(const char *root, const char *group,
+                                   struct resctrl_mbm *mbm) {
+  char dir[RESCTRL_PATH_MAX], path[RESCTRL_PATH_MAX + 320];
+  int err = resctrl_path(dir, sizeof(dir), root, group, "mon_data");
+  if (err)
+    return err;
+  DIR *d = opendir(dir);
+  if (!d)
+    return -errno;
+
+  int domains = 0;
+  struct dirent *entry;
+  mbm->local_bytes = mbm->total_bytes = 0;
+  while ((entry = readdir(d)) != NULL) {
+    if (strncmp(entry->d_name, "mon_L3_", 7) != 0)
+      continue;
+    uint64_t local = 0, total = 0;
+    snprintf(path, sizeof(path), "%s/%s/mbm_local_bytes", dir, entry->d_name);
+    int local_err = resctrl_read_counter(path, &local);
+    snprintf(path, sizeof(path), "%s/%s/mbm_total_bytes", dir, entry->d_name);
+    int total_err = resctrl_read_counter(path, &total);
+    if (local_err && total_err)
+      continue;
+    mbm->local_bytes += local;
+    mbm->total_bytes += total;
+    domains++;
+  }
+  closedir(d);
+  return domains > 0 ? domains : -ENODATA;
+}
+
+#endif /* CXL_RESCTRL_H */
@@ -0,0 +1,598 @@
+/**
+ * ring_bench.cpp - Producer/consumer ring throughput on CXL-resident memory
+ *
+ * Measures message rate and end-to-end latency of lock-free rings whose
+ * memory (indices and slots) is allocated on a chosen NUMA node:
+ *   spsc: one producer and one consumer; head and tail sit on their own
+ *         cache lines and each side publishes a whole batch with one store
+ *   mpmc: bounded multi-producer/multi-consumer ring with a sequence number
+ *         per slot; producers and consumers claim a batch of slots with one
+ *         fetch_add and hand slots over through their sequence numbers
+ * Every message carries its send timestamp, taken when the producer starts
+ * writing its batch, so the reported latency includes batching delay.
+ * Payloads can be written with non-temporal stores (-N).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <numa.h>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Default parameters
+constexpr size_t DEFAULT_RING_ENTRIES = 4096;
+constexpr size_t DEFAULT_BATCH = 16;
+constexpr int DEFAULT_DURATION = 2; // seconds per cell
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t MAX_LATENCY_SAMPLES = 1 << 20; // per consumer
+constexpr int WARMUP_MS = 100;
+
+enum class RingKind { SPSC, MPMC };
+
+struct RingConfig {
+  std::vector<RingKind> kinds = {RingKind::SPSC, RingKind::MPMC};
+  std::vector<size_t> payload_sizes = {64, 256, 1024, 4096};
+  std::vector<int> nodes; // empty = every node with memory
+  std::vector<int> producer_cpus;
+  std::vector<int> consumer_cpus;
+  int producers = 1;
+  int consumers = 1;
+  size_t entries = DEFAULT_RING_ENTRIES;
+  size_t batch = DEFAULT_BATCH;
+  bool nt_stores = false;
+  int duration = DEFAULT_DURATION;
+};
+
+void print_usage(const char *prog_name) {
+  std::cerr
+      << "Usage: " << prog_name << " [OPTIONS]\n"
+      << "Lock-free ring throughput and latency on a chosen NUMA node\n\n"
+      << "Options:\n"
+      << "  -q, --queue=KINDS         Ring types, comma-separated spsc,mpmc "
+         "(default: both)\n"
+      << "  -s, --payload-sizes=LIST  Payload bytes per message (default: "
+         "64,256,1024,4096)\n"
+      << "  -n, --nodes=LIST          NUMA nodes holding the ring (default: "
+         "every node with memory)\n"
+      << "  -p, --producers=NUM       Producer threads for mpmc (default: 1)\n"
+      << "  -c, --consumers=NUM       Consumer threads for mpmc (default: 1)\n"
+      << "  -P, --producer-cpus=LIST  CPUs producers are pinned to, "
+         "round-robin (default: unpinned)\n"
+      << "  -C, --consumer-cpus=LIST  CPUs consumers are pinned to, "
+         "round-robin (default: unpinned)\n"
+      << "  -e, --entries=NUM         Ring slots, power of two (default: "
+         "4096)\n"
+      << "  -B, --batch=NUM           Messages published/claimed at once "
+         "(default: 16)\n"
+      << "  -N, --nt-stores           Write payloads with non-temporal "
+         "stores\n"
+      << "  -d, --duration=SECONDS    Measurement time per cell (default: 2)\n"
+      << "  -h, --help                Show this help message\n\n"
+      << "Examples:\n"
+      << "  # SPSC and MPMC on DRAM node 0 and CXL node 2, CPUs 0 -> 1\n"
+      << "  " << prog_name << " -n 0,2 -P 0 -C 1\n\n"
+      << "  # 4 producers, 4 consumers, 1KB payloads with NT stores\n"
+      << "  " << prog_name
+      << " -q mpmc -p 4 -c 4 -s 1024 -N -n 2 -P 0-3 -C 4-7\n";
+}
+
+// Parse "0,2,4-7"
+std::vector<int> parse_int_list(const std::string &list) {
+  std::vector<int> values;
+  size_t pos = 0;
+  while (pos < list.length()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos)
+      comma = list.length();
+    std::string item = list.substr(pos, comma - pos);
+    size_t dash = item.find('-');
+    if (dash != std::string::npos) {
+      int first = std::stoi(item.substr(0, dash));
+      int last = std::stoi(item.substr(dash + 1));
+      for (int v = first; v <= last; v++)
+        values.push_back(v);
+    } else if (!item.empty()) {
+      values.push_back(std::stoi(item));
+    }
+    pos = comma + 1;
+  }
+  return values;
+}
+
+RingConfig parse_args(int argc, char *argv[]) {
+  RingConfig config;
+
+  static struct option long_options[] = {
+      {"queue", required_argument, 0, 'q'},
+      {"payload-sizes", required_argument, 0, 's'},
+      {"nodes", required_argument, 0, 'n'},
+      {"producers", required_argument, 0, 'p'},
+      {"consumers", required_argument, 0, 'c'},
+      {"producer-cpus", required_argument, 0, 'P'},
+      {"consumer-cpus", required_argument, 0, 'C'},
+      {"entries", required_argument, 0, 'e'},
+      {"batch", required_argument, 0, 'B'},
+      {"nt-stores", no_argument, 0, 'N'},
+      {"duration", required_argument, 0, 'd'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}};
+
+  int opt, option_index = 0;
+  while ((opt = getopt_long(argc, argv, "q:s:n:p:c:P:C:e:B:Nd:h",
+                            long_options, &option_index)) != -1) {
+    switch (opt) {
+    case 'q': {
+      config.kinds.clear();
+      std::string list(optarg);
+      size_t pos = 0;
+      while (pos < list.length()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+          comma = list.length();
+        std::string kind = list.substr(pos, comma - pos);
+        if (kind == "spsc") {
+          config.kinds.push_back(RingKind::SPSC);
+        } else if (kind == "mpmc") {
+          config.kinds.push_back(RingKind::MPMC);
+        } else {
+          std::cerr << "Unknown queue type: " << kind << "\n";
+          exit(1);
+        }
+        pos = comma + 1;
+      }
+      break;
+    }
+    case 's':
+      config.payload_sizes.clear();
+      for (int size : parse_int_list(optarg)) {
+        if (size < 1) {
+          std::cerr << "Payload sizes must be positive\n";
+          exit(1);
+        }
+        config.payload_sizes.push_back(size);
+      }
+      break;
+    case 'n':
+      config.nodes = parse_int_list(optarg);
+      break;
+    case 'p':
+      config.producers = std::max(1, std::stoi(optarg));
+      break;
+    case 'c':
+      config.consumers = std::max(1, std::stoi(optarg));
+      break;
+    case 'P':
+      config.producer_cpus = parse_int_list(optarg);
+      break;
+    case 'C':
+      config.consumer_cpus = parse_int_list(optarg);
+      break;
+    case 'e':
+      config.entries = std::stoull(optarg);
+      break;
+    case 'B':
+      config.batch = std::max(1ULL, std::stoull(optarg));
+      break;
+    case 'N':
+      config.nt_stores = true;
+      break;
+    case 'd':
+      config.duration = std::max(1, std::stoi(optarg));
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      exit(0);
+    default:
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (config.entries < 2 || (config.entries & (config.entries - 1)) != 0) {
+    std::cerr << "Ring entries must be a power of two\n";
+    exit(1);
+  }
+  if (config.batch > config.entries) {
+    std::cerr << "Batch cannot exceed the ring size\n";
+    exit(1);
+  }
+  return config;
+}
+
+inline uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+bool pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Copy with non-temporal stores; the caller fences before publishing
+void stream_copy(char *dst, const char *src, size_t size) {
+  size_t done = 0;
+#if defined(__SSE2__)
+  for (; done + 16 <= size; done += 16) {
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + done),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done)));
+  }
+#endif
+  std::memcpy(dst + done, src + done, size - done);
+}
+
+inline void store_fence() {
+#if defined(__SSE2__)
+  _mm_sfence();
+#else
+  std::atomic_thread_fence(std::memory_order_release);
+#endif
+}
+
+struct alignas(CACHE_LINE_SIZE) PaddedCounter {
+  std::atomic<uint64_t> value{0};
+};
+
+// Control block at the start of the ring memory
+struct RingIndices {
+  PaddedCounter head; // next position to consume (claim, for mpmc)
+  PaddedCounter tail; // next position to produce (claim, for mpmc)
+};
+
+// Slots are whole cache lines: this header, then the payload
+struct SlotHeader {
+  std::atomic<uint64_t> seq; // mpmc hand-over sequence, unused by spsc
+  uint64_t send_ns;
+};
+
+class Ring {
+public:
+  Ring(RingKind kind, size_t entries, size_t payload, int node)
+      : kind_(kind), entries_(entries), mask_(entries - 1), payload_(payload) {
+    stride_ = (sizeof(SlotHeader) + payload + CACHE_LINE_SIZE - 1) /
+              CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    size_ = sizeof(RingIndices) + entries * stride_;
+    mem_ = static_cast<char *>(numa_alloc_onnode(size_, node));
+    if (!mem_) {
+      return;
+    }
+    std::memset(mem_, 0, size_); // fault every page in on the node
+    indices_ = new (mem_) RingIndices();
+    slots_ = mem_ + sizeof(RingIndices);
+    for (uint64_t i = 0; i < entries; i++) {
+      new (slot(i)) SlotHeader{{i}, 0};
+    }
+  }
+
+  ~Ring() {
+    if (mem_) {
+      numa_free(mem_, size_);
+    }
+  }
+
+  bool ok() const { return mem_ != nullptr; }
+  SlotHeader *slot(uint64_t pos) {
+    return reinterpret_cast<SlotHeader *>(slots_ + (pos & mask_) * stride_);
+  }
+  static char *payload(SlotHeader *slot) {
+    return reinterpret_cast<char *>(slot + 1);
+  }
+
+  RingKind kind_;
+  size_t entries_, mask_, payload_, stride_, size_ = 0;
+  char *mem_ = nullptr;
+  char *slots_ = nullptr;
+  RingIndices *indices_ = nullptr;
+};
+
+// Each worker updates its own result in the hot loop; one line per result
+// keeps false sharing out of the measurement
+struct alignas(CACHE_LINE_SIZE) WorkerResult {
+  uint64_t messages = 0;
+  uint64_t checksum = 0;
+  std::vector<uint64_t> latencies_ns;
+  bool pinned = true;
+};
+
+struct CellControl {
+  std::atomic<bool> go{false};
+  std::atomic<bool> measuring{false};
+  std::atomic<bool> stop{false};
+};
+
+void write_message(SlotHeader *slot, uint64_t send_ns, const char *src,
+                   size_t payload, bool nt) {
+  slot->send_ns = send_ns;
+  if (nt) {
+    stream_copy(Ring::payload(slot), src, payload);
+  } else {
+    std::memcpy(Ring::payload(slot), src, payload);
+  }
+}
+
+void read_message(SlotHeader *slot, char *dst, size_t payload,
+                  WorkerResult &result, bool sample, bool counting) {
+  if (sample && counting &&
+      result.latencies_ns.size() < MAX_LATENCY_SAMPLES) {
+    result.latencies_ns.push_back(now_ns() - slot->send_ns);
+  }
+  std::memcpy(dst, Ring::payload(slot), payload);
+  result.checksum += static_cast<unsigned char>(dst[payload - 1]);
+}
+
+void spsc_producer(Ring &ring, const RingConfig &config, CellControl &ctl,
+                   WorkerResult &result) {
+  std::vector<char> src(ring.payload_, 'P');
+  RingIndices *idx = ring.indices_;
+  uint64_t tail = idx->tail.value.load(std::memory_order_relaxed);
+  uint64_t head_cache = idx->head.value.load(std::memory_order_acquire);
+  const uint64_t batch = config.batch;
+
+  while (!ctl.stop.load(std::memory_order_relaxed)) {
+    while (tail + batch - head_cache > ring.entries_) {
+      head_cache = idx->head.value.load(std::memory_order_acquire);
+      if (ctl.stop.load(std::memory_order_relaxed))
+        return;
+      cpu_relax();
+    }
+    uint64_t send_ns = now_ns();
+    for (uint64_t i = 0; i < batch; i++) {
+      write_message(ring.slot(tail + i), send_ns, src.data(), ring.payload_,
+                    config.nt_stores);
+    }
+    if (config.nt_stores)
+      store_fence();
+    tail += batch;
+    idx->tail.value.store(tail, std::memory_order_release);
+    if (ctl.measuring.load(std::memory_order_relaxed))
+      result.messages += batch;
+  }
+}
+
+void spsc_consumer(Ring &ring, const RingConfig &config, CellControl &ctl,
+                   WorkerResult &result) {
+  std::vector<char> dst(ring.payload_);
+  RingIndices *idx = ring.indices_;
+  uint64_t head = idx->head.value.load(std::memory_order_relaxed);
+  uint64_t tail_cache = head;
+
+  while (!ctl.stop.load(std::memory_order_relaxed)) {
+    if (head == tail_cache) {
+      tail_cache = idx->tail.value.load(std::memory_order_acquire);
+      if (head == tail_cache) {
+        cpu_relax();
+        continue;
+      }
+    }
+    uint64_t n = std::min<uint64_t>(tail_cache - head, config.batch);
+    bool counting = ctl.measuring.load(std::memory_order_relaxed);
+    for (uint64_t i = 0; i < n; i++) {
+      read_message(ring.slot(head + i), dst.data(), ring.payload_, result,
+                   i == 0, counting);
+    }
+    head += n;
+    idx->head.value.store(head, std::memory_order_release);
+    if (counting)
+      result.messages += n;
+  }
+}
+
+void mpmc_producer(Ring &ring, const RingConfig &config, CellControl &ctl,
+                   WorkerResult &result) {
+  std::vector<char> src(ring.payload_, 'P');
+  RingIndices *idx = ring.indices_;
+  const uint64_t batch = config.batch;
+
+  while (!ctl.stop.load(std::memory_order_relaxed)) {
+    uint64_t pos = idx->tail.value.fetch_add(batch, std::memory_order_relaxed);
+    uint64_t send_ns = now_ns();
+    for (uint64_t i = 0; i < batch; i++) {
+      SlotHeader *slot = ring.slot(pos + i);
+      // Wait for the consumer of the previous lap to release the slot
+      while (slot->seq.load(std::memory_order_acquire) != pos + i) {
+        if (ctl.stop.load(std::memory_order_relaxed))
+          return;
+        cpu_relax();
+      }
+      write_message(slot, send_ns, src.data(), ring.payload_,
+                    config.nt_stores);
+      if (config.nt_stores)
+        store_fence();
+      slot->seq.store(pos + i + 1, std::memory_order_release);
+    }
+    if (ctl.measuring.load(std::memory_order_relaxed))
+      result.messages += batch;
+  }
+}
+
+void mpmc_consumer(Ring &ring, const RingConfig &config, CellControl &ctl,
+                   WorkerResult &result) {
+  std::vector<char> dst(ring.payload_);
+  RingIndices *idx = ring.indices_;
+  const uint64_t batch = config.batch;
+
+  while (!ctl.stop.load(std::memory_order_relaxed)) {
+    uint64_t pos = idx->head.value.fetch_add(batch, std::memory_order_relaxed);
+    for (uint64_t i = 0; i < batch; i++) {
+      SlotHeader *slot = ring.slot(pos + i);
+      while (slot->seq.load(std::memory_order_acquire) != pos + i + 1) {
+        if (ctl.stop.load(std::memory_order_relaxed))
+          return;
+        cpu_relax();
+      }
+      bool counting = ctl.measuring.load(std::memory_order_relaxed);
+      read_message(slot, dst.data(), ring.payload_, result, i == 0, counting);
+      slot->seq.store(pos + i + ring.entries_, std::memory_order_release);
+      if (counting)
+        result.messages++;
+    }
+  }
+}
+
+struct CellResult {
+  double messages_per_sec = 0;
+  double mb_per_sec = 0;
+  double p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0; // ns
+  bool pinned = true;
+};
+
+double percentile(const std::vector<uint64_t> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+}
+
+bool run_cell(RingKind kind, int node, size_t payload, int producers,
+              int consumers, const RingConfig &config, CellResult &cell) {
+  Ring ring(kind, config.entries, payload, node);
+  if (!ring.ok()) {
+    std::cerr << "Failed to allocate ring on node " << node << std::endl;
+    return false;
+  }
+
+  CellControl ctl;
+  std::vector<WorkerResult> results(producers + consumers);
+  std::vector<std::thread> threads;
+  auto start_worker = [&](int index, const std::vector<int> &cpus, int slot,
+                          void (*fn)(Ring &, const RingConfig &, CellControl &,
+                                     WorkerResult &)) {
+    threads.emplace_back([&, index, slot, fn, cpus] {
+      WorkerResult &result = results[index];
+      if (!cpus.empty())
+        result.pinned = pin_to_cpu(cpus[slot % cpus.size()]);
+      while (!ctl.go.load(std::memory_order_acquire))
+        cpu_relax();
+      fn(ring, config, ctl, result);
+    });
+  };
+
+  bool spsc = kind == RingKind::SPSC;
+  for (int i = 0; i < consumers; i++) {
+    start_worker(producers + i, config.consumer_cpus, i,
+                 spsc ? spsc_consumer : mpmc_consumer);
+  }
+  for (int i = 0; i < producers; i++) {
+    start_worker(i, config.producer_cpus, i,
+                 spsc ? spsc_producer : mpmc_producer);
+  }
+
+  ctl.go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(WARMUP_MS));
+  ctl.measuring.store(true, std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+  ctl.measuring.store(false, std::memory_order_relaxed);
+  auto end = std::chrono::steady_clock::now();
+  ctl.stop.store(true, std::memory_order_relaxed);
+  for (auto &t : threads)
+    t.join();
+
+  double elapsed = std::chrono::duration<double>(end - start).count();
+  uint64_t consumed = 0;
+  std::vector<uint64_t> latencies;
+  for (int i = 0; i < producers + consumers; i++) {
+    cell.pinned = cell.pinned && results[i].pinned;
+    if (i < producers)
+      continue;
+    consumed += results[i].messages;
+    latencies.insert(latencies.end(), results[i].latencies_ns.begin(),
+                     results[i].latencies_ns.end());
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  cell.messages_per_sec = consumed / elapsed;
+  cell.mb_per_sec = consumed * payload / (1024.0 * 1024.0) / elapsed;
+  cell.p50 = percentile(latencies, 0.50);
+  cell.p90 = percentile(latencies, 0.90);
+  cell.p99 = percentile(latencies, 0.99);
+  cell.p999 = percentile(latencies, 0.999);
+  cell.max = latencies.empty() ? 0 : latencies.back();
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  RingConfig config = parse_args(argc, argv);
+
+  if (numa_available() == -1) {
+    std::cerr << "NUMA is not available on this system" << std::endl;
+    return 1;
+  }
+  if (config.nodes.empty()) {
+    for (int node = 0; node <= numa_max_node(); node++) {
+      if (numa_node_size64(node, nullptr) > 0)
+        config.nodes.push_back(node);
+    }
+  }
+  for (int node : config.nodes) {
+    if (node < 0 || node > numa_max_node()) {
+      std::cerr << "NUMA node " << node << " does not exist" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "=== CXL Ring Buffer Benchmark ===" << std::endl;
+  std::cout << "Ring: " << config.entries << " slots, batch " << config.batch
+            << ", payload stores "
+            << (config.nt_stores ? "non-temporal" : "regular") << std::endl;
+  std::cout << "Duration: " << config.duration << " s per cell" << std::endl;
+
+  for (RingKind kind : config.kinds) {
+    bool spsc = kind == RingKind::SPSC;
+    int producers = spsc ? 1 : config.producers;
+    int consumers = spsc ? 1 : config.consumers;
+
+    std::cout << "\n--- " << (spsc ? "SPSC" : "MPMC") << " ring, "
+              << producers << " producer(s), " << consumers
+              << " consumer(s) ---" << std::endl;
+    std::cout << std::setw(6) << "node" << std::setw(9) << "payload"
+              << std::setw(14) << "Mmsg/s" << std::setw(12) << "MB/s"
+              << std::setw(11) << "p50 ns" << std::setw(11) << "p90 ns"
+              << std::setw(11) << "p99 ns" << std::setw(12) << "p99.9 ns"
+              << std::setw(12) << "max ns" << std::endl;
+
+    for (int node : config.nodes) {
+      for (size_t payload : config.payload_sizes) {
+        CellResult cell;
+        if (!run_cell(kind, node, payload, producers, consumers, config,
+                      cell)) {
+          continue;
+        }
+        std::cout << std::fixed << std::setprecision(3) << std::setw(6)
+                  << node << std::setw(9) << payload << std::setw(14)
+                  << cell.messages_per_sec / 1e6 << std::setprecision(1)
+                  << std::setw(12) << cell.mb_per_sec << std::setprecision(0)
+                  << std::setw(11) << cell.p50 << std::setw(11) << cell.p90
+                  << std::setw(11) << cell.p99 << std::setw(12) << cell.p999
+                  << std::setw(12) << cell.max
+                  << (cell.pinned ? "" : "  (pinning failed)")
+                  << std::defaultfloat << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,406 @@
+/**
+ * system_state.h - System-state snapshots around benchmark runs
+ *
+ * Captures /proc/vmstat, per-node numastat and free memory, PSI pressure and
+ * /proc/interrupts before and after a run, plus periodic samples while it
+ * executes. The deltas explain noisy runs (AutoNUMA scanning, migration,
+ * THP compaction, reclaim) and are written into the result JSON.
+ */
+
+#ifndef SYSTEM_STATE_H
+#define SYSTEM_STATE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <sys/utsname.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+constexpr int DEFAULT_STATE_INTERVAL_MS = 1000; // periodic sample interval
+
+// vmstat counters reported as key deltas and in every periodic sample
+const char *const KEY_VMSTAT_COUNTERS[] = {
+    "numa_hint_faults", "numa_pages_migrated", "pgmigrate_success",
+    "pgmigrate_fail",   "thp_fault_alloc",     "thp_fault_fallback",
+    "compact_stall",    "pgscan_kswapd",       "pgscan_direct",
+};
+
+struct SystemSnapshot {
+  double timestamp = 0; // seconds since the recorder started
+  std::map<std::string, long long> vmstat;
+  std::map<int, std::map<std::string, long long>> numastat;
+  std::map<int, long long> node_free_kb;
+  std::map<std::string, double> pressure;   // "memory.some.avg10", ...
+  std::map<std::string, long long> interrupts; // IRQ -> sum over CPUs
+};
+
+inline void read_counter_file(const std::string &path,
+                              std::map<std::string, long long> &out) {
+  std::ifstream in(path);
+  std::string name;
+  long long value;
+  while (in >> name >> value) {
+    out[name] = value;
+  }
+}
+
+inline std::vector<int> list_numa_nodes() {
+  std::vector<int> nodes;
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (!dir) {
+    return nodes;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    int node;
+    if (std::sscanf(entry->d_name, "node%d", &node) == 1) {
+      nodes.push_back(node);
+    }
+  }
+  closedir(dir);
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+// Parses "some avg10=0.00 avg60=0.00 avg300=0.00 total=123" lines
+inline void read_pressure(const std::string &resource,
+                          std::map<std::string, double> &out) {
+  std::ifstream in("/proc/pressure/" + resource);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string kind, field;
+    fields >> kind;
+    while (fields >> field) {
+      size_t eq = field.find('=');
+      if (eq == std::string::npos) {
+        continue;
+      }
+      out[resource + "." + kind + "." + field.substr(0, eq)] =
+          std::stod(field.substr(eq + 1));
+    }
+  }
+}
+
+inline void read_interrupts(std::map<std::string, long long> &out) {
+  std::ifstream in("/proc/interrupts");
+  std::string line;
+  if (!std::getline(in, line)) {
+    return;
+  }
+  std::istringstream header(line);
+  std::string cpu;
+  int num_cpus = 0;
+  while (header >> cpu) {
+    num_cpus++;
+  }
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string irq;
+    fields >> irq;
+    if (irq.empty() || irq.back() != ':') {
+      continue;
+    }
+    irq.pop_back();
+    long long total = 0, count;
+    for (int i = 0; i < num_cpus && fields >> count; i++) {
+      total += count;
+    }
+    out[irq] = total;
+  }
+}
+
+inline SystemSnapshot capture_system_state() {
+  SystemSnapshot snap;
+  read_counter_file("/proc/vmstat", snap.vmstat);
+
+  for (int node : list_numa_nodes()) {
+    std::string base = "/sys/devices/system/node/node" + std::to_string(node);
+    read_counter_file(base + "/numastat", snap.numastat[node]);
+
+    // "Node 0 MemFree:        12345 kB"
+    std::ifstream meminfo(base + "/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+      long long kb;
+      if (std::sscanf(line.c_str(), "Node %*d MemFree: %lld kB", &kb) == 1) {
+        snap.node_free_kb[node] = kb;
+        break;
+      }
+    }
+  }
+
+  read_pressure("memory", snap.pressure);
+  read_pressure("cpu", snap.pressure);
+  read_interrupts(snap.interrupts);
+  return snap;
+}
+
+template <typename K>
+std::map<K, long long> counter_delta(const std::map<K, long long> &before,
+                                     const std::map<K, long long> &after) {
+  std::map<K, long long> delta;
+  for (const auto &entry : after) {
+    auto it = before.find(entry.first);
+    long long diff = entry.second - (it == before.end() ? 0 : it->second);
+    if (diff != 0) {
+      delta[entry.first] = diff;
+    }
+  }
+  return delta;
+}
+
+inline std::string json_string(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+inline std::string json_key(const std::string &key) { return json_string(key); }
+inline std::string json_key(int key) { return json_string(std::to_string(key)); }
+
+template <typename K, typename V>
+void write_json_map(std::ostream &out, const std::map<K, V> &values) {
+  out << "{";
+  bool first = true;
+  for (const auto &entry : values) {
+    out << (first ? "" : ", ") << json_key(entry.first) << ": " << entry.second;
+    first = false;
+  }
+  out << "}";
+}
+
+inline std::string read_first_line(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+// Loaded sched_ext scheduler as "scx_<ops>", or "default"
+inline std::string current_scheduler() {
+  if (read_first_line("/sys/kernel/sched_ext/state") != "enabled") {
+    return "default";
+  }
+  std::string ops = read_first_line("/sys/kernel/sched_ext/root/ops");
+  return ops.empty() ? "scx" : "scx_" + ops;
+}
+
+// Writes the "environment" object: the host, kernel and scheduler the run
+// executed under, recorded by the benchmark rather than when it is archived
+inline void write_json_environment(std::ostream &out) {
+  char hostname[256] = "";
+  gethostname(hostname, sizeof(hostname) - 1);
+  struct utsname uts {};
+  uname(&uts);
+  out << "{\"hostname\": " << json_string(hostname)
+      << ", \"kernel\": " << json_string(uts.release)
+      << ", \"scheduler\": " << json_string(current_scheduler()) << "}";
+}
+
+// One row of a sweep table, written as an element of the "results" array:
+// {"key": {fields identifying the row}, metric: value, ...}
+class JsonRow {
+public:
+  JsonRow &key(const std::string &name, const std::string &value) {
+    keys_.push_back(json_string(name) + ": " + json_string(value));
+    return *this;
+  }
+
+  JsonRow &key(const std::string &name, long long value) {
+    keys_.push_back(json_string(name) + ": " + std::to_string(value));
+    return *this;
+  }
+
+  // Non-finite values (a division by an idle baseline of 0) are dropped
+  JsonRow &metric(const std::string &name, double value) {
+    if (std::isfinite(value)) {
+      std::ostringstream field;
+      field << json_string(name) << ": " << value;
+      metrics_.push_back(field.str());
+    }
+    return *this;
+  }
+
+  void write_json(std::ostream &out) const {
+    out << "{\"key\": {";
+    for (size_t i = 0; i < keys_.size(); i++) {
+      out << (i ? ", " : "") << keys_[i];
+    }
+    out << "}";
+    for (const std::string &field : metrics_) {
+      out << ", " << field;
+    }
+    out << "}";
+  }
+
+private:
+  std::vector<std::string> keys_;
+  std::vector<std::string> metrics_;
+};
+
+// Writes the "results" array of a sweep (without a trailing newline)
+inline void write_json_rows(std::ostream &out,
+                            const std::vector<JsonRow> &rows) {
+  out << "[";
+  for (size_t i = 0; i < rows.size(); i++) {
+    out << (i ? ",\n    " : "\n    ");
+    rows[i].write_json(out);
+  }
+  out << (rows.empty() ? "]" : "\n  ]");
+}
+
+// Records a snapshot at start(), samples periodically, and one at stop()
+class SystemStateRecorder {
+public:
+  explicit SystemStateRecorder(int interval_ms = DEFAULT_STATE_INTERVAL_MS)
+      : interval_ms_(interval_ms) {}
+
+  ~SystemStateRecorder() { stop(); }
+
+  void start() {
+    origin_ = std::chrono::steady_clock::now();
+    before_ = capture_system_state();
+    running_ = true;
+    if (interval_ms_ > 0) {
+      sampler_ = std::thread(&SystemStateRecorder::sample_loop, this);
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        return;
+      }
+      running_ = false;
+    }
+    cv_.notify_all();
+    if (sampler_.joinable()) {
+      sampler_.join();
+    }
+    after_ = capture_system_state();
+    after_.timestamp = elapsed();
+  }
+
+  std::map<std::string, long long> key_deltas() const {
+    std::map<std::string, long long> deltas;
+    for (const char *name : KEY_VMSTAT_COUNTERS) {
+      deltas[name] = counter_value(after_, name) - counter_value(before_, name);
+    }
+    return deltas;
+  }
+
+  void print_summary(std::ostream &out) const {
+    out << "\n=== System State Deltas ===" << std::endl;
+    for (const auto &entry : key_deltas()) {
+      out << entry.first << ": " << entry.second << std::endl;
+    }
+  }
+
+  // Writes the "system_state" JSON object (without a trailing newline)
+  void write_json(std::ostream &out) const {
+    out << "{\n    \"interval_ms\": " << interval_ms_
+        << ",\n    \"duration_seconds\": " << after_.timestamp
+        << ",\n    \"key_deltas\": ";
+    write_json_map(out, key_deltas());
+    out << ",\n    \"vmstat_delta\": ";
+    write_json_map(out, counter_delta(before_.vmstat, after_.vmstat));
+    out << ",\n    \"numastat_delta\": {";
+    bool first = true;
+    for (const auto &node : after_.numastat) {
+      auto it = before_.numastat.find(node.first);
+      out << (first ? "" : ", ") << json_key(node.first) << ": ";
+      write_json_map(out, it == before_.numastat.end()
+                              ? node.second
+                              : counter_delta(it->second, node.second));
+      first = false;
+    }
+    out << "},\n    \"interrupts_delta\": ";
+    write_json_map(out, counter_delta(before_.interrupts, after_.interrupts));
+    out << ",\n    \"pressure_before\": ";
+    write_json_map(out, before_.pressure);
+    out << ",\n    \"pressure_after\": ";
+    write_json_map(out, after_.pressure);
+    out << ",\n    \"node_free_kb_before\": ";
+    write_json_map(out, before_.node_free_kb);
+    out << ",\n    \"node_free_kb_after\": ";
+    write_json_map(out, after_.node_free_kb);
+    out << ",\n    \"samples\": [";
+    for (size_t i = 0; i < samples_.size(); i++) {
+      const SystemSnapshot &s = samples_[i];
+      std::map<std::string, long long> key;
+      for (const char *name : KEY_VMSTAT_COUNTERS) {
+        key[name] = counter_value(s, name) - counter_value(before_, name);
+      }
+      out << (i == 0 ? "\n" : ",\n") << "      {\"t\": " << s.timestamp
+          << ", \"key_deltas\": ";
+      write_json_map(out, key);
+      out << ", \"pressure\": ";
+      write_json_map(out, s.pressure);
+      out << ", \"node_free_kb\": ";
+      write_json_map(out, s.node_free_kb);
+      out << "}";
+    }
+    out << (samples_.empty() ? "]" : "\n    ]") << "\n  }";
+  }
+
+private:
+  static long long counter_value(const SystemSnapshot &snap,
+                                 const std::string &name) {
+    auto it = snap.vmstat.find(name);
+    return it == snap.vmstat.end() ? 0 : it->second;
+  }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         origin_)
+        .count();
+  }
+
+  void sample_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                         [this] { return !running_; })) {
+      lock.unlock();
+      SystemSnapshot snap = capture_system_state();
+      snap.timestamp = elapsed();
+      lock.lock();
+      samples_.push_back(std::move(snap));
+    }
+  }
+
+  int interval_ms_;
+  bool running_ = false;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread sampler_;
+  std::chrono::steady_clock::time_point origin_;
+  SystemSnapshot before_;
+  SystemSnapshot after_;
+  std::vector<SystemSnapshot> samples_;
+};
+
+#endif // SYSTEM_STATE_H
@@ -0,0 +1,75 @@
+/**
+ * telemetry.h - Live shared-memory telemetry for running benchmarks
+ *
+ * A benchmark started with --telemetry=NAME publishes its per-thread
+ * counters in the POSIX shared-memory segment /NAME. The segment is a
+ * cxl_telemetry_header followed by num_threads cxl_telemetry_thread slots,
+ * one cache line each. Each slot has a single writer (its worker thread),
+ * which updates counters with relaxed stores; readers use relaxed loads and
+ * compute rates from successive samples. cxl_top is the reference reader.
+ */
+
+#ifndef CXL_TELEMETRY_H
+#define CXL_TELEMETRY_H
+
+#include <stdint.h>
+
+#define CXL_TELEMETRY_MAGIC 0x4d4c4554 /* "TELM" */
+#define CXL_TELEMETRY_VERSION 1
+
+enum cxl_telemetry_phase {
+  CXL_TELEMETRY_SETUP = 0,   /* allocating and starting threads */
+  CXL_TELEMETRY_RUNNING = 1, /* timed phase, start_ns is valid */
+  CXL_TELEMETRY_DONE = 2,    /* threads joined, counters are final */
+};
+
+enum cxl_telemetry_class {
+  CXL_TELEMETRY_READ = 0,
+  CXL_TELEMETRY_WRITE = 1,
+};
+
+struct cxl_telemetry_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_threads;
+  uint32_t phase;      /* enum cxl_telemetry_phase */
+  int32_t pid;
+  int32_t duration;    /* planned timed phase, seconds */
+  uint64_t start_ns;   /* CLOCK_MONOTONIC at RUNNING */
+  uint64_t buffer_size;
+  uint64_t block_size;
+  char benchmark[32];
+  uint8_t reserved[48]; /* pad to two cache lines */
+};
+
+struct cxl_telemetry_thread {
+  uint64_t bytes_processed;
+  uint64_t operations;
+  int32_t thread_id;
+  int32_t thread_class; /* enum cxl_telemetry_class */
+  int32_t numa_node;    /* node the thread is bound to, -1 = unbound */
+  int32_t tid;          /* kernel thread id, 0 until the thread starts */
+  uint64_t cpu_hash;    /* checksum of the optional CPU workload */
+  uint64_t reserved[3]; /* pad to one cache line */
+} __attribute__((aligned(64)));
+
+static inline uint64_t cxl_telemetry_size(uint32_t num_threads) {
+  return sizeof(struct cxl_telemetry_header) +
+         (uint64_t)num_threads * sizeof(struct cxl_telemetry_thread);
+}
+
+static inline struct cxl_telemetry_thread *
+cxl_telemetry_threads(struct cxl_telemetry_header *hdr) {
+  return (struct cxl_telemetry_thread *)(hdr + 1);
+}
+
+/* Single-writer counter update: a plain add published with a relaxed store */
+static inline void cxl_telemetry_add(uint64_t *counter, uint64_t value) {
+  __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t cxl_telemetry_read(const uint64_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+#endif /* CXL_TELEMETRY_H */
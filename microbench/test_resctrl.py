@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Check double_bandwidth's resctrl support against a fake resctrl tree"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+if not os.path.exists("./double_bandwidth"):
+    print("Building double_bandwidth...")
+    result = subprocess.run(["make", "double_bandwidth"], capture_output=True, text=True)
+    if result.returncode != 0:
+        print(f"Build failed: {result.stderr}")
+        sys.exit(1)
+
+
+def write(path, text):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def read(path):
+    with open(path) as f:
+        return f.read()
+
+
+with tempfile.TemporaryDirectory() as root:
+    # A pre-existing group laid out like the kernel's: two L3 domains with
+    # both CAT and MBA, and MBM counters per monitoring domain
+    group = os.path.join(root, "bench")
+    write(os.path.join(group, "schemata"), "    L3:0=7ff;1=7ff\n    MB:0=100;1=100\n")
+    write(os.path.join(group, "tasks"), "")
+    write(os.path.join(group, "mon_data/mon_L3_00/mbm_local_bytes"), "1048576\n")
+    write(os.path.join(group, "mon_data/mon_L3_00/mbm_total_bytes"), "2097152\n")
+    write(os.path.join(group, "mon_data/mon_L3_01/mbm_local_bytes"), "Unavailable\n")
+    write(os.path.join(group, "mon_data/mon_L3_01/mbm_total_bytes"), "4194304\n")
+
+    cmd = [
+        "./double_bandwidth", "-t", "2", "-d", "2", "-b", "16777216", "-n",
+        "--resctrl-root", root, "--resctrl-group", "bench",
+        "--l3-mask", "f", "--mba", "50",
+    ]
+    result = subprocess.run(cmd, capture_output=True, text=True, timeout=30)
+    print(result.stdout)
+    if result.stderr:
+        print(result.stderr)
+
+    schemata = read(os.path.join(group, "schemata"))
+    tasks = read(os.path.join(group, "tasks")).split()
+    checks = [
+        ("exit status", result.returncode == 0),
+        ("L3 mask written", "L3:0=f;1=f\n" in schemata),
+        ("MBA written", "MB:0=50;1=50\n" in schemata),
+        ("task assigned", len(tasks) == 1 and tasks[0].isdigit()),
+        ("MBM reported", "MBM total bandwidth (bench)" in result.stdout),
+        ("pre-existing group kept", os.path.isdir(group)),
+    ]
+
+failed = [name for name, ok in checks if not ok]
+for name, ok in checks:
+    print(f"{'PASS' if ok else 'FAIL'}: {name}")
+sys.exit(1 if failed else 0)
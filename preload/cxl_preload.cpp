@@ -0,0 +1,717 @@
+/**
+ * cxl_preload.cpp - LD_PRELOAD allocation interposer for CXL placement
+ *
+ * Intercepts malloc/calloc/realloc/free/mmap of an unmodified binary and
+ * places large allocations on a DRAM or CXL NUMA node with mbind(). Small
+ * allocations are forwarded straight to glibc, so they keep its per-thread
+ * tcache fast path and pay only one size comparison here.
+ *
+ * Placement is decided per request from (in order):
+ *   1. "site" rules in CXL_PRELOAD_RULES matching the call-site hash
+ *   2. "size" rules in CXL_PRELOAD_RULES matching the request size
+ *   3. CXL_PRELOAD_NODE
+ * Per-site byte counts are published in shared memory (cxl_preload.h).
+ *
+ * Nothing in this file may allocate through malloc: it runs inside malloc.
+ */
+
+#include "cxl_preload.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <bits/functexcept.h>
+#include <fcntl.h>
+#include <new>
+#include <numaif.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+// Defaults
+constexpr size_t DEFAULT_THRESHOLD = 1 * 1024 * 1024; // 1MB
+constexpr size_t PAGE_SIZE = 4096;
+constexpr size_t MAX_RULES = 256;
+constexpr size_t RULES_FILE_MAX = 64 * 1024;
+constexpr size_t TRACK_SLOTS = 1 << 16; // live large allocations tracked
+constexpr int MAX_NODES = 1024;
+
+namespace {
+
+enum class RuleKind { SITE, SIZE };
+
+struct Rule {
+  RuleKind kind = RuleKind::SIZE;
+  uint64_t site_hash = 0;
+  size_t min_size = 0;
+  size_t max_size = 0;
+  int node = -1;
+};
+
+struct PreloadConfig {
+  size_t threshold = DEFAULT_THRESHOLD;
+  int default_node = -1;
+  bool strict = false;
+  bool intercept_mmap = true;
+  bool verbose = false;
+  Rule rules[MAX_RULES] = {};
+  size_t num_rules = 0;
+};
+
+// One live large allocation made through the malloc family.
+struct TrackedAlloc {
+  uintptr_t addr; // 0 = empty
+  size_t length;  // mapped length (page multiple)
+  size_t size;    // requested size
+  uint32_t site;  // index into the site table
+};
+
+// Constant-initialized: malloc can run before any constructor does.
+PreloadConfig g_config;
+std::atomic<int> g_init_state{0}; // 0 = not started, 1 = running, 2 = done
+cxl_preload_shm *g_shm = nullptr;
+char g_shm_name[256];
+pid_t g_shm_owner = 0; // process that created the segment and unlinks it
+size_t (*g_libc_usable_size)(void *) = nullptr;
+
+TrackedAlloc g_track[TRACK_SLOTS];
+std::atomic_flag g_track_lock = ATOMIC_FLAG_INIT;
+
+// Raw syscalls: our own mappings must not recurse into the mmap hook.
+void *raw_mmap(void *addr, size_t length, int prot, int flags, int fd,
+               off_t offset) {
+  return reinterpret_cast<void *>(
+      syscall(SYS_mmap, addr, length, prot, flags, fd, offset));
+}
+
+int raw_munmap(void *addr, size_t length) {
+  return static_cast<int>(syscall(SYS_munmap, addr, length));
+}
+
+size_t round_up_page(size_t size) {
+  return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+uint64_t hash_mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// Parse "123", "64K", "1M", "2G" without touching the heap.
+bool parse_size(const char *str, size_t *out, const char **end) {
+  char *stop = nullptr;
+  unsigned long long value = strtoull(str, &stop, 0);
+  if (stop == str)
+    return false;
+  switch (*stop) {
+  case 'k':
+  case 'K':
+    value <<= 10;
+    stop++;
+    break;
+  case 'm':
+  case 'M':
+    value <<= 20;
+    stop++;
+    break;
+  case 'g':
+  case 'G':
+    value <<= 30;
+    stop++;
+    break;
+  default:
+    break;
+  }
+  *out = static_cast<size_t>(value);
+  if (end)
+    *end = stop;
+  return true;
+}
+
+const char *skip_spaces(const char *p) {
+  while (*p == ' ' || *p == '\t')
+    p++;
+  return p;
+}
+
+bool parse_node(const char *p, int *node) {
+  char *stop = nullptr;
+  long value = strtol(p, &stop, 10);
+  if (stop == p || value < -1 || value >= MAX_NODES)
+    return false;
+  *node = static_cast<int>(value);
+  return true;
+}
+
+// Rules file syntax, one rule per line ('#' starts a comment):
+//   site <hash> <node>        call-site hash as printed by cxl_preload_stat
+//   size <min> <max|*> <node> request sizes in [min, max)
+//   default <node>            same as CXL_PRELOAD_NODE
+void parse_rule_line(const char *line) {
+  line = skip_spaces(line);
+  if (*line == '#' || *line == '\0')
+    return;
+
+  Rule rule = {};
+  const char *p = nullptr;
+  if (strncmp(line, "site", 4) == 0) {
+    char *stop = nullptr;
+    rule.kind = RuleKind::SITE;
+    rule.site_hash = strtoull(skip_spaces(line + 4), &stop, 16);
+    if (!parse_node(skip_spaces(stop), &rule.node))
+      return;
+  } else if (strncmp(line, "size", 4) == 0) {
+    rule.kind = RuleKind::SIZE;
+    if (!parse_size(skip_spaces(line + 4), &rule.min_size, &p))
+      return;
+    p = skip_spaces(p);
+    if (*p == '*') {
+      rule.max_size = SIZE_MAX;
+      p++;
+    } else if (!parse_size(p, &rule.max_size, &p)) {
+      return;
+    }
+    if (!parse_node(skip_spaces(p), &rule.node))
+      return;
+  } else if (strncmp(line, "default", 7) == 0) {
+    parse_node(skip_spaces(line + 7), &g_config.default_node);
+    return;
+  } else {
+    return;
+  }
+
+  if (g_config.num_rules < MAX_RULES)
+    g_config.rules[g_config.num_rules++] = rule;
+}
+
+void load_rules(const char *path) {
+  static char buf[RULES_FILE_MAX + 1];
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  size_t len = 0;
+  ssize_t n;
+  while (len < RULES_FILE_MAX &&
+         (n = read(fd, buf + len, RULES_FILE_MAX - len)) > 0) {
+    len += static_cast<size_t>(n);
+  }
+  close(fd);
+  buf[len] = '\0';
+
+  char *line = buf;
+  while (line && *line) {
+    char *next = strchr(line, '\n');
+    if (next)
+      *next++ = '\0';
+    parse_rule_line(line);
+    line = next;
+  }
+}
+
+void setup_shared_stats() {
+  size_t bytes = cxl_preload_shm_size(CXL_PRELOAD_MAX_SITES);
+  const char *name = getenv("CXL_PRELOAD_SHM");
+  void *mem = MAP_FAILED;
+
+  if (name && *name) {
+    if (name[0] == '/')
+      snprintf(g_shm_name, sizeof(g_shm_name), "%s", name);
+    else
+      snprintf(g_shm_name, sizeof(g_shm_name), "/%s", name);
+    // %p in the name expands to the pid, so every exec'd process gets its
+    // own segment. A fork without exec keeps the parent's mapping and
+    // counts into the parent's segment.
+    char *pid_tok = strstr(g_shm_name, "%p");
+    if (pid_tok) {
+      char tail[sizeof(g_shm_name)];
+      snprintf(tail, sizeof(tail), "%s", pid_tok + 2);
+      snprintf(pid_tok, sizeof(g_shm_name) - (pid_tok - g_shm_name), "%d%s",
+               getpid(), tail);
+    }
+
+    int fd = shm_open(g_shm_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+        mem = raw_mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                       0);
+      close(fd);
+    }
+    if (mem == MAP_FAILED)
+      g_shm_name[0] = '\0';
+    else
+      g_shm_owner = getpid();
+  }
+
+  // Without a segment the counters still live in private memory so the
+  // verbose exit summary works.
+  if (mem == MAP_FAILED)
+    mem = raw_mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    return;
+
+  g_shm = static_cast<cxl_preload_shm *>(mem);
+  g_shm->version = CXL_PRELOAD_SHM_VERSION;
+  g_shm->max_sites = CXL_PRELOAD_MAX_SITES;
+  g_shm->pid = getpid();
+  g_shm->threshold = g_config.threshold;
+  g_shm->default_node = g_config.default_node;
+  g_shm->strict = g_config.strict ? 1 : 0;
+  __atomic_store_n(&g_shm->magic, CXL_PRELOAD_SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+void preload_init() {
+  int expected = 0;
+  if (!g_init_state.compare_exchange_strong(expected, 1))
+    return;
+
+  const char *env = getenv("CXL_PRELOAD_THRESHOLD");
+  if (env)
+    parse_size(env, &g_config.threshold, nullptr);
+  if (g_config.threshold < PAGE_SIZE)
+    g_config.threshold = PAGE_SIZE;
+
+  env = getenv("CXL_PRELOAD_NODE");
+  if (env)
+    parse_node(env, &g_config.default_node);
+
+  env = getenv("CXL_PRELOAD_STRICT");
+  g_config.strict = env && *env == '1';
+
+  env = getenv("CXL_PRELOAD_MMAP");
+  g_config.intercept_mmap = !(env && *env == '0');
+
+  env = getenv("CXL_PRELOAD_VERBOSE");
+  g_config.verbose = env && *env == '1';
+
+  env = getenv("CXL_PRELOAD_RULES");
+  if (env)
+    load_rules(env);
+
+  setup_shared_stats();
+
+  // dlsym may allocate; the init state makes those calls take the libc path
+  g_libc_usable_size = reinterpret_cast<size_t (*)(void *)>(
+      dlsym(RTLD_NEXT, "malloc_usable_size"));
+
+  g_init_state.store(2, std::memory_order_release);
+}
+
+inline bool preload_ready() {
+  int state = g_init_state.load(std::memory_order_acquire);
+  if (__builtin_expect(state == 2, 1))
+    return true;
+  if (state == 0)
+    preload_init();
+  return g_init_state.load(std::memory_order_acquire) == 2;
+}
+
+// Call-site hash that is stable across runs: ASLR moves the object, so hash
+// the object's basename together with the offset inside it.
+uint64_t callsite_hash(void *caller) {
+  Dl_info info;
+  uintptr_t addr = reinterpret_cast<uintptr_t>(caller);
+  if (dladdr(caller, &info) && info.dli_fname) {
+    const char *base = strrchr(info.dli_fname, '/');
+    base = base ? base + 1 : info.dli_fname;
+    uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+    for (const char *c = base; *c; c++)
+      h = (h ^ static_cast<unsigned char>(*c)) * 0x100000001b3ULL;
+    addr = (addr - reinterpret_cast<uintptr_t>(info.dli_fbase)) ^ h;
+  }
+  uint64_t hash = hash_mix(addr);
+  return hash ? hash : 1;
+}
+
+int pick_node(size_t size, uint64_t site_hash) {
+  const PreloadConfig &cfg = g_config;
+  for (size_t i = 0; i < cfg.num_rules; i++) {
+    const Rule &r = cfg.rules[i];
+    if (r.kind == RuleKind::SITE && r.site_hash == site_hash)
+      return r.node;
+  }
+  for (size_t i = 0; i < cfg.num_rules; i++) {
+    const Rule &r = cfg.rules[i];
+    if (r.kind == RuleKind::SIZE && size >= r.min_size && size < r.max_size)
+      return r.node;
+  }
+  return cfg.default_node;
+}
+
+// Find or claim the stats slot of a call site.
+uint32_t site_slot(uint64_t site_hash, int node, bool from_mmap) {
+  if (!g_shm)
+    return UINT32_MAX;
+  uint32_t mask = CXL_PRELOAD_MAX_SITES - 1;
+  uint32_t idx = static_cast<uint32_t>(site_hash) & mask;
+  for (uint32_t probe = 0; probe < CXL_PRELOAD_MAX_SITES; probe++) {
+    cxl_preload_site *s = &g_shm->sites[idx];
+    uint64_t cur = __atomic_load_n(&s->site_hash, __ATOMIC_ACQUIRE);
+    if (cur == site_hash)
+      return idx;
+    if (cur == 0) {
+      uint64_t empty = 0;
+      if (__atomic_compare_exchange_n(&s->site_hash, &empty, site_hash, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        s->node = node;
+        s->from_mmap = from_mmap ? 1 : 0;
+        return idx;
+      }
+      if (empty == site_hash)
+        return idx;
+    }
+    idx = (idx + 1) & mask;
+  }
+  return UINT32_MAX;
+}
+
+void account_alloc(uint32_t slot, size_t size, bool live) {
+  if (slot == UINT32_MAX)
+    return;
+  cxl_preload_site *s = &g_shm->sites[slot];
+  __atomic_fetch_add(&s->alloc_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&s->bytes_allocated, size, __ATOMIC_RELAXED);
+  if (live)
+    __atomic_fetch_add(&s->bytes_live, size, __ATOMIC_RELAXED);
+}
+
+void account_free(uint32_t slot, size_t size) {
+  if (slot == UINT32_MAX)
+    return;
+  cxl_preload_site *s = &g_shm->sites[slot];
+  __atomic_fetch_add(&s->free_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_sub(&s->bytes_live, size, __ATOMIC_RELAXED);
+}
+
+void account_resize(uint32_t slot, size_t old_size, size_t new_size) {
+  if (slot == UINT32_MAX)
+    return;
+  cxl_preload_site *s = &g_shm->sites[slot];
+  if (new_size > old_size) {
+    __atomic_fetch_add(&s->bytes_allocated, new_size - old_size,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->bytes_live, new_size - old_size, __ATOMIC_RELAXED);
+  } else {
+    __atomic_fetch_sub(&s->bytes_live, old_size - new_size, __ATOMIC_RELAXED);
+  }
+}
+
+void bind_range(void *addr, size_t length, int node) {
+  if (node < 0)
+    return;
+  unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+  mask[node / (8 * sizeof(unsigned long))] |=
+      1UL << (node % (8 * sizeof(unsigned long)));
+  int mode = g_config.strict ? MPOL_BIND : MPOL_PREFERRED;
+  if (mbind(addr, length, mode, mask, MAX_NODES, 0) != 0 && g_shm)
+    __atomic_fetch_add(&g_shm->mbind_failures, 1, __ATOMIC_RELAXED);
+}
+
+// Tracking table of live large allocations (open addressing, guarded by a
+// spinlock; only large requests ever get here).
+struct TrackGuard {
+  TrackGuard() {
+    while (g_track_lock.test_and_set(std::memory_order_acquire)) {
+#if defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+    }
+  }
+  ~TrackGuard() { g_track_lock.clear(std::memory_order_release); }
+};
+
+size_t track_index(uintptr_t addr) {
+  return static_cast<size_t>(hash_mix(addr)) & (TRACK_SLOTS - 1);
+}
+
+bool track_insert(const TrackedAlloc &entry) {
+  TrackGuard guard;
+  size_t idx = track_index(entry.addr);
+  for (size_t probe = 0; probe < TRACK_SLOTS; probe++) {
+    if (g_track[idx].addr == 0) {
+      g_track[idx] = entry;
+      return true;
+    }
+    idx = (idx + 1) & (TRACK_SLOTS - 1);
+  }
+  return false;
+}
+
+bool track_lookup(uintptr_t addr, TrackedAlloc *out) {
+  TrackGuard guard;
+  size_t idx = track_index(addr);
+  while (g_track[idx].addr != 0) {
+    if (g_track[idx].addr == addr) {
+      *out = g_track[idx];
+      return true;
+    }
+    idx = (idx + 1) & (TRACK_SLOTS - 1);
+  }
+  return false;
+}
+
+// Remove an entry and backward-shift the probe chain (no tombstones).
+bool track_remove(uintptr_t addr, TrackedAlloc *out) {
+  TrackGuard guard;
+  size_t idx = track_index(addr);
+  while (g_track[idx].addr != addr) {
+    if (g_track[idx].addr == 0)
+      return false;
+    idx = (idx + 1) & (TRACK_SLOTS - 1);
+  }
+  *out = g_track[idx];
+  g_track[idx].addr = 0;
+
+  size_t hole = idx;
+  size_t next = (idx + 1) & (TRACK_SLOTS - 1);
+  while (g_track[next].addr != 0) {
+    size_t home = track_index(g_track[next].addr);
+    // Move the entry into the hole unless its home lies in (hole, next]
+    bool stays = (hole <= next) ? (home > hole && home <= next)
+                                : (home > hole || home <= next);
+    if (!stays) {
+      g_track[hole] = g_track[next];
+      g_track[next].addr = 0;
+      hole = next;
+    }
+    next = (next + 1) & (TRACK_SLOTS - 1);
+  }
+  return true;
+}
+
+// Page-aligned pointers are the only candidates for tracked allocations, so
+// every other free() skips the table entirely.
+inline bool maybe_tracked(void *ptr) {
+  return (reinterpret_cast<uintptr_t>(ptr) & (PAGE_SIZE - 1)) == 0;
+}
+
+void *large_alloc(size_t size, void *caller) {
+  uint64_t site = callsite_hash(caller);
+  int node = pick_node(size, site);
+  size_t length = round_up_page(size);
+
+  void *ptr = raw_mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return nullptr;
+  bind_range(ptr, length, node);
+
+  TrackedAlloc entry = {reinterpret_cast<uintptr_t>(ptr), length, size,
+                        site_slot(site, node, false)};
+  if (!track_insert(entry)) {
+    raw_munmap(ptr, length);
+    if (g_shm)
+      __atomic_fetch_add(&g_shm->table_full, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+  }
+
+  if (g_shm)
+    __atomic_fetch_add(&g_shm->large_allocs, 1, __ATOMIC_RELAXED);
+  account_alloc(entry.site, size, true);
+  return ptr;
+}
+
+bool large_free(void *ptr) {
+  TrackedAlloc entry;
+  if (!track_remove(reinterpret_cast<uintptr_t>(ptr), &entry))
+    return false;
+  account_free(entry.site, entry.size);
+  raw_munmap(ptr, entry.length);
+  return true;
+}
+
+size_t libc_usable_size(void *ptr) {
+  return g_libc_usable_size ? g_libc_usable_size(ptr) : 0;
+}
+
+void print_summary() {
+  if (!g_shm)
+    return;
+  fprintf(stderr,
+          "[cxl_preload] pid %d: %lu large allocations, %lu mbind failures, "
+          "threshold %lu bytes%s%s\n",
+          g_shm->pid, (unsigned long)g_shm->large_allocs,
+          (unsigned long)g_shm->mbind_failures,
+          (unsigned long)g_shm->threshold, g_shm_name[0] ? ", shm " : "",
+          g_shm_name);
+  for (uint32_t i = 0; i < g_shm->max_sites; i++) {
+    const cxl_preload_site &s = g_shm->sites[i];
+    if (s.site_hash == 0)
+      continue;
+    fprintf(stderr,
+            "[cxl_preload]   site %016lx node %3d %s allocs %8lu "
+            "bytes %12lu live %12lu\n",
+            (unsigned long)s.site_hash, s.node, s.from_mmap ? "mmap  " : "malloc",
+            (unsigned long)s.alloc_count, (unsigned long)s.bytes_allocated,
+            (unsigned long)s.bytes_live);
+  }
+}
+
+__attribute__((constructor)) void preload_constructor() { preload_ready(); }
+
+__attribute__((destructor)) void preload_destructor() {
+  if (g_config.verbose)
+    print_summary();
+  // Forked children run this destructor too; only the creator unlinks
+  if (g_shm_name[0] && getpid() == g_shm_owner)
+    shm_unlink(g_shm_name);
+}
+
+// Allocation loop of operator new: retries through the new_handler like
+// libstdc++'s, and returns nullptr once there is none
+void *cxx_new(size_t size, void *caller) {
+  if (size == 0)
+    size = 1;
+  for (;;) {
+    void *ptr = (size >= g_config.threshold && preload_ready())
+                    ? large_alloc(size, caller)
+                    : __libc_malloc(size);
+    if (ptr)
+      return ptr;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      return nullptr;
+    handler();
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+void *malloc(size_t size) {
+  if (__builtin_expect(size < g_config.threshold, 1) || !preload_ready())
+    return __libc_malloc(size);
+  return large_alloc(size, __builtin_return_address(0));
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  size_t total;
+  if (__builtin_mul_overflow(nmemb, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  if (__builtin_expect(total < g_config.threshold, 1) || !preload_ready())
+    return __libc_calloc(nmemb, size);
+  // Fresh anonymous mappings are already zero-filled
+  return large_alloc(total, __builtin_return_address(0));
+}
+
+void free(void *ptr) {
+  if (!ptr)
+    return;
+  if (__builtin_expect(!maybe_tracked(ptr), 1) || !large_free(ptr))
+    __libc_free(ptr);
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (!ptr)
+    return malloc(size);
+  if (size == 0) {
+    free(ptr);
+    return nullptr;
+  }
+
+  TrackedAlloc entry;
+  if (maybe_tracked(ptr) &&
+      track_lookup(reinterpret_cast<uintptr_t>(ptr), &entry)) {
+    if (size >= g_config.threshold) {
+      size_t length = round_up_page(size);
+      // mremap keeps the VMA's memory policy, so grown pages stay placed
+      void *moved = (length == entry.length)
+                        ? ptr
+                        : mremap(ptr, entry.length, length, MREMAP_MAYMOVE);
+      if (moved == MAP_FAILED)
+        return nullptr;
+      TrackedAlloc old;
+      track_remove(entry.addr, &old);
+      account_resize(entry.site, entry.size, size);
+      entry.addr = reinterpret_cast<uintptr_t>(moved);
+      entry.length = length;
+      entry.size = size;
+      track_insert(entry);
+      return moved;
+    }
+    // Shrinking below the threshold moves the block back to libc
+    void *small = __libc_malloc(size);
+    if (!small)
+      return nullptr;
+    memcpy(small, ptr, size);
+    large_free(ptr);
+    return small;
+  }
+
+  if (size < g_config.threshold || !preload_ready())
+    return __libc_realloc(ptr, size);
+
+  // A libc block grows past the threshold: move it to a placed mapping
+  void *large = large_alloc(size, __builtin_return_address(0));
+  if (!large)
+    return nullptr;
+  size_t old_size = libc_usable_size(ptr);
+  memcpy(large, ptr, old_size < size ? old_size : size);
+  __libc_free(ptr);
+  return large;
+}
+
+size_t malloc_usable_size(void *ptr) {
+  TrackedAlloc entry;
+  if (ptr && maybe_tracked(ptr) &&
+      track_lookup(reinterpret_cast<uintptr_t>(ptr), &entry))
+    return entry.length;
+  return libc_usable_size(ptr);
+}
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd,
+           off_t offset) {
+  void *ptr = raw_mmap(addr, length, prot, flags, fd, offset);
+  if (ptr == MAP_FAILED || !(flags & MAP_ANONYMOUS) ||
+      length < g_config.threshold || !g_config.intercept_mmap ||
+      !preload_ready())
+    return ptr;
+
+  uint64_t site = callsite_hash(__builtin_return_address(0));
+  int node = pick_node(length, site);
+  bind_range(ptr, length, node);
+  account_alloc(site_slot(site, node, true), length, false);
+  return ptr;
+}
+
+void *mmap64(void *addr, size_t length, int prot, int flags, int fd,
+             off_t offset) __attribute__((alias("mmap")));
+
+} // extern "C"
+
+// libstdc++'s operator new calls malloc() itself, which would attribute every
+// C++ allocation to one site inside libstdc++. Serving new here records the
+// caller of new instead. The nothrow and aligned forms are left to libstdc++
+// (nothrow new reaches this operator new; aligned new uses aligned_alloc).
+void *operator new(size_t size) {
+  void *ptr = cxx_new(size, __builtin_return_address(0));
+  if (!ptr)
+    std::__throw_bad_alloc();
+  return ptr;
+}
+
+void *operator new[](size_t size) {
+  void *ptr = cxx_new(size, __builtin_return_address(0));
+  if (!ptr)
+    std::__throw_bad_alloc();
+  return ptr;
+}
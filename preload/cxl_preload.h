@@ -0,0 +1,53 @@
+/**
+ * cxl_preload.h - Shared-memory layout exported by libcxl_preload.so
+ *
+ * The interposer publishes one record per allocation call site in a POSIX
+ * shared-memory segment (see CXL_PRELOAD_SHM in README.md). Readers map the
+ * segment read-only and may read the counters at any time; all counters are
+ * updated with relaxed atomic adds, so a reader sees monotonically growing
+ * values but no cross-field snapshot consistency.
+ *
+ * The header is plain C so it can be used from C, C++ and Python (ctypes).
+ */
+
+#ifndef CXL_PRELOAD_H
+#define CXL_PRELOAD_H
+
+#include <stdint.h>
+
+#define CXL_PRELOAD_SHM_MAGIC 0x504c5843u /* "CXLP" */
+#define CXL_PRELOAD_SHM_VERSION 1
+#define CXL_PRELOAD_MAX_SITES 4096
+
+/* Per call-site counters. A slot is in use once site_hash != 0. */
+struct cxl_preload_site {
+  uint64_t site_hash;       // hash of (object basename, offset in object)
+  int32_t node;             // node the site is placed on (-1 = default policy)
+  uint32_t from_mmap;       // 1 if the site was seen through mmap()
+  uint64_t alloc_count;     // large allocations made by this site
+  uint64_t free_count;      // large allocations released by this site
+  uint64_t bytes_allocated; // cumulative bytes handed out
+  uint64_t bytes_live;      // bytes currently allocated (malloc family only)
+};
+
+/* Segment header, followed by max_sites cxl_preload_site records. */
+struct cxl_preload_shm {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t max_sites;
+  int32_t pid;              // process that owns the segment
+  uint64_t threshold;       // bytes; smaller requests stay on the libc path
+  int32_t default_node;     // CXL_PRELOAD_NODE (-1 = none)
+  uint32_t strict;          // 1 = MPOL_BIND, 0 = MPOL_PREFERRED
+  uint64_t large_allocs;    // total large allocations placed
+  uint64_t mbind_failures;  // mbind() calls that returned an error
+  uint64_t table_full;      // large requests served by libc (tracking full)
+  struct cxl_preload_site sites[];
+};
+
+static inline uint64_t cxl_preload_shm_size(uint32_t max_sites) {
+  return sizeof(struct cxl_preload_shm) +
+         (uint64_t)max_sites * sizeof(struct cxl_preload_site);
+}
+
+#endif // CXL_PRELOAD_H
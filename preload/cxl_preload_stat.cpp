@@ -0,0 +1,157 @@
+/**
+ * cxl_preload_stat.cpp - Dump per-site placement counters of libcxl_preload
+ *
+ * Attaches read-only to the shared-memory segment published by a process
+ * running under libcxl_preload.so and prints one line per call site.
+ */
+
+#include "cxl_preload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct StatConfig {
+  std::string shm_name;
+  int interval = 0; // seconds, 0 = print once
+  size_t top = 0;   // 0 = all sites
+};
+
+void print_usage(const char *prog_name) {
+  std::cerr
+      << "Usage: " << prog_name << " [OPTIONS] SHM_NAME\n"
+      << "Options:\n"
+      << "  -i, --interval=SECONDS    Refresh every SECONDS (default: once)\n"
+      << "  -n, --top=NUM             Only show the NUM largest sites\n"
+      << "  -h, --help                Show this help message\n";
+}
+
+StatConfig parse_args(int argc, char *argv[]) {
+  StatConfig config;
+
+  static struct option long_options[] = {{"interval", required_argument, 0, 'i'},
+                                         {"top", required_argument, 0, 'n'},
+                                         {"help", no_argument, 0, 'h'},
+                                         {0, 0, 0, 0}};
+
+  int opt, option_index = 0;
+  while ((opt = getopt_long(argc, argv, "i:n:h", long_options,
+                            &option_index)) != -1) {
+    switch (opt) {
+    case 'i':
+      config.interval = std::stoi(optarg);
+      break;
+    case 'n':
+      config.top = std::stoull(optarg);
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      exit(0);
+    default:
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (optind >= argc) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  config.shm_name = argv[optind];
+  if (config.shm_name[0] != '/')
+    config.shm_name = "/" + config.shm_name;
+  return config;
+}
+
+void print_sites(const cxl_preload_shm *shm, size_t top) {
+  std::vector<cxl_preload_site> sites;
+  for (uint32_t i = 0; i < shm->max_sites; i++) {
+    if (shm->sites[i].site_hash != 0)
+      sites.push_back(shm->sites[i]);
+  }
+  std::sort(sites.begin(), sites.end(),
+            [](const cxl_preload_site &a, const cxl_preload_site &b) {
+              return a.bytes_allocated > b.bytes_allocated;
+            });
+  if (top > 0 && sites.size() > top)
+    sites.resize(top);
+
+  std::cout << "pid " << shm->pid << ", threshold " << shm->threshold
+            << " bytes, default node " << shm->default_node
+            << (shm->strict ? " (strict)" : " (preferred)") << "\n"
+            << "large allocations: " << shm->large_allocs
+            << ", mbind failures: " << shm->mbind_failures
+            << ", untracked (table full): " << shm->table_full << "\n";
+  std::cout << std::left << std::setw(18) << "site" << std::right
+            << std::setw(6) << "node" << std::setw(8) << "source"
+            << std::setw(12) << "allocs" << std::setw(12) << "frees"
+            << std::setw(16) << "bytes" << std::setw(16) << "live" << "\n";
+  for (const auto &s : sites) {
+    std::cout << std::hex << std::setfill('0') << std::setw(16) << s.site_hash
+              << std::dec << std::setfill(' ') << "  " << std::setw(6)
+              << s.node << std::setw(8) << (s.from_mmap ? "mmap" : "malloc")
+              << std::setw(12) << s.alloc_count << std::setw(12)
+              << s.free_count << std::setw(16) << s.bytes_allocated
+              << std::setw(16) << s.bytes_live << "\n";
+  }
+  std::cout << std::flush;
+}
+
+int main(int argc, char *argv[]) {
+  StatConfig config = parse_args(argc, argv);
+
+  int fd = shm_open(config.shm_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    std::cerr << "Failed to open shared memory " << config.shm_name << ": "
+              << strerror(errno) << std::endl;
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(cxl_preload_shm)) {
+    std::cerr << "Shared memory " << config.shm_name << " is too small"
+              << std::endl;
+    close(fd);
+    return 1;
+  }
+
+  void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Failed to map shared memory: " << strerror(errno)
+              << std::endl;
+    return 1;
+  }
+
+  const auto *shm = static_cast<const cxl_preload_shm *>(mem);
+  if (shm->magic != CXL_PRELOAD_SHM_MAGIC ||
+      shm->version != CXL_PRELOAD_SHM_VERSION ||
+      cxl_preload_shm_size(shm->max_sites) >
+          static_cast<uint64_t>(st.st_size)) {
+    std::cerr << "Unrecognized segment layout in " << config.shm_name
+              << std::endl;
+    munmap(mem, st.st_size);
+    return 1;
+  }
+
+  do {
+    print_sites(shm, config.top);
+    if (config.interval > 0) {
+      std::this_thread::sleep_for(std::chrono::seconds(config.interval));
+      std::cout << "\n";
+    }
+  } while (config.interval > 0);
+
+  munmap(mem, st.st_size);
+  return 0;
+}
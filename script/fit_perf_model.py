@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+"""
+CXL Bandwidth/Latency Model Fitter
+
+Fits a compact per-host performance model from benchmark results and writes
+it as the table cxl_bandwidth_scheduler loads with -m (layout in
+ebpf/perf_model.h). cxl_pmu.bpf.c compares each node's measured LLC-miss
+traffic against the fitted latency curve and keeps memory-heavy tasks off
+nodes that are already as slow as far memory.
+
+Inputs, in any mix:
+- double_bandwidth / cxl_memory_test JSON results (-j): one bandwidth point
+  (threads, read ratio, total MB/s) each. The pair is taken from the
+  config's numa_node, or from --pair.
+- `cxl_memory_test -m interference` JSON results, or its saved output: a
+  bandwidth point for every aggressor row, plus idle and loaded victim
+  latency for each (CPU node, memory node) pair.
+
+For each (CPU node, memory node) pair the model holds:
+- bandwidth vs threads at read ratios 0/25/50/75/100%, piecewise-linear
+  between up to 8 thread counts. Ratios that were not measured are
+  interpolated from their measured neighbours.
+- latency vs load (percent of the pair's peak bandwidth) at fixed
+  breakpoints.
+The far-memory latency threshold is placed in the widest gap between the
+measured idle latencies of the pairs.
+
+Usage:
+    fit_perf_model.py results/*.json matrix.txt -o perf_model.tbl
+"""
+
+import argparse
+import json
+import math
+import re
+import sys
+from collections import defaultdict
+from typing import Dict, List, Optional, Tuple
+
+# Must match ebpf/perf_model.h
+MODEL_VERSION = 1
+MAX_NODES = 8
+THREAD_POINTS = 8
+RATIOS = [0.0, 0.25, 0.5, 0.75, 1.0]
+LOAD_PCT = [0, 25, 50, 70, 80, 90, 95, 100]
+
+# Smallest ratio between neighbouring idle latencies that separates near
+# from far memory
+MIN_LATENCY_GAP = 1.2
+
+Pair = Tuple[int, int]
+
+
+class Measurements:
+    """Raw points collected from all inputs, per (CPU node, memory node)."""
+
+    def __init__(self):
+        self.bandwidth: Dict[Pair, List[Tuple[int, float, float]]] = defaultdict(list)
+        self.latency: Dict[Pair, List[Tuple[float, float]]] = defaultdict(list)  # (load MB/s, ns)
+        self.idle_latency: Dict[Pair, List[float]] = defaultdict(list)
+
+    def pairs(self) -> List[Pair]:
+        return sorted(set(self.bandwidth) | set(self.idle_latency))
+
+
+def parse_pair(text: str) -> Pair:
+    cpu, _, mem = text.partition(":")
+    return int(cpu), int(mem if mem else cpu)
+
+
+def load_interference_rows(path: str, config: Dict, rows: List[Dict], m: Measurements) -> bool:
+    """Aggressor bandwidth and victim latency from interference JSON rows."""
+    ratio = float(config.get("read_ratio", 0.5))
+    used = 0
+    for row in rows:
+        key = row.get("key", {})
+        if "victim_cpu_node" not in key or "victim_latency_ns" not in row:
+            continue
+        victim = (int(key["victim_cpu_node"]), int(key["victim_mem_node"]))
+        used += 1
+        if not key.get("threads"):
+            m.idle_latency[victim].append(float(row["victim_latency_ns"]))
+            continue
+        aggr = (int(key["aggressor_cpu_node"]), int(key["aggressor_mem_node"]))
+        aggr_mbps = float(row.get("aggressor_bandwidth_mbps", 0))
+        m.bandwidth[aggr].append((int(key["threads"]), ratio, aggr_mbps))
+        if aggr[1] == victim[1]:
+            m.latency[victim].append((aggr_mbps, float(row["victim_latency_ns"])))
+    if not used:
+        print(f"Skipping {path}: no interference rows")
+    return used > 0
+
+
+def load_json_result(path: str, data: Dict, pair: Optional[Pair], m: Measurements) -> bool:
+    config, results = data.get("config", {}), data.get("results")
+    if isinstance(results, list) and config.get("mode") == "interference":
+        return load_interference_rows(path, config, results, m)
+    if not isinstance(results, dict) or "total_bandwidth_mbps" not in results:
+        print(f"Skipping {path}: no bandwidth results")
+        return False
+    if pair is None:
+        node = max(int(config.get("numa_node", 0)), 0)
+        pair = (node, node)
+    threads = int(config.get("num_threads", 1))
+    ratio = float(config.get("read_ratio", 0.5))
+    m.bandwidth[pair].append((threads, ratio, float(results["total_bandwidth_mbps"])))
+    return True
+
+
+INTERFERENCE_HEADER = re.compile(r"read ratio ([0-9.]+)")
+INTERFERENCE_SECTION = re.compile(r"=== Interference: victim CPU \d+ \(node (\d+)\), memory node (\d+) ===")
+INTERFERENCE_IDLE = re.compile(r"Idle: ([0-9.]+) ns")
+INTERFERENCE_ROW = re.compile(r"^C(\d+)->M(\d+)\s+(\d+)\s+([0-9.]+)\s+([0-9.]+)")
+
+
+def load_interference_output(path: str, text: str, m: Measurements) -> bool:
+    """Aggressor bandwidth and victim latency from an interference run."""
+    ratio = 0.5
+    victim: Optional[Pair] = None
+    idle_ns = 0.0
+    rows = 0
+    seen_aggressors = set()
+    for line in text.splitlines():
+        line = line.strip()
+        header = INTERFERENCE_HEADER.search(line)
+        if header and "Victim working set" in line:
+            ratio = float(header.group(1))
+            continue
+        section = INTERFERENCE_SECTION.search(line)
+        if section:
+            victim = (int(section.group(1)), int(section.group(2)))
+            continue
+        idle = INTERFERENCE_IDLE.search(line)
+        if idle and victim:
+            idle_ns = float(idle.group(1))
+            m.idle_latency[victim].append(idle_ns)
+            continue
+        row = INTERFERENCE_ROW.match(line)
+        if not row or not victim:
+            continue
+        aggr = (int(row.group(1)), int(row.group(2)))
+        threads, aggr_mbps, victim_ns = int(row.group(3)), float(row.group(4)), float(row.group(5))
+        rows += 1
+        # The same aggressor cells are re-run for every victim; keep each once
+        # per victim section so repeated runs still average
+        key = (victim, aggr, threads)
+        if key not in seen_aggressors:
+            seen_aggressors.add(key)
+            m.bandwidth[aggr].append((threads, ratio, aggr_mbps))
+        # Victim latency only depends on load on its own memory node
+        if aggr[1] == victim[1]:
+            m.latency[victim].append((aggr_mbps, victim_ns))
+    if not rows:
+        print(f"Skipping {path}: neither a JSON result nor interference output")
+    return rows > 0
+
+
+def interpolate(points: List[Tuple[float, float]], x: float) -> float:
+    """Piecewise-linear through sorted (x, y) points, flat outside them."""
+    if x <= points[0][0]:
+        return points[0][1]
+    for (x0, y0), (x1, y1) in zip(points, points[1:]):
+        if x <= x1:
+            return y0 + (y1 - y0) * (x - x0) / (x1 - x0) if x1 > x0 else y1
+    return points[-1][1]
+
+
+def averaged(points: List[Tuple[float, float]]) -> List[Tuple[float, float]]:
+    """Sorted points with repeated x values replaced by their mean y."""
+    groups: Dict[float, List[float]] = defaultdict(list)
+    for x, y in points:
+        groups[x].append(y)
+    return sorted((x, sum(ys) / len(ys)) for x, ys in groups.items())
+
+
+def thread_breakpoints(counts: List[int]) -> List[int]:
+    """At most THREAD_POINTS measured counts, log-spaced, ends included."""
+    counts = sorted(set(counts))
+    if len(counts) <= THREAD_POINTS:
+        return counts
+    lo, hi = math.log(counts[0]), math.log(counts[-1])
+    chosen = []
+    for i in range(THREAD_POINTS):
+        target = math.exp(lo + (hi - lo) * i / (THREAD_POINTS - 1))
+        best = min((c for c in counts if c not in chosen), key=lambda c: abs(c - target))
+        chosen.append(best)
+    return sorted(chosen)
+
+
+def fit_bandwidth(points: List[Tuple[int, float, float]]) -> Tuple[List[int], List[List[float]]]:
+    """(thread breakpoints, bandwidth[ratio][thread]) from raw points."""
+    threads = thread_breakpoints([t for t, _, _ in points])
+    by_ratio: Dict[float, List[Tuple[float, float]]] = defaultdict(list)
+    for t, ratio, mbps in points:
+        by_ratio[round(ratio, 3)].append((t, mbps))
+    measured = sorted(by_ratio)
+    curves = {r: averaged(by_ratio[r]) for r in measured}
+
+    def at(ratio: float, t: int) -> float:
+        values = [(r, interpolate(curves[r], t)) for r in measured]
+        return interpolate(values, ratio)
+
+    return threads, [[at(ratio, t) for t in threads] for ratio in RATIOS]
+
+
+def fit_latency(points: List[Tuple[float, float]], idle_ns: float,
+                peak_mbps: float) -> List[float]:
+    """Latency at LOAD_PCT of peak; zeros without latency data."""
+    if not idle_ns and not points:
+        return [0.0] * len(LOAD_PCT)
+    curve = [(0.0, idle_ns)] if idle_ns else []
+    if peak_mbps > 0:
+        curve += [(100.0 * load / peak_mbps, ns) for load, ns in points]
+    curve = averaged(curve)
+    return [interpolate(curve, pct) for pct in LOAD_PCT]
+
+
+def latency_threshold(idle: Dict[Pair, float]) -> int:
+    """Midpoint of the widest gap between idle latencies, 0 if none stands out."""
+    values = sorted(v for v in idle.values() if v > 0)
+    best_ratio, threshold = MIN_LATENCY_GAP, 0
+    for lo, hi in zip(values, values[1:]):
+        if hi / lo >= best_ratio:
+            best_ratio, threshold = hi / lo, int((lo + hi) / 2)
+    return threshold
+
+
+class PerfModel:
+    def __init__(self, m: Measurements, homes: Dict[int, int]):
+        self.entries = {}
+        idle = {}
+        for pair in m.pairs():
+            if pair[0] >= MAX_NODES or pair[1] >= MAX_NODES:
+                print(f"Skipping node pair {pair}: model holds nodes below {MAX_NODES}")
+                continue
+            threads, bw = ([], [])
+            if m.bandwidth[pair]:
+                threads, bw = fit_bandwidth(m.bandwidth[pair])
+            peak = max((max(row) for row in bw), default=0.0)
+            if m.latency[pair]:
+                peak = max(peak, max(load for load, _ in m.latency[pair]))
+            idle_ns = (sum(m.idle_latency[pair]) / len(m.idle_latency[pair])
+                       if m.idle_latency[pair] else 0.0)
+            idle[pair] = idle_ns
+            self.entries[pair] = {
+                "threads": threads,
+                "bw": bw,
+                "peak": peak,
+                "idle": idle_ns,
+                "lat": fit_latency(m.latency[pair], idle_ns, peak),
+            }
+        self.cxl_latency_ns = latency_threshold(idle)
+        self.homes = self._homes(homes)
+
+    def _homes(self, overrides: Dict[int, int]) -> Dict[int, int]:
+        """Memory node each CPU node's tasks use: local if measured, else the
+        pair with the highest peak bandwidth."""
+        homes = {}
+        for cpu in sorted({cpu for cpu, _ in self.entries}):
+            if (cpu, cpu) in self.entries and self.entries[(cpu, cpu)]["threads"]:
+                homes[cpu] = cpu
+            else:
+                candidates = [(e["peak"], mem) for (c, mem), e in self.entries.items() if c == cpu]
+                homes[cpu] = max(candidates)[1]
+        homes.update(overrides)
+        return homes
+
+    def write_table(self, path: str, sources: List[str]):
+        with open(path, "w") as f:
+            f.write("# CXL bandwidth/latency model, see ebpf/perf_model.h\n")
+            f.write(f"# Fitted from: {' '.join(sources)}\n")
+            f.write(f"cxl_perf_model {MODEL_VERSION}\n")
+            f.write(f"cxl_latency_ns {self.cxl_latency_ns}\n")
+            for cpu, mem in sorted(self.homes.items()):
+                f.write(f"home {cpu} {mem}\n")
+            for (cpu, mem), e in sorted(self.entries.items()):
+                f.write(f"pair {cpu} {mem} {len(e['threads'])} {round(e['peak'])} "
+                        f"{round(e['idle'])}\n")
+                if e["threads"]:
+                    f.write("threads " + " ".join(str(t) for t in e["threads"]) + "\n")
+                    for i, row in enumerate(e["bw"]):
+                        f.write(f"bw {i} " + " ".join(str(round(v)) for v in row) + "\n")
+                f.write("lat " + " ".join(str(round(v)) for v in e["lat"]) + "\n")
+
+    def print_summary(self):
+        print(f"Far-memory latency threshold: "
+              f"{self.cxl_latency_ns or 'not separable'}{' ns' if self.cxl_latency_ns else ''}")
+        for (cpu, mem), e in sorted(self.entries.items()):
+            home = " (home)" if self.homes.get(cpu) == mem else ""
+            print(f"\nCPU node {cpu} -> memory node {mem}{home}: peak {e['peak']:.0f} MB/s, "
+                  f"idle latency {e['idle']:.0f} ns")
+            if e["threads"]:
+                print("  read%  " + "".join(f"{t:>9}" for t in e["threads"]))
+                for ratio, row in zip(RATIOS, e["bw"]):
+                    print(f"  {ratio * 100:>5.0f}  " + "".join(f"{v:>9.0f}" for v in row))
+            if any(e["lat"]):
+                print("  load%  " + "".join(f"{p:>7}" for p in LOAD_PCT))
+                print("  ns     " + "".join(f"{v:>7.0f}" for v in e["lat"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Fit a per-host bandwidth/latency model for the CXL scheduler",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  # Thread and read-ratio sweep on node 0, plus the interference matrix
+  for t in 1 2 4 8 16; do for r in 0 0.5 1; do
+    ./double_bandwidth --numa-node=0 -t $t -r $r -d 10 -j bw_t${t}_r${r}.json; done; done
+  ./cxl_memory_test -m interference -c 0,2 -t 8 -j matrix.json
+  %(prog)s bw_*.json matrix.json -o perf_model.tbl
+
+  sudo ./cxl_bandwidth_scheduler cxl_pmu.bpf.o -m perf_model.tbl
+        """)
+    parser.add_argument("inputs", nargs="+",
+                        help="JSON results (-j) and/or saved interference output")
+    parser.add_argument("-o", "--output", default="perf_model.tbl",
+                        help="Model table for cxl_bandwidth_scheduler -m (default: perf_model.tbl)")
+    parser.add_argument("--pair", type=parse_pair, default=None, metavar="CPU:MEM",
+                        help="Node pair of the JSON results (default: their numa_node, local memory)")
+    parser.add_argument("--home", type=parse_pair, action="append", default=[], metavar="CPU:MEM",
+                        help="Memory node the scheduler assumes for tasks on CPU node (repeatable)")
+    args = parser.parse_args()
+
+    m = Measurements()
+    used = []
+    for path in args.inputs:
+        try:
+            with open(path) as f:
+                text = f.read()
+        except OSError as e:
+            print(f"Skipping {path}: {e}")
+            continue
+        try:
+            ok = load_json_result(path, json.loads(text), args.pair, m)
+        except json.JSONDecodeError:
+            ok = load_interference_output(path, text, m)
+        if ok:
+            used.append(path)
+
+    if not m.pairs():
+        print("No usable measurements")
+        sys.exit(1)
+
+    model = PerfModel(m, dict(args.home))
+    model.print_summary()
+    model.write_table(args.output, used)
+    print(f"\nModel written to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
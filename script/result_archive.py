@@ -0,0 +1,506 @@
+#!/usr/bin/env python3
+"""
+CXL Benchmark Result Archive and Regression Checker
+
+Keeps an append-only archive of double_bandwidth / cxl_memory_test JSON
+results (written with -j) and compares new results against it.
+
+Every result is filed under a key made of:
+- host fingerprint (CPU model, CPU count, NUMA nodes, memory size)
+- config hash (benchmark name plus its "config" object)
+
+Each key owns one JSON-lines file, <archive>/<benchmark>/<host>/<config>.jsonl,
+so finding a baseline is a path computation. index.jsonl lists every key
+once, with a readable host/config description.
+
+The kernel and scheduler are deliberately not part of the key: comparing
+across a kernel or scheduler update is the point of the archive. The
+benchmarks record them in the result's "environment" object when they run,
+each archived run keeps them, and compare prints the baseline's and the new
+runs' kernel and scheduler next to the verdict.
+
+compare runs a Welch t-test of the new results against the most recent
+baseline runs, metric by metric. A single new run is instead checked
+against the baseline's prediction interval. A change is flagged when it is
+both significant (p < alpha) and larger than --min-change.
+
+Exit status of compare: 0 if nothing regressed, 1 if anything regressed,
+2 if no result could be read, 3 if some result had no baseline (fewer than
+3 archived runs for its key) and nothing regressed.
+
+Usage:
+    result_archive.py add result.json [...] [--tag TEXT]
+    result_archive.py compare result.json [...] [--add]
+    result_archive.py list
+"""
+
+import argparse
+import hashlib
+import json
+import math
+import os
+import platform
+import socket
+import subprocess
+import sys
+from datetime import datetime
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+DEFAULT_ARCHIVE = os.environ.get("CXL_RESULT_ARCHIVE", "results/archive")
+DEFAULT_ALPHA = 0.01
+DEFAULT_MIN_CHANGE = 0.02   # ignore significant but sub-2% shifts
+DEFAULT_WINDOW = 30         # most recent baseline runs per key
+MIN_BASELINE_RUNS = 3
+EXIT_REGRESSION = 1
+EXIT_NO_INPUT = 2
+EXIT_NO_BASELINE = 3
+
+# "results" fields that describe the run rather than measure it
+NON_METRICS = {"elapsed_seconds", "num_readers", "num_writers"}
+
+
+def read_text(path: str) -> str:
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except OSError:
+        return ""
+
+
+def host_description() -> Dict:
+    """Hardware traits that change benchmark results; the hostname is kept
+    for display only so identical machines share baselines."""
+    model = ""
+    for line in read_text("/proc/cpuinfo").splitlines():
+        if line.startswith("model name"):
+            model = line.split(":", 1)[1].strip()
+            break
+    mem_kb = 0
+    for line in read_text("/proc/meminfo").splitlines():
+        if line.startswith("MemTotal:"):
+            mem_kb = int(line.split()[1])
+            break
+    nodes = sorted(p.name for p in Path("/sys/devices/system/node").glob("node[0-9]*"))
+    return {
+        "cpu_model": model or platform.processor(),
+        "cpus": os.cpu_count(),
+        "numa_nodes": len(nodes),
+        "mem_gb": round(mem_kb / (1024 * 1024)),
+    }
+
+
+def short_hash(obj) -> str:
+    text = json.dumps(obj, sort_keys=True, separators=(",", ":"))
+    return hashlib.sha256(text.encode()).hexdigest()[:12]
+
+
+def detect_scheduler() -> str:
+    """Name of the loaded sched_ext scheduler, "default" otherwise."""
+    if read_text("/sys/kernel/sched_ext/state") == "enabled":
+        ops = read_text("/sys/kernel/sched_ext/root/ops")
+        return f"scx_{ops}" if ops else "scx"
+    return "default"
+
+
+def git_revision() -> str:
+    try:
+        result = subprocess.run(["git", "rev-parse", "--short", "HEAD"],
+                                capture_output=True, text=True, timeout=5,
+                                cwd=Path(__file__).resolve().parent)
+        return result.stdout.strip() if result.returncode == 0 else ""
+    except (OSError, subprocess.TimeoutExpired):
+        return ""
+
+
+def path_safe(name: str) -> str:
+    return "".join(c if c.isalnum() or c in "._-" else "_" for c in name)
+
+
+class ResultKey:
+    """Archive key of one benchmark result: host and config only."""
+
+    def __init__(self, benchmark: str, config: Dict):
+        self.benchmark = benchmark
+        self.config = config
+        self.host = host_description()
+        self.host_id = short_hash(self.host)
+        self.config_id = short_hash({"benchmark": benchmark, "config": config})
+
+    def relative_path(self) -> Path:
+        return Path(path_safe(self.benchmark)) / self.host_id / f"{self.config_id}.jsonl"
+
+    def describe(self) -> Dict:
+        return {
+            "benchmark": self.benchmark,
+            "host_id": self.host_id,
+            "host": self.host,
+            "hostname": socket.gethostname(),
+            "config_id": self.config_id,
+            "config": self.config,
+            "path": str(self.relative_path()),
+        }
+
+
+def run_environment(data: Dict, scheduler: Optional[str]) -> Dict:
+    """Hostname, kernel and scheduler a result ran under.
+
+    Taken from the result's "environment" object; results written before
+    the benchmarks recorded it fall back to the current system. --scheduler
+    overrides the recorded scheduler name.
+    """
+    env = data.get("environment") or {}
+    return {
+        "hostname": env.get("hostname") or socket.gethostname(),
+        "kernel": env.get("kernel") or platform.release(),
+        "scheduler": scheduler or env.get("scheduler") or detect_scheduler(),
+    }
+
+
+def describe_environments(envs: List[Dict]) -> str:
+    kernels = sorted({env.get("kernel", "?") for env in envs})
+    schedulers = sorted({env.get("scheduler", "?") for env in envs})
+    return f"kernel {'/'.join(kernels)}, scheduler {'/'.join(schedulers)}"
+
+
+def numeric_metrics(fields: Dict, prefix: str = "") -> Dict:
+    return {prefix + name: float(value) for name, value in fields.items()
+            if name not in NON_METRICS and isinstance(value, (int, float))
+            and not isinstance(value, bool)}
+
+
+def load_result(path: str) -> Tuple[Dict, Dict]:
+    """(parsed JSON, numeric metrics) of a -j result file.
+
+    Sweep modes write "results" as a list of table rows, each with a "key"
+    object; their metrics are named "<key fields>:<metric>", e.g.
+    "node=0,kind=THP,threads=4:first_touch_gbps".
+    """
+    with open(path) as f:
+        data = json.load(f)
+    results = data.get("results")
+    if isinstance(results, dict):
+        metrics = numeric_metrics(results)
+    elif isinstance(results, list):
+        metrics = {}
+        for row in results:
+            key = ",".join(f"{k}={v}" for k, v in row.get("key", {}).items())
+            metrics.update(numeric_metrics({k: v for k, v in row.items() if k != "key"},
+                                           f"{key}:"))
+    else:
+        raise ValueError(f"{path} has no \"results\"")
+    if not metrics:
+        raise ValueError(f"{path} has no numeric results")
+    return data, metrics
+
+
+def lower_is_better(metric: str) -> bool:
+    name = metric.rsplit(":", 1)[-1]
+    return "latency" in name or name.endswith("_ns")
+
+
+class ResultArchive:
+    """Append-only, per-key JSON-lines archive."""
+
+    def __init__(self, root: str):
+        self.root = Path(root)
+        self.index_path = self.root / "index.jsonl"
+
+    def append(self, key: ResultKey, metrics: Dict, env: Dict, source: str,
+               tag: str = "") -> Path:
+        path = self.root / key.relative_path()
+        if not path.exists():
+            path.parent.mkdir(parents=True, exist_ok=True)
+            with open(self.index_path, "a") as index:
+                index.write(json.dumps(key.describe(), sort_keys=True) + "\n")
+        record = {
+            "timestamp": datetime.now().isoformat(timespec="seconds"),
+            "source": os.path.abspath(source),
+            "git": git_revision(),
+            "tag": tag,
+            "hostname": env["hostname"],
+            "kernel": env["kernel"],
+            "scheduler": env["scheduler"],
+            "metrics": metrics,
+        }
+        with open(path, "a") as f:
+            f.write(json.dumps(record, sort_keys=True) + "\n")
+        return path
+
+    def records(self, relative_path) -> List[Dict]:
+        path = self.root / relative_path
+        if not path.exists():
+            return []
+        with open(path) as f:
+            return [json.loads(line) for line in f if line.strip()]
+
+    def baseline(self, key: ResultKey, window: int) -> List[Dict]:
+        records = self.records(key.relative_path())
+        return records[-window:] if window > 0 else records
+
+    def keys(self) -> List[Dict]:
+        if not self.index_path.exists():
+            return []
+        with open(self.index_path) as f:
+            return [json.loads(line) for line in f if line.strip()]
+
+
+# --- Statistics (standard library only) ---
+
+def mean_var(values: List[float]) -> Tuple[float, float]:
+    n = len(values)
+    mean = sum(values) / n
+    var = sum((v - mean) ** 2 for v in values) / (n - 1) if n > 1 else 0.0
+    return mean, var
+
+
+def _betacf(a: float, b: float, x: float) -> float:
+    """Continued fraction for the incomplete beta function (Lentz)."""
+    tiny = 1e-300
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def incomplete_beta(a: float, b: float, x: float) -> float:
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) +
+                     a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * _betacf(a, b, x) / a
+    return 1.0 - front * _betacf(b, a, 1.0 - x) / b
+
+
+def t_two_sided_p(t: float, df: float) -> float:
+    if df <= 0:
+        return 1.0
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t))
+
+
+def welch_test(new: List[float], base: List[float]) -> Tuple[float, float]:
+    """(t, two-sided p) of Welch's unequal-variance t-test."""
+    m1, v1 = mean_var(new)
+    m2, v2 = mean_var(base)
+    se2 = v1 / len(new) + v2 / len(base)
+    if se2 == 0.0:
+        return (0.0, 1.0) if m1 == m2 else (math.copysign(math.inf, m1 - m2), 0.0)
+    t = (m1 - m2) / math.sqrt(se2)
+    denom = 0.0
+    if v1 > 0:
+        denom += (v1 / len(new)) ** 2 / (len(new) - 1)
+    if v2 > 0:
+        denom += (v2 / len(base)) ** 2 / (len(base) - 1)
+    df = se2 * se2 / denom
+    return t, t_two_sided_p(t, df)
+
+
+def prediction_test(value: float, base: List[float]) -> Tuple[float, float]:
+    """(t, two-sided p) of one new run against the baseline distribution."""
+    mean, var = mean_var(base)
+    if var == 0.0:
+        return (0.0, 1.0) if value == mean else (math.copysign(math.inf, value - mean), 0.0)
+    t = (value - mean) / math.sqrt(var * (1.0 + 1.0 / len(base)))
+    return t, t_two_sided_p(t, len(base) - 1)
+
+
+# --- Commands ---
+
+def group_inputs(paths: List[str], scheduler: Optional[str]) -> Dict[str, Tuple[ResultKey, List]]:
+    """Result files grouped by archive key; repeated runs form one sample.
+
+    Each run is (path, metrics, environment).
+    """
+    groups: Dict[str, Tuple[ResultKey, List]] = {}
+    for path in paths:
+        try:
+            data, metrics = load_result(path)
+        except (OSError, ValueError) as e:
+            print(f"Skipping {path}: {e}")
+            continue
+        key = ResultKey(data.get("benchmark", "unknown"), data.get("config", {}))
+        run = (path, metrics, run_environment(data, scheduler))
+        groups.setdefault(str(key.relative_path()), (key, []))[1].append(run)
+    return groups
+
+
+def cmd_add(args, archive: ResultArchive) -> int:
+    added = 0
+    for key, runs in group_inputs(args.results, args.scheduler).values():
+        for path, metrics, env in runs:
+            stored = archive.append(key, metrics, env, path, args.tag)
+            added += 1
+        print(f"{key.benchmark} [config {key.config_id}, "
+              f"{describe_environments([env for _, _, env in runs])}]: "
+              f"{len(runs)} run(s) -> {stored}")
+    return 0 if added else 1
+
+
+def compare_group(key: ResultKey, runs: List, baseline: List[Dict],
+                  args) -> Optional[Tuple[int, int]]:
+    """Print one key's comparison; returns (regressions, improvements), or
+    None when there are not enough baseline runs to compare against."""
+    print(f"\n{key.benchmark} [config {key.config_id}]: "
+          f"{len(runs)} new vs {len(baseline)} baseline run(s)")
+    new_env = describe_environments([env for _, _, env in runs])
+    if baseline:
+        base_env = describe_environments(baseline)
+        changed = "" if base_env == new_env else "  (changed)"
+        print(f"  baseline: {base_env}\n  new:      {new_env}{changed}")
+    else:
+        print(f"  new:      {new_env}")
+    if len(baseline) < MIN_BASELINE_RUNS:
+        print(f"  NO BASELINE: {len(baseline)} archived run(s), need {MIN_BASELINE_RUNS}; "
+              f"archive more with 'add' or 'compare --add'")
+        return None
+
+    regressions = improvements = 0
+    width = max([24] + [len(metric) for metric in runs[0][1]])
+    print(f"  {'metric':<{width}} {'baseline':>12} {'new':>12} {'change':>8} {'p':>9}  verdict")
+    for metric in sorted(runs[0][1]):
+        new = [m[metric] for _, m, _ in runs if metric in m]
+        base = [r["metrics"][metric] for r in baseline if metric in r.get("metrics", {})]
+        if not new or len(base) < MIN_BASELINE_RUNS:
+            continue
+        if len(new) == 1:
+            _, p = prediction_test(new[0], base)
+        else:
+            _, p = welch_test(new, base)
+
+        base_mean = mean_var(base)[0]
+        new_mean = mean_var(new)[0]
+        change = (new_mean - base_mean) / abs(base_mean) if base_mean else 0.0
+        better = -change if lower_is_better(metric) else change
+        verdict = "-"
+        if p < args.alpha and abs(change) >= args.min_change:
+            if better < 0:
+                verdict = "REGRESSION"
+                regressions += 1
+            else:
+                verdict = "improvement"
+                improvements += 1
+        print(f"  {metric:<{width}} {base_mean:>12.1f} {new_mean:>12.1f} {change:>+7.1%} "
+              f"{p:>9.2g}  {verdict}")
+    return regressions, improvements
+
+
+def cmd_compare(args, archive: ResultArchive) -> int:
+    total_regressions = total_improvements = missing_baselines = 0
+    groups = group_inputs(args.results, args.scheduler)
+    for key, runs in groups.values():
+        baseline = archive.baseline(key, args.window)
+        counts = compare_group(key, runs, baseline, args)
+        if counts is None:
+            missing_baselines += 1
+            regressions = improvements = 0
+        else:
+            regressions, improvements = counts
+        total_regressions += regressions
+        total_improvements += improvements
+        if args.add and not regressions:
+            for path, metrics, env in runs:
+                archive.append(key, metrics, env, path, args.tag)
+        elif args.add:
+            print("  Not archived: regressions must not become the new baseline")
+
+    print(f"\n{total_regressions} regression(s), {total_improvements} improvement(s), "
+          f"{missing_baselines} result group(s) without a baseline "
+          f"(alpha {args.alpha}, min change {args.min_change:.0%})")
+    if not groups:
+        return EXIT_NO_INPUT
+    if total_regressions:
+        return EXIT_REGRESSION
+    return EXIT_NO_BASELINE if missing_baselines else 0
+
+
+def cmd_list(args, archive: ResultArchive) -> int:
+    keys = archive.keys()
+    if not keys:
+        print(f"Archive {archive.root} is empty")
+        return 0
+    print(f"{'benchmark':<18} {'host':<13} {'config':<13} {'runs':>5}  "
+          f"{'latest kernel':<24} {'latest scheduler':<16} summary")
+    for entry in keys:
+        records = archive.records(entry["path"])
+        latest = records[-1] if records else {}
+        cfg = entry.get("config", {})
+        summary = ", ".join(f"{k}={cfg[k]}" for k in ("mode", "num_threads", "read_ratio",
+                                                      "buffer_size") if k in cfg)
+        print(f"{entry['benchmark']:<18} {entry['host_id']:<13} {entry['config_id']:<13} "
+              f"{len(records):>5}  {latest.get('kernel', '?'):<24} "
+              f"{latest.get('scheduler', '?'):<16} {summary}")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Archive benchmark JSON results and detect regressions against them",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  # Build a baseline from five runs
+  for i in 1 2 3 4 5; do ./double_bandwidth -t 8 -d 10 -j run$i.json; done
+  %(prog)s add run*.json --tag baseline
+
+  # After a kernel or scheduler change: compare, and archive if nothing regressed
+  for i in 1 2 3; do ./double_bandwidth -t 8 -d 10 -j new$i.json; done
+  %(prog)s compare new*.json --add
+
+  %(prog)s list
+        """)
+    parser.add_argument("--archive", default=DEFAULT_ARCHIVE,
+                        help=f"Archive directory (default: {DEFAULT_ARCHIVE}, "
+                             "or $CXL_RESULT_ARCHIVE)")
+    parser.add_argument("--scheduler", default=None,
+                        help="Scheduler name recorded with the runs (default: the "
+                             "result's \"environment\", else detect sched_ext ops)")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    add = sub.add_parser("add", help="Append results to the archive")
+    add.add_argument("results", nargs="+", help="JSON files written with -j")
+    add.add_argument("--tag", default="", help="Free-form label stored with each run")
+
+    compare = sub.add_parser("compare", help="Compare results against the archived baseline")
+    compare.add_argument("results", nargs="+", help="JSON files written with -j")
+    compare.add_argument("--alpha", type=float, default=DEFAULT_ALPHA,
+                         help=f"Significance level (default: {DEFAULT_ALPHA})")
+    compare.add_argument("--min-change", type=float, default=DEFAULT_MIN_CHANGE,
+                         help=f"Smallest relative change flagged (default: {DEFAULT_MIN_CHANGE})")
+    compare.add_argument("--window", type=int, default=DEFAULT_WINDOW,
+                         help=f"Most recent baseline runs used (default: {DEFAULT_WINDOW}, 0=all)")
+    compare.add_argument("--add", action="store_true",
+                         help="Archive the new results unless they regressed")
+    compare.add_argument("--tag", default="", help="Label stored with --add")
+
+    sub.add_parser("list", help="List archived keys and run counts")
+
+    args = parser.parse_args()
+
+    archive = ResultArchive(args.archive)
+    commands = {"add": cmd_add, "compare": cmd_compare, "list": cmd_list}
+    sys.exit(commands[args.command](args, archive))
+
+
+if __name__ == "__main__":
+    main()
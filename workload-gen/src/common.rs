@@ -68,9 +68,12 @@ pub struct ThreadMapping {
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct ExecutionConfig {
     pub duration_seconds: Option<u64>,
+    /// Total operations per second across all threads; None = unpaced
     pub rate_limit: Option<u64>,
     pub warmup_seconds: Option<u64>,
     pub metrics_interval: Option<u64>,
+    /// Back workload memory with transparent huge pages
+    pub huge_pages: Option<bool>,
 }
 
 /// Workload specification for pattern generation
@@ -119,6 +122,10 @@ pub struct ExecutionResults {
     pub read_throughput_mbps: f64,
     pub write_throughput_mbps: f64,
     pub operations_per_second: f64,
+    /// Configured rate_limit, to compare with operations_per_second
+    pub requested_ops_per_second: Option<f64>,
+    /// Time spent allocating and initializing memory before the run
+    pub setup_duration_ns: u64,
     pub thread_stats: Vec<ThreadStats>,
 }
 
@@ -1,333 +1,971 @@
 use crate::common::*;
+use crate::generator::{thread_streams, StreamParams, ThreadOpStream, STREAM_BATCH_OPS};
+use crate::topology::{bind_to_node, node_cpus, pin_current_thread};
 use anyhow::Result;
+use std::collections::BTreeMap;
 use std::fs::OpenOptions;
 use std::os::unix::fs::OpenOptionsExt;
 use std::ptr;
-use std::sync::{Arc, Mutex};
+use std::sync::Arc;
 use std::thread;
 use std::time::{Duration, Instant};
 
-/// Simple memory manager
-pub struct MemoryManager {
-    base_address: *mut u8,
+/// Operations between two timestamps on the hot path
+const TIMING_BATCH_OPS: u64 = 64;
+
+/// One operation in this many is timed individually for min/max latency
+const LATENCY_SAMPLE_INTERVAL: u64 = 64;
+
+/// Paced workers release about this much work between clock checks
+const PACING_CHECK_NS: u64 = 10_000;
+
+/// Gaps shorter than this are spun; sleeps this short are mostly timer
+/// slack and wakeup latency
+const PACING_SPIN_NS: u64 = 50_000;
+
+/// Smallest share of a region handed to one initialization thread
+const INIT_MIN_CHUNK: u64 = 64 * 1024 * 1024;
+
+/// Store unit of the initialization loop
+#[derive(Clone, Copy)]
+#[repr(C, align(64))]
+struct CacheLine([u8; 64]);
+
+/// Backing store of one mapped region
+enum Backing {
+    Heap,
+    Mmap,
+}
+
+/// One contiguous range of pattern addresses and the memory behind it
+struct MappedRegion {
+    name: String,
+    base: u64,
     size: u64,
-    is_device: bool,
+    ptr: *mut u8,
+    backing: Backing,
 }
 
-impl MemoryManager {
-    pub fn new_system_memory(size: u64) -> Result<Self> {
-        let base_address = unsafe {
+impl MappedRegion {
+    fn heap(name: &str, base: u64, size: u64) -> Result<Self> {
+        let ptr = unsafe {
             let layout = std::alloc::Layout::from_size_align(size as usize, 4096)?;
             std::alloc::alloc(layout)
         };
-        
-        if base_address.is_null() {
+
+        if ptr.is_null() {
             anyhow::bail!("Failed to allocate {} bytes", size);
         }
-        
-        // Initialize with pattern
-        unsafe {
-            for i in 0..size {
-                *base_address.add(i as usize) = (i % 256) as u8;
-            }
+
+        Ok(Self { name: name.to_string(), base, size, ptr, backing: Backing::Heap })
+    }
+
+    fn anonymous(name: &str, base: u64, size: u64, huge_pages: bool) -> Result<Self> {
+        let ptr = unsafe {
+            libc::mmap(
+                ptr::null_mut(),
+                size as libc::size_t,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_PRIVATE | libc::MAP_ANONYMOUS,
+                -1,
+                0,
+            )
+        };
+
+        if ptr == libc::MAP_FAILED {
+            anyhow::bail!("Failed to map {} bytes for region {}", size, name);
         }
-        
-        Ok(Self {
-            base_address,
-            size,
-            is_device: false,
-        })
+
+        if huge_pages && unsafe { libc::madvise(ptr, size as libc::size_t, libc::MADV_HUGEPAGE) } != 0 {
+            log::warn!("Region {}: transparent huge pages unavailable: {}", name, std::io::Error::last_os_error());
+        }
+
+        Ok(Self { name: name.to_string(), base, size, ptr: ptr as *mut u8, backing: Backing::Mmap })
     }
-    
-    pub fn new_device_memory(device_path: &str, size: u64, use_mmap: bool) -> Result<Self> {
+
+    fn device(name: &str, base: u64, device_path: &str, size: u64) -> Result<Self> {
         let file = OpenOptions::new()
             .read(true)
             .write(true)
             .custom_flags(libc::O_DIRECT)
             .open(device_path)?;
-            
-        let base_address = if use_mmap {
-            unsafe {
-                let addr = libc::mmap(
-                    ptr::null_mut(),
-                    size as libc::size_t,
-                    libc::PROT_READ | libc::PROT_WRITE,
-                    libc::MAP_SHARED,
-                    std::os::unix::io::AsRawFd::as_raw_fd(&file),
-                    0,
-                );
-                
-                if addr == libc::MAP_FAILED {
-                    anyhow::bail!("Failed to mmap device");
-                }
-                
-                addr as *mut u8
+
+        let ptr = unsafe {
+            libc::mmap(
+                ptr::null_mut(),
+                size as libc::size_t,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_SHARED,
+                std::os::unix::io::AsRawFd::as_raw_fd(&file),
+                0,
+            )
+        };
+
+        if ptr == libc::MAP_FAILED {
+            anyhow::bail!("Failed to mmap device {}", device_path);
+        }
+
+        Ok(Self { name: name.to_string(), base, size, ptr: ptr as *mut u8, backing: Backing::Mmap })
+    }
+
+    /// Write the initialization pattern (byte i holds i % 256), faulting in
+    /// every page. The region is split across threads that run on `node`'s
+    /// CPUs when it has any, so first touch happens next to the memory and
+    /// setup time scales with the CPUs instead of one core.
+    fn fill(&self, node: Option<u32>) {
+        let cpus = node.and_then(|n| node_cpus(n).ok()).filter(|c| !c.is_empty());
+        let parallelism = match cpus {
+            Some(ref cpus) => cpus.len(),
+            None => thread::available_parallelism().map_or(1, |n| n.get()),
+        };
+        let threads = (self.size / INIT_MIN_CHUNK).clamp(1, parallelism as u64);
+
+        // Chunks are whole pages so every thread starts on a 256-byte boundary
+        let chunk = (self.size / threads + 4095) & !4095;
+        let base = self.ptr as usize;
+
+        thread::scope(|scope| {
+            for index in 0..threads {
+                let start = (index * chunk).min(self.size);
+                let end = ((index + 1) * chunk).min(self.size);
+                let cpus = cpus.as_deref();
+                scope.spawn(move || {
+                    if let Some(cpus) = cpus {
+                        let _ = pin_current_thread(cpus);
+                    }
+                    unsafe { fill_pattern((base as *mut u8).add(start as usize), end - start) };
+                });
             }
+        });
+    }
+
+    fn end(&self) -> u64 {
+        self.base + self.size
+    }
+}
+
+impl Drop for MappedRegion {
+    fn drop(&mut self) {
+        match self.backing {
+            Backing::Heap => unsafe {
+                let layout = std::alloc::Layout::from_size_align_unchecked(self.size as usize, 4096);
+                std::alloc::dealloc(self.ptr, layout);
+            },
+            Backing::Mmap => unsafe {
+                libc::munmap(self.ptr as *mut libc::c_void, self.size as libc::size_t);
+            },
+        }
+    }
+}
+
+/// Fill `len` bytes at `dst` (256-byte aligned) with the repeating
+/// 0..=255 pattern using aligned 64-byte stores
+unsafe fn fill_pattern(dst: *mut u8, len: u64) {
+    let mut pattern = [CacheLine([0; 64]); 4];
+    for (i, byte) in pattern.iter_mut().flat_map(|line| line.0.iter_mut()).enumerate() {
+        *byte = i as u8;
+    }
+
+    let lines = dst as *mut CacheLine;
+    let full_lines = (len / 64) as usize;
+    for i in 0..full_lines {
+        ptr::write(lines.add(i), pattern[i % 4]);
+    }
+    for i in full_lines * 64..len as usize {
+        *dst.add(i) = i as u8;
+    }
+}
+
+/// Memory the pattern runs against. Pattern addresses are translated
+/// through a table of regions sorted by base address; without an address
+/// map there is a single system-memory region starting at 0.
+pub struct MemoryManager {
+    regions: Vec<MappedRegion>,
+}
+
+impl MemoryManager {
+    pub fn new_system_memory(size: u64, huge_pages: bool) -> Result<Self> {
+        let region = MappedRegion::anonymous("system", 0, size, huge_pages)?;
+        region.fill(None);
+        Ok(Self { regions: vec![region] })
+    }
+
+    pub fn new_device_memory(device_path: &str, size: u64, use_mmap: bool) -> Result<Self> {
+        let region = if use_mmap {
+            MappedRegion::device("device", 0, device_path, size)?
         } else {
             // For read/write mode, allocate staging buffer
-            let layout = std::alloc::Layout::from_size_align(size as usize, 4096)?;
-            unsafe { std::alloc::alloc(layout) }
+            MappedRegion::heap("device", 0, size)?
         };
-        
-        if base_address.is_null() {
-            anyhow::bail!("Failed to allocate/map device memory");
+        Ok(Self { regions: vec![region] })
+    }
+
+    /// Allocate every region of an address map. Regions with a NUMA node
+    /// are anonymous memory bound to that node (CXL expanders appear as
+    /// memory-only nodes); otherwise a region with a device is mapped from
+    /// it, and the rest is plain system memory. GPU regions are skipped.
+    pub fn from_address_map(address_map: &AddressMap, huge_pages: bool) -> Result<Self> {
+        let mut regions = Vec::new();
+
+        for region in &address_map.memory_regions {
+            if let RegionType::Gpu = region.region_type {
+                log::warn!("Skipping GPU region {} (not supported by the executor)", region.name);
+                continue;
+            }
+
+            let mapped = if let Some(node) = region.numa_node {
+                let mapped = MappedRegion::anonymous(&region.name, region.base, region.size, huge_pages)?;
+                bind_to_node(mapped.ptr, mapped.size as usize, node)
+                    .map_err(|e| anyhow::anyhow!("Region {}: {}", region.name, e))?;
+                mapped.fill(Some(node));
+                mapped
+            } else if let Some(ref device) = region.device {
+                MappedRegion::device(&region.name, region.base, device, region.size)?
+            } else {
+                let mapped = MappedRegion::anonymous(&region.name, region.base, region.size, huge_pages)?;
+                mapped.fill(None);
+                mapped
+            };
+
+            log::info!(
+                "Region {}: 0x{:x}-0x{:x} {:?} node {:?} device {:?}",
+                region.name, region.base, region.base + region.size,
+                region.region_type, region.numa_node, region.device
+            );
+            regions.push(mapped);
         }
-        
-        Ok(Self {
-            base_address,
-            size,
-            is_device: true,
-        })
+
+        regions.sort_by_key(|r| r.base);
+        for pair in regions.windows(2) {
+            if pair[0].end() > pair[1].base {
+                anyhow::bail!("Regions {} and {} overlap", pair[0].name, pair[1].name);
+            }
+        }
+
+        Ok(Self { regions })
+    }
+
+    /// Host pointer for `len` bytes at pattern address `address`; the range
+    /// must lie inside a single region
+    #[inline]
+    fn translate(&self, address: u64, len: usize) -> Option<*mut u8> {
+        let index = self.regions.partition_point(|r| r.base <= address).checked_sub(1)?;
+        let region = &self.regions[index];
+        if address + len as u64 > region.end() {
+            return None;
+        }
+        Some(unsafe { region.ptr.add((address - region.base) as usize) })
     }
-    
-    pub fn execute_read(&self, address: u64, size: usize) -> Result<Duration> {
-        if address + size as u64 > self.size {
-            anyhow::bail!("Read beyond memory bounds");
+
+    /// Check that every byte of [start, end) is backed by some region
+    pub fn covers(&self, start: u64, end: u64) -> bool {
+        let mut next = start;
+        for region in &self.regions {
+            if region.base <= next && region.end() > next {
+                next = region.end();
+            }
         }
-        
-        let start = Instant::now();
-        let mut buffer = vec![0u8; size];
-        
+        next >= end
+    }
+
+    /// Copy `buffer.len()` bytes at `address` into the caller's buffer
+    pub fn execute_read(&self, address: u64, buffer: &mut [u8]) -> Result<()> {
+        let src = match self.translate(address, buffer.len()) {
+            Some(src) => src,
+            None => anyhow::bail!("Read of {} bytes at 0x{:x} is outside the mapped regions", buffer.len(), address),
+        };
+
         unsafe {
-            ptr::copy_nonoverlapping(
-                self.base_address.add(address as usize),
-                buffer.as_mut_ptr(),
-                size,
-            );
+            ptr::copy_nonoverlapping(src, buffer.as_mut_ptr(), buffer.len());
         }
-        
+
         // Prevent optimization
         std::hint::black_box(buffer);
-        
-        Ok(start.elapsed())
-    }
-    
-    pub fn execute_write(&self, address: u64, size: usize) -> Result<Duration> {
-        if address + size as u64 > self.size {
-            anyhow::bail!("Write beyond memory bounds");
-        }
-        
-        let start = Instant::now();
-        let buffer = vec![0xAA; size]; // Write pattern
-        
+
+        Ok(())
+    }
+
+    /// Copy the caller's buffer to `address`
+    pub fn execute_write(&self, address: u64, buffer: &[u8]) -> Result<()> {
+        let dst = match self.translate(address, buffer.len()) {
+            Some(dst) => dst,
+            None => anyhow::bail!("Write of {} bytes at 0x{:x} is outside the mapped regions", buffer.len(), address),
+        };
+
         unsafe {
-            ptr::copy_nonoverlapping(
-                buffer.as_ptr(),
-                self.base_address.add(address as usize),
-                size,
-            );
+            ptr::copy_nonoverlapping(buffer.as_ptr(), dst, buffer.len());
         }
-        
-        Ok(start.elapsed())
+
+        Ok(())
     }
-    
-    pub fn execute_cpu(&self, cycles: u64) -> Result<Duration> {
-        let start = Instant::now();
-        
+
+    pub fn execute_cpu(&self, cycles: u64) {
         // Simple CPU workload
         let mut sum: u64 = 0;
         for i in 0..cycles {
             sum = sum.wrapping_add(i).wrapping_mul(i);
         }
-        
+
         // Prevent optimization
         std::hint::black_box(sum);
-        
-        Ok(start.elapsed())
     }
 }
 
-impl Drop for MemoryManager {
-    fn drop(&mut self) {
-        if !self.base_address.is_null() {
-            if self.is_device {
-                unsafe {
-                    libc::munmap(self.base_address as *mut libc::c_void, self.size as libc::size_t);
-                }
-            } else {
-                unsafe {
-                    let layout = std::alloc::Layout::from_size_align_unchecked(self.size as usize, 4096);
-                    std::alloc::dealloc(self.base_address, layout);
-                }
+unsafe impl Send for MemoryManager {}
+unsafe impl Sync for MemoryManager {}
+
+/// Per-thread operation with the thread id stripped
+#[derive(Debug, Clone, Copy)]
+enum ThreadOp {
+    Read { addr: u64, size: usize },
+    Write { addr: u64, size: usize },
+    Cpu { cycles: u64 },
+    Skip,
+}
+
+impl ThreadOp {
+    fn from_operation(op: &Operation) -> Self {
+        match op {
+            Operation::Read { addr, size, .. } => ThreadOp::Read { addr: *addr, size: *size as usize },
+            Operation::Write { addr, size, .. } => ThreadOp::Write { addr: *addr, size: *size as usize },
+            Operation::Cpu { cycles, .. } => ThreadOp::Cpu { cycles: *cycles },
+            Operation::Gpu { .. } => ThreadOp::Skip,
+        }
+    }
+}
+
+fn operation_thread(op: &Operation) -> u32 {
+    match op {
+        Operation::Read { thread, .. }
+        | Operation::Write { thread, .. }
+        | Operation::Cpu { thread, .. }
+        | Operation::Gpu { thread, .. } => *thread,
+    }
+}
+
+/// Operations of one pattern thread, in pattern order
+struct ThreadProgram {
+    thread: u32,
+    ops: Vec<ThreadOp>,
+}
+
+/// Split a pattern into per-thread programs ordered by thread id
+fn split_by_thread(pattern: &Pattern) -> Vec<ThreadProgram> {
+    let mut programs: BTreeMap<u32, ThreadProgram> = BTreeMap::new();
+    let mut skipped_gpu = 0u64;
+
+    for op in &pattern.operations {
+        let thread_op = ThreadOp::from_operation(op);
+        if let ThreadOp::Skip = thread_op {
+            skipped_gpu += 1;
+            continue;
+        }
+        let thread = operation_thread(op);
+        programs
+            .entry(thread)
+            .or_insert_with(|| ThreadProgram { thread, ops: Vec::new() })
+            .ops
+            .push(thread_op);
+    }
+
+    if skipped_gpu > 0 {
+        log::warn!("Skipping {} GPU operations (not supported by the executor)", skipped_gpu);
+    }
+
+    programs.into_values().collect()
+}
+
+/// Highest byte offset touched by any read or write, rounded up to a page
+fn memory_extent(pattern: &Pattern) -> u64 {
+    let end = pattern
+        .operations
+        .iter()
+        .filter_map(|op| match op {
+            Operation::Read { addr, size, .. } | Operation::Write { addr, size, .. } => {
+                Some(addr + size)
             }
+            _ => None,
+        })
+        .max()
+        .unwrap_or(0);
+
+    ((end + 4095) & !4095).max(4096)
+}
+
+/// Releases operations at a fixed rate against a monotonic schedule
+///
+/// Operation n is due at start + n * interval. The pacer releases a batch
+/// of operations per clock check, spins when the next batch is due soon and
+/// sleeps only for long gaps. A worker that falls behind keeps its debt and
+/// runs back-to-back until it catches up, so the achieved rate matches the
+/// requested one instead of drifting by the per-operation overhead.
+struct Pacer {
+    start: Instant,
+    interval_ns: f64,
+    batch: u64,
+    released: u64,
+    credit: u64,
+    deadline: Option<Instant>,
+    waited_ns: u64,
+}
+
+impl Pacer {
+    fn new(ops_per_second: f64, deadline: Option<Instant>) -> Self {
+        let interval_ns = 1e9 / ops_per_second;
+        Self {
+            start: Instant::now(),
+            interval_ns,
+            batch: ((PACING_CHECK_NS as f64 / interval_ns) as u64).max(1),
+            released: 0,
+            credit: 0,
+            deadline,
+            waited_ns: 0,
+        }
+    }
+
+    /// Admit one operation, waiting if it is not due yet; false once the
+    /// next operation would start after the deadline
+    #[inline]
+    fn admit(&mut self) -> bool {
+        if self.credit == 0 {
+            if !self.wait_for_batch() {
+                return false;
+            }
+            self.credit = self.batch;
         }
+        self.credit -= 1;
+        true
+    }
+
+    fn wait_for_batch(&mut self) -> bool {
+        let due = self.start + Duration::from_nanos((self.released as f64 * self.interval_ns) as u64);
+        if self.deadline.map_or(false, |d| due >= d) {
+            return false;
+        }
+        self.released += self.batch;
+
+        let now = Instant::now();
+        if due <= now {
+            return true;
+        }
+
+        let gap = due - now;
+        if gap > Duration::from_nanos(PACING_SPIN_NS) {
+            thread::sleep(gap - Duration::from_nanos(PACING_SPIN_NS));
+        }
+        while Instant::now() < due {
+            std::hint::spin_loop();
+        }
+        self.waited_ns += now.elapsed().as_nanos() as u64;
+        true
     }
 }
 
-unsafe impl Send for MemoryManager {}
-unsafe impl Sync for MemoryManager {}
+/// Where a worker gets its operations from
+enum OpSource<'a> {
+    /// A materialized program, repeated until the deadline
+    Program(&'a ThreadProgram),
+    /// A lazily generated stream, consumed in fixed-size batches and
+    /// replayed from the start until the deadline
+    Stream(ThreadOpStream),
+}
 
-/// Metrics collector
-#[derive(Clone)]
-pub struct MetricsCollector {
-    stats: Arc<Mutex<ExecutionResults>>,
+/// Runs one thread's operations. Buffers are allocated once, stats stay
+/// local to the thread, and the clock is read once per TIMING_BATCH_OPS
+/// operations plus once around every LATENCY_SAMPLE_INTERVAL-th operation.
+struct ThreadRunner<'a> {
+    source: OpSource<'a>,
+    memory: &'a MemoryManager,
+    ops: Vec<ThreadOp>,
+    stream_batch: Vec<Operation>,
+    read_buffer: Vec<u8>,
+    write_buffer: Vec<u8>,
 }
 
-impl MetricsCollector {
-    pub fn new(num_threads: usize) -> Self {
-        let mut results = ExecutionResults::default();
-        results.thread_stats = vec![ThreadStats::default(); num_threads];
-        
+impl<'a> ThreadRunner<'a> {
+    fn new(source: OpSource<'a>, memory: &'a MemoryManager) -> Self {
         Self {
-            stats: Arc::new(Mutex::new(results)),
-        }
-    }
-    
-    pub fn record_operation(&self, thread_id: usize, op: &Operation, latency: Duration) {
-        let mut stats = self.stats.lock().unwrap();
-        let thread_stats = &mut stats.thread_stats[thread_id];
-        
-        thread_stats.thread_id = thread_id;
-        thread_stats.operations_completed += 1;
-        
-        let latency_ns = latency.as_nanos() as u64;
-        thread_stats.total_latency_ns += latency_ns;
-        
-        if thread_stats.min_latency_ns == 0 || latency_ns < thread_stats.min_latency_ns {
-            thread_stats.min_latency_ns = latency_ns;
-        }
-        if latency_ns > thread_stats.max_latency_ns {
-            thread_stats.max_latency_ns = latency_ns;
-        }
-        
-        match op.op_type {
-            OpType::Read => {
-                thread_stats.bytes_read += op.size.unwrap_or(0) as u64;
-            },
-            OpType::Write => {
-                thread_stats.bytes_written += op.size.unwrap_or(0) as u64;
-            },
-            OpType::Cpu => {
-                thread_stats.cpu_cycles_executed += op.cpu_cycles.unwrap_or(0);
-            },
+            source,
+            memory,
+            ops: Vec::new(),
+            stream_batch: Vec::with_capacity(STREAM_BATCH_OPS),
+            read_buffer: Vec::new(),
+            write_buffer: Vec::new(),
+        }
+    }
+
+    fn thread(&self) -> u32 {
+        match &self.source {
+            OpSource::Program(program) => program.thread,
+            OpSource::Stream(stream) => stream.thread(),
+        }
+    }
+
+    /// Load the next run of operations into `self.ops`; false when done
+    fn refill(&mut self, first: bool, repeat: bool) -> bool {
+        match &mut self.source {
+            OpSource::Program(program) => {
+                if first {
+                    self.ops.clear();
+                    self.ops.extend_from_slice(&program.ops);
+                }
+                (first || repeat) && !self.ops.is_empty()
+            }
+            OpSource::Stream(stream) => {
+                if !stream.next_batch(&mut self.stream_batch, STREAM_BATCH_OPS) {
+                    // Like programs, a finite stream repeats until the deadline
+                    if !repeat {
+                        return false;
+                    }
+                    stream.reset();
+                    if !stream.next_batch(&mut self.stream_batch, STREAM_BATCH_OPS) {
+                        return false;
+                    }
+                }
+                self.ops.clear();
+                self.ops.extend(self.stream_batch.iter().map(ThreadOp::from_operation));
+                true
+            }
+        }
+    }
+
+    /// Start the next run() from the first operation, so the timed run
+    /// does not continue where warmup left off
+    fn rewind(&mut self) {
+        if let OpSource::Stream(stream) = &mut self.source {
+            stream.reset();
+        }
+    }
+
+    fn execute(&mut self, op: ThreadOp) -> bool {
+        match op {
+            ThreadOp::Read { addr, size } => {
+                if self.read_buffer.len() < size {
+                    self.read_buffer.resize(size, 0);
+                }
+                self.memory.execute_read(addr, &mut self.read_buffer[..size]).is_ok()
+            }
+            ThreadOp::Write { addr, size } => {
+                if self.write_buffer.len() < size {
+                    self.write_buffer.resize(size, 0xAA); // Write pattern
+                }
+                self.memory.execute_write(addr, &self.write_buffer[..size]).is_ok()
+            }
+            ThreadOp::Cpu { cycles } => {
+                self.memory.execute_cpu(cycles);
+                true
+            }
+            ThreadOp::Skip => false,
+        }
+    }
+
+    /// Execute the operations once, repeating them until `deadline` if one
+    /// is given. With `rate` set, operations are paced to that many per
+    /// second.
+    fn run(&mut self, deadline: Option<Instant>, rate: Option<f64>) -> ThreadStats {
+        let mut stats = ThreadStats {
+            thread_id: self.thread(),
+            ..Default::default()
+        };
+        let mut pacer = rate.map(|r| Pacer::new(r, deadline));
+
+        let mut in_batch = 0u64;
+        let mut batch_start = Instant::now();
+        let mut first = true;
+
+        'outer: while self.refill(first, deadline.is_some()) {
+            first = false;
+            for index in 0..self.ops.len() {
+                let op = self.ops[index];
+                if let Some(ref mut pacer) = pacer {
+                    if !pacer.admit() {
+                        break 'outer;
+                    }
+                }
+                let ok = if stats.operations_completed % LATENCY_SAMPLE_INTERVAL == 0 {
+                    let start = Instant::now();
+                    let ok = self.execute(op);
+                    let latency_ns = start.elapsed().as_nanos() as u64;
+                    if stats.min_latency_ns == 0 || latency_ns < stats.min_latency_ns {
+                        stats.min_latency_ns = latency_ns;
+                    }
+                    stats.max_latency_ns = stats.max_latency_ns.max(latency_ns);
+                    ok
+                } else {
+                    self.execute(op)
+                };
+
+                if ok {
+                    stats.operations_completed += 1;
+                    match op {
+                        ThreadOp::Read { size, .. } => stats.bytes_read += size as u64,
+                        ThreadOp::Write { size, .. } => stats.bytes_written += size as u64,
+                        ThreadOp::Cpu { cycles } => stats.cpu_cycles_executed += cycles,
+                        ThreadOp::Skip => {}
+                    }
+                }
+
+                in_batch += 1;
+                if in_batch == TIMING_BATCH_OPS {
+                    let now = Instant::now();
+                    stats.total_latency_ns += (now - batch_start).as_nanos() as u64;
+                    batch_start = now;
+                    in_batch = 0;
+
+                    if deadline.map_or(false, |d| now >= d) {
+                        break 'outer;
+                    }
+                }
+            }
+        }
+
+        if in_batch > 0 {
+            stats.total_latency_ns += batch_start.elapsed().as_nanos() as u64;
         }
+        // Time spent waiting for the schedule is not operation latency
+        if let Some(pacer) = pacer {
+            stats.total_latency_ns = stats.total_latency_ns.saturating_sub(pacer.waited_ns);
+        }
+        stats
     }
-    
-    pub fn finalize(&self, total_duration: Duration) -> ExecutionResults {
-        let mut stats = self.stats.lock().unwrap();
-        
+}
+
+/// Merges per-thread stats once all workers have finished
+pub struct MetricsCollector;
+
+impl MetricsCollector {
+    pub fn finalize(pattern_name: &str, thread_stats: Vec<ThreadStats>, total_duration: Duration) -> ExecutionResults {
+        let mut stats = ExecutionResults {
+            pattern_name: pattern_name.to_string(),
+            thread_stats,
+            ..Default::default()
+        };
+
         stats.total_duration_ns = total_duration.as_nanos() as u64;
         stats.total_operations = stats.thread_stats.iter().map(|t| t.operations_completed).sum();
         stats.total_bytes_read = stats.thread_stats.iter().map(|t| t.bytes_read).sum();
         stats.total_bytes_written = stats.thread_stats.iter().map(|t| t.bytes_written).sum();
         stats.total_cpu_cycles = stats.thread_stats.iter().map(|t| t.cpu_cycles_executed).sum();
-        
+
         if stats.total_operations > 0 {
             let total_latency: u64 = stats.thread_stats.iter().map(|t| t.total_latency_ns).sum();
             stats.average_latency_ns = total_latency as f64 / stats.total_operations as f64;
         }
-        
+
         let seconds = total_duration.as_secs_f64();
         if seconds > 0.0 {
             stats.read_throughput_mbps = (stats.total_bytes_read as f64 / (1024.0 * 1024.0)) / seconds;
             stats.write_throughput_mbps = (stats.total_bytes_written as f64 / (1024.0 * 1024.0)) / seconds;
+            stats.operations_per_second = stats.total_operations as f64 / seconds;
+        }
+
+        stats
+    }
+}
+
+/// What the executor runs: a materialized pattern or a workload generated
+/// on the fly by each worker
+enum WorkSource {
+    Programs(Arc<Vec<ThreadProgram>>),
+    Workload(WorkloadSpec),
+}
+
+/// CPUs a pattern thread is pinned to: the mapped CPU, else every CPU of
+/// the mapped NUMA node; None leaves the thread unpinned
+fn thread_cpus(schedule_map: &ScheduleMap, thread: u32) -> Result<Option<Vec<u32>>> {
+    let mapping = match schedule_map.thread_mapping.iter().find(|m| m.thread == thread) {
+        Some(mapping) => mapping,
+        None => return Ok(None),
+    };
+
+    if let Some(cpu) = mapping.cpu {
+        return Ok(Some(vec![cpu]));
+    }
+    if let Some(node) = mapping.numa_node {
+        let cpus = node_cpus(node)?;
+        if cpus.is_empty() {
+            anyhow::bail!("Thread {} is mapped to NUMA node {}, which has no CPUs", thread, node);
         }
-        
-        (*stats).clone()
+        return Ok(Some(cpus));
     }
+    Ok(None)
 }
 
 /// Simple pattern executor
 pub struct PatternExecutor {
     memory: Arc<MemoryManager>,
-    metrics: MetricsCollector,
-    pattern: PatternSpec,
+    work: WorkSource,
+    pattern_name: String,
+    schedule_map: Option<ScheduleMap>,
+    config: ExecutionConfig,
+    setup_duration: Duration,
 }
 
 impl PatternExecutor {
-    pub fn new(pattern: PatternSpec) -> Result<Self> {
-        let memory = if let Some(device_path) = &pattern.device_path {
-            Arc::new(MemoryManager::new_device_memory(device_path, pattern.memory_size, pattern.use_mmap)?)
-        } else {
-            Arc::new(MemoryManager::new_system_memory(pattern.memory_size)?)
+    pub fn new(
+        pattern: Pattern,
+        address_map: Option<AddressMap>,
+        schedule_map: Option<ScheduleMap>,
+        config: ExecutionConfig,
+    ) -> Result<Self> {
+        let setup_start = Instant::now();
+        let huge_pages = config.huge_pages.unwrap_or(false);
+        let memory = match address_map {
+            Some(ref address_map) => {
+                let memory = MemoryManager::from_address_map(address_map, huge_pages)?;
+                for op in &pattern.operations {
+                    if let Operation::Read { addr, size, .. } | Operation::Write { addr, size, .. } = op {
+                        if memory.translate(*addr, *size as usize).is_none() {
+                            anyhow::bail!("Access of {} bytes at 0x{:x} is not inside one region of the address map", size, addr);
+                        }
+                    }
+                }
+                memory
+            }
+            None => MemoryManager::new_system_memory(memory_extent(&pattern), huge_pages)?,
+        };
+        let programs = Arc::new(split_by_thread(&pattern));
+
+        Ok(Self {
+            memory: Arc::new(memory),
+            work: WorkSource::Programs(programs),
+            pattern_name: pattern.name,
+            schedule_map,
+            config,
+            setup_duration: setup_start.elapsed(),
+        })
+    }
+
+    /// Execute a workload specification without materializing its pattern;
+    /// each worker generates its own operations in batches
+    pub fn from_workload(
+        workload: WorkloadSpec,
+        address_map: Option<AddressMap>,
+        schedule_map: Option<ScheduleMap>,
+        config: ExecutionConfig,
+    ) -> Result<Self> {
+        let setup_start = Instant::now();
+        let huge_pages = config.huge_pages.unwrap_or(false);
+        let params = StreamParams::from_workload(&workload);
+        // An unbounded stream only ends at the deadline
+        if params.ops_per_thread.is_none() && config.duration_seconds.is_none() {
+            anyhow::bail!(
+                "Workload {} is unbounded (operations = 0) and no duration is set; \
+                 pass --duration or set \"operations\"",
+                workload.name
+            );
+        }
+        let memory = match address_map {
+            Some(ref address_map) => {
+                let memory = MemoryManager::from_address_map(address_map, huge_pages)?;
+                if !memory.covers(0, params.memory_size) {
+                    anyhow::bail!(
+                        "Address map does not cover the workload's memory_size (0x0-0x{:x})",
+                        params.memory_size
+                    );
+                }
+                memory
+            }
+            None => MemoryManager::new_system_memory(params.memory_size, huge_pages)?,
         };
-        
-        let metrics = MetricsCollector::new(pattern.num_threads);
-        
-        Ok(Self { memory, metrics, pattern })
+
+        Ok(Self {
+            memory: Arc::new(memory),
+            pattern_name: workload.name.clone(),
+            work: WorkSource::Workload(workload),
+            schedule_map,
+            config,
+            setup_duration: setup_start.elapsed(),
+        })
     }
-    
+
     pub fn execute(&self) -> Result<ExecutionResults> {
-        let pattern = &self.pattern;
-        println!("Executing pattern: {}", pattern.name);
-        println!("Thread patterns: {}", pattern.thread_patterns.len());
-        println!("Threads: {}", pattern.num_threads);
-        
-        let start_time = Instant::now();
-        
-        // Spawn worker threads
+        println!("Executing pattern: {}", self.pattern_name);
+
+        let warmup = self.config.warmup_seconds.map(Duration::from_secs);
+        let duration = self.config.duration_seconds.map(Duration::from_secs);
+
+        // Streams are created here so every execute() replays the same sequence
+        let workers: Vec<(u32, Option<ThreadOpStream>)> = match &self.work {
+            WorkSource::Programs(programs) => programs.iter().map(|p| (p.thread, None)).collect(),
+            WorkSource::Workload(workload) => thread_streams(workload)
+                .into_iter()
+                .map(|stream| (stream.thread(), Some(stream)))
+                .collect(),
+        };
+        println!("Threads: {}", workers.len());
+
+        // rate_limit is the total operations per second, split evenly
+        let thread_rate = match self.config.rate_limit {
+            Some(0) => anyhow::bail!("rate_limit must be positive"),
+            Some(rate) => Some(rate as f64 / workers.len().max(1) as f64),
+            None => None,
+        };
+
+        // Resolve the schedule before starting anything so a bad mapping
+        // fails the run instead of one worker
+        let mut pinning = Vec::with_capacity(workers.len());
+        for (thread, _) in &workers {
+            let cpus = match self.schedule_map {
+                Some(ref schedule_map) => thread_cpus(schedule_map, *thread)?,
+                None => None,
+            };
+            if let Some(ref cpus) = cpus {
+                log::debug!("Thread {} pinned to CPUs {:?}", thread, cpus);
+            }
+            pinning.push(cpus);
+        }
+
+        // Workers report their own stats when joined; nothing is shared
+        // between threads while the pattern runs
         let mut handles = Vec::new();
-        for thread_pattern in &pattern.thread_patterns {
-            let thread_pattern = thread_pattern.clone();
+        for (index, ((thread, stream), cpus)) in workers.into_iter().zip(pinning).enumerate() {
+            let programs = match &self.work {
+                WorkSource::Programs(programs) => Some(Arc::clone(programs)),
+                WorkSource::Workload(_) => None,
+            };
             let memory = Arc::clone(&self.memory);
-            let metrics = self.metrics.clone();
-            
+
             let handle = thread::spawn(move || {
-                let thread_id = thread_pattern.thread_id;
-                let working_set_base = thread_pattern.working_set_base.unwrap_or(0);
-                let working_set_size = thread_pattern.working_set_size.unwrap_or(u64::MAX);
-                
-                // Repeat pattern if specified
-                let repeat_count = thread_pattern.repeat_pattern.unwrap_or(1);
-                
-                for _repeat in 0..repeat_count {
-                    for op in &thread_pattern.operations {
-                        let iterations = op.iterations.unwrap_or(1);
-                        let mut current_address = working_set_base + op.address.unwrap_or(0);
-                        
-                        for _iter in 0..iterations {
-                            // Execute operation
-                            let latency = match op.op_type {
-                                OpType::Read => {
-                                    let size = op.size.unwrap_or(4096);
-                                    // Ensure address is within working set
-                                    if current_address + size as u64 > working_set_base + working_set_size {
-                                        current_address = working_set_base;
-                                    }
-                                    memory.execute_read(current_address, size)
-                                },
-                                OpType::Write => {
-                                    let size = op.size.unwrap_or(4096);
-                                    // Ensure address is within working set
-                                    if current_address + size as u64 > working_set_base + working_set_size {
-                                        current_address = working_set_base;
-                                    }
-                                    memory.execute_write(current_address, size)
-                                },
-                                OpType::Cpu => {
-                                    memory.execute_cpu(op.cpu_cycles.unwrap_or(1000))
-                                },
-                            };
-                            
-                            if let Ok(latency) = latency {
-                                metrics.record_operation(thread_id, &op, latency);
-                            }
-                            
-                            // Update address with stride
-                            if let Some(stride) = op.stride {
-                                current_address += stride;
-                            }
-                            
-                            // Think time
-                            if let Some(think_time_ns) = op.think_time_ns {
-                                thread::sleep(Duration::from_nanos(think_time_ns));
-                            }
-                        }
+                if thread_rate.is_some() {
+                    // Tighten timer slack so the pacer's long sleeps end on time
+                    unsafe {
+                        libc::prctl(libc::PR_SET_TIMERSLACK, 1 as libc::c_ulong);
                     }
                 }
+                if let Some(cpus) = cpus {
+                    if let Err(e) = pin_current_thread(&cpus) {
+                        log::warn!("Thread {}: {}", thread, e);
+                    }
+                }
+
+                let source = match (&programs, stream) {
+                    (Some(programs), _) => OpSource::Program(&programs[index]),
+                    (None, Some(stream)) => OpSource::Stream(stream),
+                    (None, None) => unreachable!("worker without operations"),
+                };
+                let mut runner = ThreadRunner::new(source, &memory);
+                if let Some(warmup) = warmup {
+                    runner.run(Some(Instant::now() + warmup), thread_rate);
+                    runner.rewind();
+                }
+                let start = Instant::now();
+                let stats = runner.run(duration.map(|d| start + d), thread_rate);
+                (stats, start.elapsed())
             });
-            
+
             handles.push(handle);
         }
-        
+
         // Wait for all threads
+        let mut thread_stats = Vec::with_capacity(handles.len());
+        let mut total_duration = Duration::ZERO;
         for handle in handles {
-            handle.join().expect("Thread panicked");
+            let (stats, elapsed) = handle.join().expect("Thread panicked");
+            thread_stats.push(stats);
+            total_duration = total_duration.max(elapsed);
         }
-        
-        let total_duration = start_time.elapsed();
-        let mut results = self.metrics.finalize(total_duration);
-        results.pattern_name = pattern.name.clone();
+
+        let mut results = MetricsCollector::finalize(&self.pattern_name, thread_stats, total_duration);
+        results.requested_ops_per_second = self.config.rate_limit.map(|rate| rate as f64);
+        results.setup_duration_ns = self.setup_duration.as_nanos() as u64;
         Ok(results)
     }
-} 
\ No newline at end of file
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn region(name: &str, base: u64, size: u64) -> MemoryRegion {
+        MemoryRegion {
+            name: name.to_string(),
+            base,
+            size,
+            region_type: RegionType::Dram,
+            device: None,
+            numa_node: None,
+        }
+    }
+
+    #[test]
+    fn test_address_translation() {
+        let map = AddressMap {
+            memory_regions: vec![region("high", 1 << 20, 1 << 16), region("low", 0, 1 << 16)],
+        };
+        let memory = MemoryManager::from_address_map(&map, false).unwrap();
+
+        let mut buffer = [0u8; 64];
+        memory.execute_write((1 << 20) + 128, &[7u8; 64]).unwrap();
+        memory.execute_read((1 << 20) + 128, &mut buffer).unwrap();
+        assert_eq!(buffer, [7u8; 64]);
+
+        // Gaps and accesses running past a region are rejected
+        assert!(memory.execute_read(1 << 17, &mut buffer).is_err());
+        assert!(memory.execute_read((1 << 16) - 32, &mut buffer).is_err());
+        assert!(memory.covers(0, 1 << 16));
+        assert!(!memory.covers(0, (1 << 20) + 1));
+    }
+
+    #[test]
+    fn test_stream_repeats_after_warmup() {
+        let mut params = std::collections::HashMap::new();
+        params.insert("operations".to_string(), serde_json::json!(100));
+        params.insert("threads".to_string(), serde_json::json!(1));
+        params.insert("memory_size".to_string(), serde_json::json!(1 << 20));
+        let workload = WorkloadSpec {
+            name: "repeat".to_string(),
+            workload_type: WorkloadType::Sequential,
+            params,
+        };
+        let memory = MemoryManager::new_system_memory(1 << 20, false).unwrap();
+        let stream = thread_streams(&workload).remove(0);
+        let mut runner = ThreadRunner::new(OpSource::Stream(stream), &memory);
+
+        // Warmup alone would exhaust the stream; the timed run starts over
+        runner.run(Some(Instant::now() + Duration::from_millis(20)), None);
+        runner.rewind();
+        assert_eq!(runner.run(None, None).operations_completed, 100);
+
+        // With a deadline the stream is replayed until it passes
+        runner.rewind();
+        let stats = runner.run(Some(Instant::now() + Duration::from_millis(20)), None);
+        assert!(stats.operations_completed > 100);
+    }
+
+    #[test]
+    fn test_unbounded_workload_needs_duration() {
+        let mut params = std::collections::HashMap::new();
+        params.insert("operations".to_string(), serde_json::json!(0));
+        params.insert("memory_size".to_string(), serde_json::json!(1 << 20));
+        let workload = WorkloadSpec {
+            name: "unbounded".to_string(),
+            workload_type: WorkloadType::Sequential,
+            params,
+        };
+        let mut config = ExecutionConfig {
+            duration_seconds: None,
+            rate_limit: None,
+            warmup_seconds: None,
+            metrics_interval: None,
+            huge_pages: None,
+        };
+        assert!(PatternExecutor::from_workload(workload.clone(), None, None, config.clone()).is_err());
+        config.duration_seconds = Some(1);
+        assert!(PatternExecutor::from_workload(workload, None, None, config).is_ok());
+    }
+
+    #[test]
+    fn test_initialization_pattern() {
+        // Large enough for several init threads, with a ragged tail
+        let size = 3 * INIT_MIN_CHUNK + 4096 + 100;
+        let memory = MemoryManager::new_system_memory(size, false).unwrap();
+        let mut buffer = vec![0u8; 4096];
+        for addr in [0, INIT_MIN_CHUNK - 64, 2 * INIT_MIN_CHUNK + 4096, size - 4096] {
+            memory.execute_read(addr, &mut buffer).unwrap();
+            for (i, byte) in buffer.iter().enumerate() {
+                assert_eq!(*byte, ((addr + i as u64) % 256) as u8);
+            }
+        }
+    }
+}
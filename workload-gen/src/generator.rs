@@ -3,312 +3,279 @@ use anyhow::Result;
 use rand::prelude::*;
 use std::collections::HashMap;
 
+/// Default seed when the workload does not set "seed"
+const DEFAULT_SEED: u64 = 42;
+
+/// Operations handed out per `next_batch` call when streaming
+pub const STREAM_BATCH_OPS: usize = 4096;
+
 /// Generate a simple pattern from a workload specification
+///
+/// The pattern is the concatenation of every thread's stream, so it holds
+/// exactly the operations a streaming run would execute.
 pub fn generate_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    match workload.workload_type {
-        WorkloadType::Sequential => generate_sequential_pattern(workload),
-        WorkloadType::Random => generate_random_pattern(workload),
-        WorkloadType::Hotspot => generate_hotspot_pattern(workload),
-        WorkloadType::Database => generate_database_pattern(workload),
-        WorkloadType::Analytics => generate_analytics_pattern(workload),
-        WorkloadType::Cache => generate_cache_pattern(workload),
-        WorkloadType::Mixed => generate_mixed_pattern(workload),
+    let params = StreamParams::from_workload(workload);
+    if params.ops_per_thread.is_none() {
+        anyhow::bail!("Cannot materialize an unbounded workload (operations = 0)");
     }
-}
 
-fn generate_sequential_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.7);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(4096);
-    
     let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    
-    for thread in 0..threads {
-        let thread_base_addr = thread as u64 * 1024 * 1024; // 1MB per thread
-        let mut current_addr = thread_base_addr;
-        
-        for _ in 0..ops_per_thread {
-            if rand::random::<f64>() < read_ratio {
-                operations.push(Operation::Read {
-                    addr: current_addr,
-                    size: block_size,
-                    thread,
-                });
-            } else {
-                operations.push(Operation::Write {
-                    addr: current_addr,
-                    size: block_size,
-                    thread,
-                });
-            }
-            current_addr += block_size;
-        }
+    for thread in 0..params.threads {
+        operations.extend(ThreadOpStream::new(&params, thread));
     }
-    
+
     Ok(Pattern {
         name: workload.name.clone(),
         operations,
     })
 }
 
-fn generate_random_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.7);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(4096);
-    let memory_size = get_param_as_u64(&workload.params, "memory_size").unwrap_or(1024 * 1024 * 1024); // 1GB
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    let mut rng = StdRng::seed_from_u64(42);
-    
-    for thread in 0..threads {
-        for _ in 0..ops_per_thread {
-            let random_addr = rng.gen_range(0..(memory_size - block_size) / block_size) * block_size;
-            
-            if rand::random::<f64>() < read_ratio {
-                operations.push(Operation::Read {
-                    addr: random_addr,
-                    size: block_size,
-                    thread,
-                });
-            } else {
-                operations.push(Operation::Write {
-                    addr: random_addr,
-                    size: block_size,
-                    thread,
-                });
-            }
+/// Create one lazily generated operation stream per workload thread
+pub fn thread_streams(workload: &WorkloadSpec) -> Vec<ThreadOpStream> {
+    let params = StreamParams::from_workload(workload);
+    (0..params.threads)
+        .map(|thread| ThreadOpStream::new(&params, thread))
+        .collect()
+}
+
+/// Workload parameters with per-type defaults applied
+#[derive(Debug, Clone)]
+pub struct StreamParams {
+    workload_type: WorkloadType,
+    pub threads: u32,
+    /// None = unbounded ("operations": 0)
+    pub ops_per_thread: Option<u64>,
+    read_ratio: f64,
+    block_size: u64,
+    /// Every generated access lies below this offset
+    pub memory_size: u64,
+    hotspot_ratio: f64,
+    cpu_cycles: u64,
+    cpu_ratio: f64,
+    cache_miss_ratio: f64,
+    seed: u64,
+}
+
+impl StreamParams {
+    pub fn from_workload(workload: &WorkloadSpec) -> Self {
+        let params = &workload.params;
+        let workload_type = workload.workload_type.clone();
+
+        let (default_read_ratio, default_block_size, default_cpu_cycles) = match workload_type {
+            WorkloadType::Hotspot => (0.8, 4096, 0),
+            WorkloadType::Database => (0.9, 8192, 0),
+            WorkloadType::Analytics => (1.0, 1024 * 1024, 1000000), // 1MB blocks
+            WorkloadType::Cache => (0.95, 64, 0),                   // Cache line size
+            WorkloadType::Mixed => (0.7, 4096, 10000),
+            _ => (0.7, 4096, 0),
+        };
+
+        let operations = get_param_as_u64(params, "operations").unwrap_or(1000);
+        let threads = get_param_as_u32(params, "threads").unwrap_or(4).max(1);
+
+        Self {
+            workload_type,
+            threads,
+            ops_per_thread: if operations == 0 { None } else { Some(operations / threads as u64) },
+            read_ratio: get_param_as_f64(params, "read_ratio").unwrap_or(default_read_ratio),
+            block_size: get_param_as_u64(params, "block_size").unwrap_or(default_block_size),
+            memory_size: get_param_as_u64(params, "memory_size").unwrap_or(1024 * 1024 * 1024), // 1GB
+            hotspot_ratio: get_param_as_f64(params, "hotspot_ratio").unwrap_or(0.8),
+            cpu_cycles: get_param_as_u64(params, "cpu_cycles").unwrap_or(default_cpu_cycles),
+            cpu_ratio: get_param_as_f64(params, "cpu_ratio").unwrap_or(0.2),
+            cache_miss_ratio: get_param_as_f64(params, "cache_miss_ratio").unwrap_or(0.1),
+            seed: get_param_as_u64(params, "seed").unwrap_or(DEFAULT_SEED),
         }
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
 }
 
-fn generate_hotspot_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.8);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(4096);
-    let hotspot_ratio = get_param_as_f64(&workload.params, "hotspot_ratio").unwrap_or(0.8);
-    let memory_size = get_param_as_u64(&workload.params, "memory_size").unwrap_or(1024 * 1024 * 1024);
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    let hotspot_size = memory_size / 10; // Hot region is 10% of total memory
-    let mut rng = StdRng::seed_from_u64(42);
-    
-    for thread in 0..threads {
-        for _ in 0..ops_per_thread {
-            let addr = if rand::random::<f64>() < hotspot_ratio {
-                // Access hot region
-                rng.gen_range(0..(hotspot_size - block_size) / block_size) * block_size
-            } else {
-                // Access cold region
-                hotspot_size + rng.gen_range(0..((memory_size - hotspot_size - block_size) / block_size)) * block_size
-            };
-            
-            if rand::random::<f64>() < read_ratio {
-                operations.push(Operation::Read {
-                    addr,
-                    size: block_size,
-                    thread,
-                });
-            } else {
-                operations.push(Operation::Write {
-                    addr,
-                    size: block_size,
-                    thread,
-                });
-            }
+/// Deterministic, lazily generated operation sequence of one thread
+///
+/// Each thread has its own RNG derived from the workload seed, so the
+/// sequence does not depend on how threads are interleaved or batched.
+pub struct ThreadOpStream {
+    params: StreamParams,
+    thread: u32,
+    step: u64,
+    rng: StdRng,
+    base_addr: u64,
+    current_addr: u64,
+    pending: Option<Operation>,
+}
+
+impl ThreadOpStream {
+    pub fn new(params: &StreamParams, thread: u32) -> Self {
+        let region_size: u64 = match params.workload_type {
+            WorkloadType::Database => 10 * 1024 * 1024,   // 10MB per thread
+            WorkloadType::Analytics => 100 * 1024 * 1024, // 100MB per thread
+            WorkloadType::Random | WorkloadType::Hotspot => 0,
+            _ => 1024 * 1024, // 1MB per thread
+        };
+        let base_addr = (thread as u64 * region_size) % params.memory_size;
+
+        Self {
+            params: params.clone(),
+            thread,
+            step: 0,
+            rng: Self::thread_rng(params, thread),
+            base_addr,
+            current_addr: base_addr,
+            pending: None,
         }
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
-}
 
-fn generate_database_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.9);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(8192);
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    
-    for thread in 0..threads {
-        let thread_base_addr = thread as u64 * 10 * 1024 * 1024; // 10MB per thread
-        let mut current_addr = thread_base_addr;
-        
-        for i in 0..ops_per_thread {
-            // Simulate database access: mostly sequential with some random seeks
-            if i % 10 == 0 {
-                // Random seek every 10 operations
-                current_addr = thread_base_addr + (rand::random::<u64>() % (5 * 1024 * 1024)) & !(block_size - 1);
-            }
-            
-            if rand::random::<f64>() < read_ratio {
-                operations.push(Operation::Read {
-                    addr: current_addr,
-                    size: block_size,
-                    thread,
-                });
-            } else {
-                operations.push(Operation::Write {
-                    addr: current_addr,
-                    size: block_size,
-                    thread,
-                });
-            }
-            
-            current_addr += block_size;
+    pub fn thread(&self) -> u32 {
+        self.thread
+    }
+
+    /// Rewind to the first operation; the replay is identical
+    pub fn reset(&mut self) {
+        self.step = 0;
+        self.rng = Self::thread_rng(&self.params, self.thread);
+        self.current_addr = self.base_addr;
+        self.pending = None;
+    }
+
+    fn thread_rng(params: &StreamParams, thread: u32) -> StdRng {
+        StdRng::seed_from_u64(params.seed ^ (thread as u64).wrapping_mul(0x9E37_79B9_7F4A_7C15))
+    }
+
+    /// Refill `batch` with up to `max_ops` operations; returns false once
+    /// the stream is exhausted and nothing was added
+    pub fn next_batch(&mut self, batch: &mut Vec<Operation>, max_ops: usize) -> bool {
+        batch.clear();
+        batch.extend(self.by_ref().take(max_ops));
+        !batch.is_empty()
+    }
+
+    /// Keep `size` bytes at `addr` inside the workload's memory
+    fn fit(&self, addr: u64, size: u64) -> u64 {
+        let memory_size = self.params.memory_size;
+        if addr + size <= memory_size || size >= memory_size {
+            return addr;
         }
+        let wrapped = addr % (memory_size - size);
+        wrapped - wrapped % size.max(1)
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
-}
 
-fn generate_analytics_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(1024 * 1024); // 1MB blocks
-    let cpu_cycles = get_param_as_u64(&workload.params, "cpu_cycles").unwrap_or(1000000);
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    
-    for thread in 0..threads {
-        let thread_base_addr = thread as u64 * 100 * 1024 * 1024; // 100MB per thread
-        let mut current_addr = thread_base_addr;
-        
-        for i in 0..ops_per_thread {
-            // Read large sequential blocks
-            operations.push(Operation::Read {
-                addr: current_addr,
-                size: block_size,
-                thread,
-            });
-            
-            // Add CPU computation after every few reads
-            if i % 5 == 4 {
-                operations.push(Operation::Cpu {
-                    cycles: cpu_cycles,
-                    thread,
-                });
-            }
-            
-            current_addr += block_size;
+    /// Sequential cursor that restarts at the thread base when it runs off
+    /// the end of memory
+    fn advance(&mut self) -> u64 {
+        let size = self.params.block_size;
+        if self.current_addr + size > self.params.memory_size {
+            self.current_addr = self.base_addr;
         }
+        let addr = self.current_addr;
+        self.current_addr += size;
+        self.fit(addr, size)
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
-}
 
-fn generate_cache_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.95);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(64); // Cache line size
-    let cache_miss_ratio = get_param_as_f64(&workload.params, "cache_miss_ratio").unwrap_or(0.1);
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    let cache_size = 32 * 1024; // 32KB cache per thread
-    
-    for thread in 0..threads {
-        let thread_base_addr = thread as u64 * 1024 * 1024; // 1MB per thread
-        
-        for _ in 0..ops_per_thread {
-            let addr = if rand::random::<f64>() < cache_miss_ratio {
-                // Cache miss - access beyond cache
-                thread_base_addr + cache_size + (rand::random::<u64>() % (512 * 1024)) & !(block_size - 1)
-            } else {
-                // Cache hit - access within cache
-                thread_base_addr + (rand::random::<u64>() % cache_size) & !(block_size - 1)
-            };
-            
-            if rand::random::<f64>() < read_ratio {
-                operations.push(Operation::Read {
-                    addr,
-                    size: block_size,
-                    thread,
-                });
-            } else {
-                operations.push(Operation::Write {
+    fn memory_op(&mut self, addr: u64) -> Operation {
+        let size = self.params.block_size;
+        let thread = self.thread;
+        if self.rng.gen::<f64>() < self.params.read_ratio {
+            Operation::Read { addr, size, thread }
+        } else {
+            Operation::Write { addr, size, thread }
+        }
+    }
+
+    fn generate(&mut self) -> Operation {
+        let block_size = self.params.block_size;
+        let memory_size = self.params.memory_size;
+        let step = self.step;
+
+        match self.params.workload_type {
+            WorkloadType::Sequential => {
+                let addr = self.advance();
+                self.memory_op(addr)
+            }
+            WorkloadType::Random => {
+                let blocks = ((memory_size - block_size) / block_size).max(1);
+                let addr = self.rng.gen_range(0..blocks) * block_size;
+                self.memory_op(addr)
+            }
+            WorkloadType::Hotspot => {
+                let hotspot_size = memory_size / 10; // Hot region is 10% of total memory
+                let addr = if self.rng.gen::<f64>() < self.params.hotspot_ratio {
+                    // Access hot region
+                    let blocks = ((hotspot_size - block_size) / block_size).max(1);
+                    self.rng.gen_range(0..blocks) * block_size
+                } else {
+                    // Access cold region
+                    let blocks = ((memory_size - hotspot_size - block_size) / block_size).max(1);
+                    hotspot_size + self.rng.gen_range(0..blocks) * block_size
+                };
+                self.memory_op(addr)
+            }
+            WorkloadType::Database => {
+                // Simulate database access: mostly sequential with some random seeks
+                if step % 10 == 0 {
+                    // Random seek every 10 operations
+                    self.current_addr =
+                        self.base_addr + (self.rng.gen::<u64>() % (5 * 1024 * 1024)) & !(block_size - 1);
+                }
+                let addr = self.advance();
+                self.memory_op(addr)
+            }
+            WorkloadType::Analytics => {
+                // Read large sequential blocks, CPU computation after every few reads
+                let addr = self.advance();
+                if step % 5 == 4 {
+                    self.pending = Some(Operation::Cpu {
+                        cycles: self.params.cpu_cycles,
+                        thread: self.thread,
+                    });
+                }
+                Operation::Read {
                     addr,
                     size: block_size,
-                    thread,
-                });
+                    thread: self.thread,
+                }
+            }
+            WorkloadType::Cache => {
+                let cache_size = 32 * 1024; // 32KB cache per thread
+                let addr = if self.rng.gen::<f64>() < self.params.cache_miss_ratio {
+                    // Cache miss - access beyond cache
+                    self.base_addr + cache_size + (self.rng.gen::<u64>() % (512 * 1024)) & !(block_size - 1)
+                } else {
+                    // Cache hit - access within cache
+                    self.base_addr + (self.rng.gen::<u64>() % cache_size) & !(block_size - 1)
+                };
+                let addr = self.fit(addr, block_size);
+                self.memory_op(addr)
+            }
+            WorkloadType::Mixed => {
+                if self.rng.gen::<f64>() < self.params.cpu_ratio {
+                    Operation::Cpu {
+                        cycles: self.params.cpu_cycles,
+                        thread: self.thread,
+                    }
+                } else {
+                    let addr = self.advance();
+                    self.memory_op(addr)
+                }
             }
         }
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
 }
 
-fn generate_mixed_pattern(workload: &WorkloadSpec) -> Result<Pattern> {
-    let operations_count = get_param_as_u64(&workload.params, "operations").unwrap_or(1000);
-    let threads = get_param_as_u32(&workload.params, "threads").unwrap_or(4);
-    let read_ratio = get_param_as_f64(&workload.params, "read_ratio").unwrap_or(0.7);
-    let block_size = get_param_as_u64(&workload.params, "block_size").unwrap_or(4096);
-    let cpu_ratio = get_param_as_f64(&workload.params, "cpu_ratio").unwrap_or(0.2);
-    let cpu_cycles = get_param_as_u64(&workload.params, "cpu_cycles").unwrap_or(10000);
-    
-    let mut operations = Vec::new();
-    let ops_per_thread = operations_count / threads as u64;
-    
-    for thread in 0..threads {
-        let thread_base_addr = thread as u64 * 1024 * 1024; // 1MB per thread
-        let mut current_addr = thread_base_addr;
-        
-        for _ in 0..ops_per_thread {
-            if rand::random::<f64>() < cpu_ratio {
-                // CPU operation
-                operations.push(Operation::Cpu {
-                    cycles: cpu_cycles,
-                    thread,
-                });
-            } else {
-                // Memory operation
-                if rand::random::<f64>() < read_ratio {
-                    operations.push(Operation::Read {
-                        addr: current_addr,
-                        size: block_size,
-                        thread,
-                    });
-                } else {
-                    operations.push(Operation::Write {
-                        addr: current_addr,
-                        size: block_size,
-                        thread,
-                    });
-                }
-                current_addr += block_size;
+impl Iterator for ThreadOpStream {
+    type Item = Operation;
+
+    fn next(&mut self) -> Option<Operation> {
+        if let Some(op) = self.pending.take() {
+            return Some(op);
+        }
+        if let Some(limit) = self.params.ops_per_thread {
+            if self.step >= limit {
+                return None;
             }
         }
+        let op = self.generate();
+        self.step += 1;
+        Some(op)
     }
-    
-    Ok(Pattern {
-        name: workload.name.clone(),
-        operations,
-    })
 }
 
 // Helper functions
@@ -322,4 +289,55 @@ fn get_param_as_u32(params: &HashMap<String, serde_json::Value>, key: &str) -> O
 
 fn get_param_as_f64(params: &HashMap<String, serde_json::Value>, key: &str) -> Option<f64> {
     params.get(key)?.as_f64()
-} 
\ No newline at end of file
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn workload(workload_type: WorkloadType, operations: u64) -> WorkloadSpec {
+        let mut params = HashMap::new();
+        params.insert("operations".to_string(), serde_json::json!(operations));
+        params.insert("threads".to_string(), serde_json::json!(2));
+        WorkloadSpec {
+            name: "test".to_string(),
+            workload_type,
+            params,
+        }
+    }
+
+    #[test]
+    fn test_stream_is_deterministic() {
+        let spec = workload(WorkloadType::Hotspot, 1000);
+        let first = serde_json::to_string(&generate_pattern(&spec).unwrap()).unwrap();
+        let second = serde_json::to_string(&generate_pattern(&spec).unwrap()).unwrap();
+        assert_eq!(first, second);
+
+        // Batching must not change the sequence
+        let mut stream = thread_streams(&spec).remove(1);
+        let mut batch = Vec::new();
+        let mut batched = Vec::new();
+        while stream.next_batch(&mut batch, 7) {
+            batched.extend(batch.drain(..));
+        }
+        let direct: Vec<_> = thread_streams(&spec).remove(1).collect();
+        assert_eq!(serde_json::to_string(&batched).unwrap(), serde_json::to_string(&direct).unwrap());
+
+        // A reset stream replays the same sequence
+        stream.reset();
+        let replayed: Vec<_> = stream.collect();
+        assert_eq!(serde_json::to_string(&replayed).unwrap(), serde_json::to_string(&direct).unwrap());
+    }
+
+    #[test]
+    fn test_unbounded_stream_stays_in_memory() {
+        let spec = workload(WorkloadType::Sequential, 0);
+        let params = StreamParams::from_workload(&spec);
+        for op in thread_streams(&spec).remove(0).take(1_000_000) {
+            if let Operation::Read { addr, size, .. } | Operation::Write { addr, size, .. } = op {
+                assert!(addr + size <= params.memory_size);
+            }
+        }
+        assert!(generate_pattern(&spec).is_err());
+    }
+}
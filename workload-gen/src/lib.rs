@@ -3,6 +3,7 @@
 pub mod common;
 pub mod executor;
 pub mod generator;
+pub mod topology;
 
 pub use common::*;
 pub use executor::*;
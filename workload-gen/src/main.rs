@@ -1,14 +1,16 @@
 use clap::{Parser, Subcommand};
 use anyhow::Result;
+use std::io::{BufWriter, Write};
 use std::path::PathBuf;
 
 mod common;
 mod executor;
 mod generator;
+mod topology;
 
 use common::{Pattern, WorkloadSpec, ExecutionResults, AddressMap, ScheduleMap, ExecutionConfig};
 use executor::PatternExecutor;
-use generator::generate_pattern;
+use generator::{generate_pattern, thread_streams, StreamParams, STREAM_BATCH_OPS};
 
 #[derive(Parser)]
 #[command(name = "workload-gen")]
@@ -23,8 +25,14 @@ enum Commands {
     /// Execute a pattern specification
     Exec {
         /// Path to pattern JSON file
-        #[arg(short, long)]
-        pattern: PathBuf,
+        #[arg(short, long, required_unless_present = "workload")]
+        pattern: Option<PathBuf>,
+        
+        /// Generate operations on the fly from a workload specification
+        /// instead of loading a pattern ("operations": 0 runs until the
+        /// duration expires and requires one)
+        #[arg(short, long, conflicts_with = "pattern")]
+        workload: Option<PathBuf>,
         
         /// Address mapping configuration
         #[arg(short, long)]
@@ -42,6 +50,14 @@ enum Commands {
         #[arg(short, long)]
         duration: Option<u64>,
         
+        /// Override the rate limit (total operations per second)
+        #[arg(short, long)]
+        rate_limit: Option<u64>,
+        
+        /// Back workload memory with transparent huge pages
+        #[arg(long)]
+        huge_pages: bool,
+        
         /// Verbose output
         #[arg(short, long)]
         verbose: bool,
@@ -61,9 +77,10 @@ enum Commands {
         #[arg(short, long)]
         workload: Option<PathBuf>,
         
-        /// Number of operations to generate
-        #[arg(long, default_value = "1000")]
-        operations: u64,
+        /// Number of operations to generate (default 1000; overrides the
+        /// workload file's "operations")
+        #[arg(long)]
+        operations: Option<u64>,
         
         /// Number of threads
         #[arg(long, default_value = "4")]
@@ -81,6 +98,11 @@ enum Commands {
         #[arg(short, long)]
         output: PathBuf,
         
+        /// Write operations as they are generated instead of building the
+        /// whole pattern in memory first
+        #[arg(long)]
+        stream: bool,
+        
         /// Verbose output
         #[arg(short, long)]
         verbose: bool,
@@ -113,14 +135,17 @@ fn main() -> Result<()> {
     match cli.command {
         Commands::Exec { 
             pattern, 
+            workload,
             address_map,
             schedule_map,
             execution_config,
             duration,
+            rate_limit,
+            huge_pages,
             verbose, 
             output 
         } => {
-            execute_command(pattern, address_map, schedule_map, execution_config, duration, verbose, output)
+            execute_command(pattern, workload, address_map, schedule_map, execution_config, duration, rate_limit, huge_pages, verbose, output)
         }
         Commands::Generate { 
             workload_type,
@@ -130,9 +155,10 @@ fn main() -> Result<()> {
             read_ratio,
             block_size,
             output, 
+            stream,
             verbose 
         } => {
-            generate_command(workload_type, workload, operations, threads, read_ratio, block_size, output, verbose)
+            generate_command(workload_type, workload, operations, threads, read_ratio, block_size, output, stream, verbose)
         }
         Commands::Schedule {
             pattern,
@@ -146,18 +172,17 @@ fn main() -> Result<()> {
 }
 
 fn execute_command(
-    pattern_path: PathBuf,
+    pattern_path: Option<PathBuf>,
+    workload_path: Option<PathBuf>,
     address_map_path: Option<PathBuf>,
     schedule_map_path: Option<PathBuf>,
     execution_config_path: Option<PathBuf>,
     duration_override: Option<u64>,
+    rate_limit_override: Option<u64>,
+    huge_pages: bool,
     verbose: bool,
     output_path: Option<PathBuf>,
 ) -> Result<()> {
-    // Load pattern
-    let pattern_content = std::fs::read_to_string(&pattern_path)?;
-    let pattern: Pattern = serde_json::from_str(&pattern_content)?;
-    
     // Load optional configurations
     let address_map = if let Some(path) = address_map_path {
         let content = std::fs::read_to_string(&path)?;
@@ -182,6 +207,7 @@ fn execute_command(
             rate_limit: None,
             warmup_seconds: None,
             metrics_interval: None,
+            huge_pages: None,
         }
     };
     
@@ -189,6 +215,43 @@ fn execute_command(
     if let Some(duration) = duration_override {
         execution_config.duration_seconds = Some(duration);
     }
+    if let Some(rate_limit) = rate_limit_override {
+        execution_config.rate_limit = Some(rate_limit);
+    }
+    if huge_pages {
+        execution_config.huge_pages = Some(true);
+    }
+    
+    if let Some(workload_path) = workload_path {
+        let workload_content = std::fs::read_to_string(&workload_path)?;
+        let workload: WorkloadSpec = serde_json::from_str(&workload_content)?;
+        
+        if verbose {
+            let params = StreamParams::from_workload(&workload);
+            println!("=== Streaming Workload Execution ===");
+            println!("Workload: {}", workload.name);
+            println!("Type: {:?}", workload.workload_type);
+            match params.ops_per_thread {
+                Some(ops) => println!("Operations per thread: {}", ops),
+                None => println!("Operations per thread: unbounded"),
+            }
+            println!("Threads: {}", params.threads);
+            println!("Duration: {:?} seconds", execution_config.duration_seconds);
+            if let Some(rate) = execution_config.rate_limit {
+                println!("Rate limit: {} ops/s", rate);
+            }
+            println!();
+        }
+        
+        let executor = PatternExecutor::from_workload(workload, address_map, schedule_map, execution_config)?;
+        let results = executor.execute()?;
+        return finish_execution(&results, verbose, output_path);
+    }
+    
+    // Load pattern
+    let pattern_path = pattern_path.ok_or_else(|| anyhow::anyhow!("Must specify either --pattern or --workload"))?;
+    let pattern_content = std::fs::read_to_string(&pattern_path)?;
+    let pattern: Pattern = serde_json::from_str(&pattern_content)?;
     
     if verbose {
         println!("=== Pattern Execution ===");
@@ -218,19 +281,25 @@ fn execute_command(
         }
         
         println!("Duration: {:?} seconds", execution_config.duration_seconds);
+        if let Some(rate) = execution_config.rate_limit {
+            println!("Rate limit: {} ops/s", rate);
+        }
         println!();
     }
     
     // Execute pattern
     let executor = PatternExecutor::new(pattern, address_map, schedule_map, execution_config)?;
     let results = executor.execute()?;
-    
+    finish_execution(&results, verbose, output_path)
+}
+
+fn finish_execution(results: &ExecutionResults, verbose: bool, output_path: Option<PathBuf>) -> Result<()> {
     // Display results
-    display_results(&results, verbose);
+    display_results(results, verbose);
     
     // Save results if requested
     if let Some(output) = output_path {
-        let results_json = serde_json::to_string_pretty(&results)?;
+        let results_json = serde_json::to_string_pretty(results)?;
         std::fs::write(output, results_json)?;
         println!("Results saved to file");
     }
@@ -241,17 +310,21 @@ fn execute_command(
 fn generate_command(
     workload_type: Option<String>,
     workload_path: Option<PathBuf>,
-    operations: u64,
+    operations: Option<u64>,
     threads: u32,
     read_ratio: f64,
     block_size: u64,
     output_path: PathBuf,
+    stream: bool,
     verbose: bool,
 ) -> Result<()> {
-    let pattern = if let Some(workload_path) = workload_path {
+    let workload = if let Some(workload_path) = workload_path {
         // Generate from workload file
         let workload_content = std::fs::read_to_string(&workload_path)?;
-        let workload: WorkloadSpec = serde_json::from_str(&workload_content)?;
+        let mut workload: WorkloadSpec = serde_json::from_str(&workload_content)?;
+        if let Some(operations) = operations {
+            workload.params.insert("operations".to_string(), operations.into());
+        }
         
         if verbose {
             println!("=== Pattern Generation ===");
@@ -260,7 +333,7 @@ fn generate_command(
             println!();
         }
         
-        generate_pattern(&workload)?
+        workload
     } else if let Some(wl_type) = workload_type {
         // Generate from command line parameters
         let workload_type = match wl_type.as_str() {
@@ -274,6 +347,7 @@ fn generate_command(
             _ => return Err(anyhow::anyhow!("Unknown workload type: {}", wl_type)),
         };
         
+        let operations = operations.unwrap_or(1000);
         let mut params = std::collections::HashMap::new();
         params.insert("operations".to_string(), serde_json::Value::Number(operations.into()));
         params.insert("threads".to_string(), serde_json::Value::Number(threads.into()));
@@ -296,11 +370,24 @@ fn generate_command(
             println!();
         }
         
-        generate_pattern(&workload)?
+        workload
     } else {
         return Err(anyhow::anyhow!("Must specify either --workload-type or --workload"));
     };
     
+    if stream {
+        let written = write_pattern_stream(&workload, &output_path)?;
+        if verbose {
+            println!("Generated pattern: {}", workload.name);
+            println!("Total operations: {}", written);
+            println!();
+        }
+        println!("Pattern generated and saved to: {}", output_path.display());
+        return Ok(());
+    }
+    
+    let pattern = generate_pattern(&workload)?;
+    
     if verbose {
         println!("Generated pattern: {}", pattern.name);
         println!("Total operations: {}", pattern.operations.len());
@@ -316,6 +403,36 @@ fn generate_command(
     Ok(())
 }
 
+/// Write the pattern for `workload` one operation at a time, so memory use
+/// does not grow with the operation count. Returns the operations written.
+fn write_pattern_stream(workload: &WorkloadSpec, output_path: &PathBuf) -> Result<u64> {
+    let params = StreamParams::from_workload(workload);
+    if params.ops_per_thread.is_none() {
+        return Err(anyhow::anyhow!(
+            "Cannot write an unbounded workload (operations = 0); pass --operations"
+        ));
+    }
+    
+    let mut out = BufWriter::new(std::fs::File::create(output_path)?);
+    write!(out, "{{\n  \"name\": {},\n  \"operations\": [", serde_json::to_string(&workload.name)?)?;
+    
+    let mut written = 0u64;
+    let mut batch = Vec::with_capacity(STREAM_BATCH_OPS);
+    for mut stream in thread_streams(workload) {
+        while stream.next_batch(&mut batch, STREAM_BATCH_OPS) {
+            for op in &batch {
+                out.write_all(if written == 0 { b"\n    " } else { b",\n    " })?;
+                serde_json::to_writer(&mut out, op)?;
+                written += 1;
+            }
+        }
+    }
+    
+    out.write_all(if written == 0 { b"]\n}\n" } else { b"\n  ]\n}\n" })?;
+    out.flush()?;
+    Ok(written)
+}
+
 fn schedule_command(
     pattern_path: PathBuf,
     analyze: bool,
@@ -391,8 +508,13 @@ fn schedule_command(
             }
         }
         
+        // Place CPU threads round-robin over the CPUs in sysfs order and
+        // record each CPU's real NUMA node
+        let topology = topology::cpu_topology();
         let mut thread_mapping = Vec::new();
-        let mut cpu_id = 0u32;
+        let mut next_cpu = 0usize;
+        let mut threads: Vec<u32> = threads.into_iter().collect();
+        threads.sort_unstable();
         
         for &thread in &threads {
             if gpu_threads.contains(&thread) {
@@ -403,13 +525,20 @@ fn schedule_command(
                     numa_node: None,
                 });
             } else {
+                let (cpu, numa_node) = match topology {
+                    Some(ref cpus) => {
+                        let (cpu, node) = cpus[next_cpu % cpus.len()];
+                        (cpu, Some(node))
+                    }
+                    None => (next_cpu as u32, None),
+                };
                 thread_mapping.push(common::ThreadMapping {
                     thread,
-                    cpu: Some(cpu_id),
+                    cpu: Some(cpu),
                     gpu: None,
-                    numa_node: Some(cpu_id / 4), // Assume 4 CPUs per NUMA node
+                    numa_node,
                 });
-                cpu_id += 1;
+                next_cpu += 1;
             }
         }
         
@@ -432,12 +561,19 @@ fn schedule_command(
 fn display_results(results: &ExecutionResults, verbose: bool) {
     println!("=== Execution Results ===");
     println!("Pattern: {}", results.pattern_name);
+    println!("Setup: {:.3} s", results.setup_duration_ns as f64 / 1_000_000_000.0);
     println!("Duration: {:.3} s", results.total_duration_ns as f64 / 1_000_000_000.0);
     println!("Operations: {}", results.total_operations);
     
     if results.total_operations > 0 {
         println!("Average Latency: {:.2} ns", results.average_latency_ns);
         println!("Operations/sec: {:.2}", results.operations_per_second);
+        if let Some(requested) = results.requested_ops_per_second {
+            println!("Rate limit: {:.2} ops/s requested, {:.1}% achieved",
+                requested,
+                results.operations_per_second / requested * 100.0
+            );
+        }
     }
     
     if results.total_bytes_read > 0 {
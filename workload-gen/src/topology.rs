@@ -0,0 +1,106 @@
+use anyhow::Result;
+use std::fs;
+
+const NODE_SYSFS: &str = "/sys/devices/system/node";
+
+/// Parse a kernel CPU/node list such as "0-3,8,10-11"
+pub fn parse_cpu_list(list: &str) -> Result<Vec<u32>> {
+    let mut cpus = Vec::new();
+    for part in list.trim().split(',').filter(|p| !p.is_empty()) {
+        if let Some((start, end)) = part.split_once('-') {
+            let start: u32 = start.parse()?;
+            let end: u32 = end.parse()?;
+            cpus.extend(start..=end);
+        } else {
+            cpus.push(part.parse()?);
+        }
+    }
+    Ok(cpus)
+}
+
+/// NUMA nodes that have CPUs or memory, in ascending order
+pub fn online_nodes() -> Vec<u32> {
+    fs::read_to_string(format!("{}/online", NODE_SYSFS))
+        .ok()
+        .and_then(|list| parse_cpu_list(&list).ok())
+        .unwrap_or_default()
+}
+
+/// CPUs attached to `node`; empty for memory-only nodes such as CXL expanders
+pub fn node_cpus(node: u32) -> Result<Vec<u32>> {
+    let list = fs::read_to_string(format!("{}/node{}/cpulist", NODE_SYSFS, node))
+        .map_err(|e| anyhow::anyhow!("Cannot read CPU list of NUMA node {}: {}", node, e))?;
+    parse_cpu_list(&list)
+}
+
+/// (cpu, node) for every CPU, ordered by CPU id; None if sysfs has no
+/// NUMA information
+pub fn cpu_topology() -> Option<Vec<(u32, u32)>> {
+    let mut cpus = Vec::new();
+    for node in online_nodes() {
+        for cpu in node_cpus(node).ok()? {
+            cpus.push((cpu, node));
+        }
+    }
+    if cpus.is_empty() {
+        return None;
+    }
+    cpus.sort_unstable();
+    Some(cpus)
+}
+
+/// Restrict the calling thread to `cpus`
+pub fn pin_current_thread(cpus: &[u32]) -> Result<()> {
+    unsafe {
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        for &cpu in cpus {
+            if cpu as usize >= libc::CPU_SETSIZE as usize {
+                anyhow::bail!("CPU {} exceeds CPU_SETSIZE", cpu);
+            }
+            libc::CPU_SET(cpu as usize, &mut set);
+        }
+        if libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) != 0 {
+            anyhow::bail!("sched_setaffinity({:?}) failed: {}", cpus, std::io::Error::last_os_error());
+        }
+    }
+    Ok(())
+}
+
+/// Bind the pages of [addr, addr + len) to `node` (MPOL_BIND). Must be
+/// called before the pages are first touched.
+pub fn bind_to_node(addr: *mut u8, len: usize, node: u32) -> Result<()> {
+    const MPOL_BIND: libc::c_int = 2;
+    let bits = libc::c_ulong::BITS;
+    let mut nodemask = vec![0 as libc::c_ulong; node as usize / bits as usize + 1];
+    nodemask[(node / bits) as usize] |= 1 << (node % bits);
+    // The kernel expects one more than the number of bits in the mask
+    let maxnode = (nodemask.len() * bits as usize + 1) as libc::c_ulong;
+
+    let ret = unsafe {
+        libc::syscall(
+            libc::SYS_mbind,
+            addr as *mut libc::c_void,
+            len as libc::c_ulong,
+            MPOL_BIND,
+            nodemask.as_ptr(),
+            maxnode,
+            0 as libc::c_uint,
+        )
+    };
+    if ret != 0 {
+        anyhow::bail!("mbind to NUMA node {} failed: {}", node, std::io::Error::last_os_error());
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_parse_cpu_list() {
+        assert_eq!(parse_cpu_list("0-3,8,10-11\n").unwrap(), vec![0, 1, 2, 3, 8, 10, 11]);
+        assert_eq!(parse_cpu_list("\n").unwrap(), Vec::<u32>::new());
+        assert!(parse_cpu_list("x").is_err());
+    }
+}